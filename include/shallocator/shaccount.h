@@ -0,0 +1,529 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Memory accounting allocator.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHACCOUNT_H
+#define SHALLOCATOR_SHACCOUNT_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Memory account of one tag, lives in shared memory.
+ *
+ * Counters are updated by atomic operations by all processes.
+ */
+class Account_t {
+public:
+    /**
+     * @short Create account.
+     * @param __name name of account (truncated to 31 chars).
+     * @param __quota max live bytes, 0 means unlimited.
+     */
+    Account_t(const char *__name, std::size_t __quota)
+        : bytes_(0), blocks_(0), peak_(0), allocations_(0), failures_(0),
+          quota_(__quota), next(0)
+    {
+        std::strncpy(name_, __name, sizeof(name_) - 1);
+        name_[sizeof(name_) - 1] = 0;
+    }
+
+    /**
+     * @short Charge account, fail if quota would be exceeded.
+     * @param __bytes size of allocated block.
+     * @return false if quota would be exceeded.
+     */
+    bool charge(std::size_t __bytes) {
+        std::size_t __now;
+        std::size_t __quota = __atomic_load_n(&quota_, __ATOMIC_RELAXED);
+        if (__quota) {
+            std::size_t __old = __atomic_load_n(&bytes_, __ATOMIC_RELAXED);
+            do {
+                if (__old + __bytes > __quota) {
+                    __atomic_fetch_add(&failures_, 1, __ATOMIC_RELAXED);
+                    return false;
+                }
+            } while (!__atomic_compare_exchange_n(&bytes_, &__old,
+                        __old + __bytes, true, __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED));
+            __now = __old + __bytes;
+        } else {
+            __now = __atomic_add_fetch(&bytes_, __bytes, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&blocks_, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&allocations_, 1, __ATOMIC_RELAXED);
+
+        // peak is written only when it grows
+        std::size_t __peak = __atomic_load_n(&peak_, __ATOMIC_RELAXED);
+        while ((__now > __peak) && !__atomic_compare_exchange_n(&peak_,
+                    &__peak, __now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        return true;
+    }
+
+    /**
+     * @short Return charged bytes.
+     * @param __bytes size of freed block.
+     */
+    void uncharge(std::size_t __bytes) {
+        __atomic_fetch_sub(&bytes_, __bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&blocks_, 1, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Record allocation failure not caused by quota.
+     */
+    void failed() { __atomic_fetch_add(&failures_, 1, __ATOMIC_RELAXED);}
+
+    /**
+     * @short Set new quota, 0 means unlimited.
+     */
+    void quota(std::size_t __quota) {
+        __atomic_store_n(&quota_, __quota, __ATOMIC_RELAXED);
+    }
+
+    /// name of account
+    const char *name() const { return name_;}
+    /// quota, 0 means unlimited
+    std::size_t quota() const {
+        return __atomic_load_n(&quota_, __ATOMIC_RELAXED);
+    }
+    /// live bytes
+    std::size_t bytes() const {
+        return __atomic_load_n(&bytes_, __ATOMIC_RELAXED);
+    }
+    /// live blocks
+    std::size_t blocks() const {
+        return __atomic_load_n(&blocks_, __ATOMIC_RELAXED);
+    }
+    /// max of live bytes
+    std::size_t peak() const {
+        return __atomic_load_n(&peak_, __ATOMIC_RELAXED);
+    }
+    /// count of all allocations
+    std::size_t allocations() const {
+        return __atomic_load_n(&allocations_, __ATOMIC_RELAXED);
+    }
+    /// count of failed allocations
+    std::size_t failures() const {
+        return __atomic_load_n(&failures_, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Return first registered account of this process.
+     */
+    static Account_t *&first() {
+        static Account_t *__first = 0;
+        return __first;
+    }
+
+    /**
+     * @short Return next registered account.
+     */
+    Account_t *following() const { return next;}
+
+    /**
+     * @short Create account in shared memory and register it.
+     *
+     * Registry is process local list inherited by fork, create accounts
+     * before fork to see them in all processes.
+     *
+     * @param __name name of account.
+     * @param __quota max live bytes, 0 means unlimited.
+     * @return new account.
+     */
+    static Account_t *create(const char *__name, std::size_t __quota = 0) {
+        Account_t *__account = new (SHAlloc) Account_t(__name, __quota);
+        Account_t **__last = &first();
+        while (*__last) __last = &(*__last)->next;
+        *__last = __account;
+        return __account;
+    }
+
+private:
+    Account_t(const Account_t &);
+    Account_t &operator=(const Account_t &);
+
+    char name_[32];             //< name of account.
+    std::size_t bytes_;         //< live bytes.
+    std::size_t blocks_;        //< live blocks.
+    std::size_t peak_;          //< max of live bytes.
+    std::size_t allocations_;   //< count of all allocations.
+    std::size_t failures_;      //< count of failed allocations.
+    std::size_t quota_;         //< max live bytes.
+    Account_t *next;            //< next registered account.
+};
+
+/**
+ * @short Binds account to tag type.
+ *
+ * Tag is any (empty) type. Pointer is process local, set it before fork:
+ * @code
+ *     struct IndexTag {};
+ *     AccountOf_t<IndexTag>::account
+ *         = Account_t::create("index", 512 * 1024 * 1024);
+ * @endcode
+ */
+template <typename _Tag>
+struct AccountOf_t {
+    static Account_t *account;  //< account of tag.
+};
+
+template <typename _Tag>
+Account_t *AccountOf_t<_Tag>::account = 0;
+
+/**
+ * @short Allocator_t that charges every block to account of _Tag.
+ *
+ * Blocks over quota fail fast by std::bad_alloc (try_allocate() returns 0)
+ * before the pool is touched. Aligned allocations are charged too. If there
+ * is no account bound to tag, it works as Allocator_t.
+ */
+template <typename _Tp, typename _Tag>
+class AccountingAllocator_t: public Allocator_t<_Tp> {
+public:
+    /// parent typedef
+    typedef Allocator_t<_Tp> __parent;
+    /// pointer to value
+    typedef typename __parent::pointer pointer;
+    /// type of size
+    typedef typename __parent::size_type size_type;
+
+    // rebind allocator to type OtherType_t
+    template <class OtherType_t>
+    struct rebind {
+        typedef AccountingAllocator_t<OtherType_t, _Tag> other;
+    };
+
+    AccountingAllocator_t() throw() {}
+
+    AccountingAllocator_t(const AccountingAllocator_t &__other) throw()
+        : __parent(__other) {}
+
+    template <class OtherType_t>
+    AccountingAllocator_t(const AccountingAllocator_t<OtherType_t, _Tag> &)
+        throw() {}
+
+    /**
+     * @short Charge account and allocate num elements.
+     * @param num count of elements.
+     * @return pointer to new allocated memory
+     */
+    pointer allocate(size_type num, const void * = 0) {
+        size_type __bytes = ((num)? num: 1) * sizeof(_Tp);
+        Account_t *__account = AccountOf_t<_Tag>::account;
+        if (__account && !__account->charge(__bytes))
+            throw std::bad_alloc();
+        try {
+            return __parent::allocate(num);
+        } catch (...) {
+            if (__account) {
+                __account->uncharge(__bytes);
+                __account->failed();
+            }
+            throw;
+        }
+    }
+
+    /**
+     * @short Charge account and allocate num elements, don't throw.
+     * @param num count of elements.
+     * @return pointer to new allocated memory or 0.
+     */
+    pointer try_allocate(size_type num) throw() {
+        size_type __bytes = ((num)? num: 1) * sizeof(_Tp);
+        Account_t *__account = AccountOf_t<_Tag>::account;
+        if (__account && !__account->charge(__bytes))
+            return 0;
+        pointer __ret = __parent::try_allocate(num);
+        if (!__ret && __account) {
+            __account->uncharge(__bytes);
+            __account->failed();
+        }
+        return __ret;
+    }
+
+    /**
+     * @short Charge account and allocate num elements starting at align
+     * boundary.
+     * @param num count of elements.
+     * @param align alignment (power of two).
+     * @return pointer to new allocated memory.
+     */
+    pointer allocate_aligned(size_type num,
+                             std::size_t align = SHALLOCATOR_CACHE_LINE)
+    {
+        size_type __bytes = ((num)? num: 1) * sizeof(_Tp);
+        Account_t *__account = AccountOf_t<_Tag>::account;
+        if (__account && !__account->charge(__bytes))
+            throw std::bad_alloc();
+        try {
+            return __parent::allocate_aligned(num, align);
+        } catch (...) {
+            if (__account) {
+                __account->uncharge(__bytes);
+                __account->failed();
+            }
+            throw;
+        }
+    }
+
+    /**
+     * @short Deallocate and uncharge num elements.
+     * @param p deallocate mem at pointer.
+     * @param num count of objects.
+     */
+    void deallocate(pointer p, size_type num) {
+        __parent::deallocate(p, num);
+        if (Account_t *__account = AccountOf_t<_Tag>::account)
+            __account->uncharge(((num)? num: 1) * sizeof(_Tp));
+    }
+
+    /**
+     * @short Deallocate and uncharge storage from allocate_aligned().
+     * @param p deallocate mem at pointer.
+     * @param num count of objects.
+     * @param align alignment given to allocate_aligned().
+     */
+    void deallocate_aligned(pointer p, size_type num,
+                            std::size_t align = SHALLOCATOR_CACHE_LINE)
+    {
+        __parent::deallocate_aligned(p, num, align);
+        if (Account_t *__account = AccountOf_t<_Tag>::account)
+            __account->uncharge(((num)? num: 1) * sizeof(_Tp));
+    }
+};
+
+template <class T1_t, class T2_t, class _Tag>
+bool operator==(const AccountingAllocator_t<T1_t, _Tag> &,
+                const AccountingAllocator_t<T2_t, _Tag> &) throw()
+{
+    return true;
+}
+
+template <class T1_t, class T2_t, class _Tag>
+bool operator!=(const AccountingAllocator_t<T1_t, _Tag> &,
+                const AccountingAllocator_t<T2_t, _Tag> &) throw()
+{
+    return false;
+}
+
+/**
+ * @short Shared memory map charged to account of _Tag.
+ */
+template <typename _Key, typename _Tp, typename _Tag,
+          typename _Compare = std::less<_Key> >
+class shaccounted_map: public std::map<_Key, _Tp, _Compare,
+        AccountingAllocator_t<std::pair<const _Key, _Tp>, _Tag> > {
+public:
+    /// allocator typedef
+    typedef AccountingAllocator_t<std::pair<const _Key, _Tp>, _Tag>
+        AllocatorType_t;
+    /// parent typedef
+    typedef std::map<_Key, _Tp, _Compare, AllocatorType_t> __parent;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    shaccounted_map(const _Compare &__comp = _Compare())
+        : __parent(__comp, AllocatorType_t()) {}
+
+    /**
+     * @short Builds a %shaccounted_map from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shaccounted_map(_InputIterator __first, _InputIterator __last,
+                    const _Compare &__comp = _Compare())
+        : __parent(__first, __last, __comp, AllocatorType_t()) {}
+};
+
+/**
+ * @short Shared memory set charged to account of _Tag.
+ */
+template <typename _Key, typename _Tag, typename _Compare = std::less<_Key> >
+class shaccounted_set: public std::set<_Key, _Compare,
+        AccountingAllocator_t<_Key, _Tag> > {
+public:
+    /// allocator typedef
+    typedef AccountingAllocator_t<_Key, _Tag> AllocatorType_t;
+    /// parent typedef
+    typedef std::set<_Key, _Compare, AllocatorType_t> __parent;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    shaccounted_set(const _Compare &__comp = _Compare())
+        : __parent(__comp, AllocatorType_t()) {}
+
+    /**
+     * @short Builds a %shaccounted_set from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shaccounted_set(_InputIterator __first, _InputIterator __last,
+                    const _Compare &__comp = _Compare())
+        : __parent(__first, __last, __comp, AllocatorType_t()) {}
+};
+
+/**
+ * @short Shared memory vector charged to account of _Tag.
+ */
+template <typename _Tp, typename _Tag>
+class shaccounted_vector: public std::vector<_Tp,
+        AccountingAllocator_t<_Tp, _Tag> > {
+public:
+    /// allocator typedef
+    typedef AccountingAllocator_t<_Tp, _Tag> AllocatorType_t;
+    /// parent typedef
+    typedef std::vector<_Tp, AllocatorType_t> __parent;
+    /// type of size
+    typedef typename __parent::size_type size_type;
+    /// type of value
+    typedef typename __parent::value_type value_type;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shaccounted_vector(): __parent(AllocatorType_t()) {}
+
+    /**
+     * @short Create a %shaccounted_vector with copies of an exemplar
+     * element.
+     * @param __n The number of elements to initially create.
+     * @param __value An element to copy.
+     */
+    shaccounted_vector(size_type __n, const value_type &__value = value_type())
+        : __parent(__n, __value, AllocatorType_t()) {}
+
+    /**
+     * @short Builds a %shaccounted_vector from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shaccounted_vector(_InputIterator __first, _InputIterator __last)
+        : __parent(__first, __last, AllocatorType_t()) {}
+};
+
+/**
+ * @short Shared memory list charged to account of _Tag.
+ */
+template <typename _Tp, typename _Tag>
+class shaccounted_list: public std::list<_Tp,
+        AccountingAllocator_t<_Tp, _Tag> > {
+public:
+    /// allocator typedef
+    typedef AccountingAllocator_t<_Tp, _Tag> AllocatorType_t;
+    /// parent typedef
+    typedef std::list<_Tp, AllocatorType_t> __parent;
+    /// type of size
+    typedef typename __parent::size_type size_type;
+    /// type of value
+    typedef typename __parent::value_type value_type;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shaccounted_list(): __parent(AllocatorType_t()) {}
+
+    /**
+     * @short Create a %shaccounted_list with copies of an exemplar element.
+     * @param __n The number of elements to initially create.
+     * @param __value An element to copy.
+     */
+    shaccounted_list(size_type __n, const value_type &__value = value_type())
+        : __parent(__n, __value, AllocatorType_t()) {}
+
+    /**
+     * @short Builds a %shaccounted_list from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shaccounted_list(_InputIterator __first, _InputIterator __last)
+        : __parent(__first, __last, AllocatorType_t()) {}
+};
+
+/**
+ * @short Shared memory string charged to account of _Tag.
+ */
+template <typename _Tag>
+class shaccounted_string: public std::basic_string<char,
+        std::char_traits<char>, AccountingAllocator_t<char, _Tag> > {
+public:
+    /// allocator typedef
+    typedef AccountingAllocator_t<char, _Tag> AllocatorType_t;
+    /// parent typedef
+    typedef std::basic_string<char, std::char_traits<char>, AllocatorType_t>
+        __parent;
+    /// type of size
+    typedef typename __parent::size_type size_type;
+
+    /**
+     * @short Default constructor creates an empty string.
+     */
+    shaccounted_string(): __parent(AllocatorType_t()) {}
+
+    /**
+     * @short Construct %shaccounted_string as copy of a std::string.
+     * @param __str Source string.
+     */
+    shaccounted_string(const std::string &__str)
+        : __parent(__str.data(), __str.size(), AllocatorType_t()) {}
+
+    /**
+     * @short Construct %shaccounted_string as copy of a C string.
+     * @param __s Source C string.
+     */
+    shaccounted_string(const char *__s): __parent(__s, AllocatorType_t()) {}
+
+    /**
+     * @short Construct %shaccounted_string as multiple characters.
+     * @param __n Number of characters.
+     * @param __c Character to use.
+     */
+    shaccounted_string(size_type __n, char __c)
+        : __parent(__n, __c, AllocatorType_t()) {}
+
+    /**
+     * @short Construct %shaccounted_string as copy of a range.
+     * @param __beg Start of range.
+     * @param __end End of range.
+     */
+    template <class _InputIterator>
+    shaccounted_string(_InputIterator __beg, _InputIterator __end)
+        : __parent(__beg, __end, AllocatorType_t()) {}
+};
+
+}
+
+#endif /* SHALLOCATOR_SHACCOUNT_H */
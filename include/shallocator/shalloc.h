@@ -21,14 +21,216 @@
 #define SHALLOCATOR_SHALLOC_H
 
 #include <mm.h>
+#include <new>
 #include <stdexcept>
 
 #ifdef DEBUG
 #include <iostream>
 #endif
 
+/**
+ * @short Size of CPU cache line, shared objects updated by more processes
+ * are padded to it.
+ */
+#ifndef SHALLOCATOR_CACHE_LINE
+#define SHALLOCATOR_CACHE_LINE 64
+#endif
+
 namespace SHAllocator {
 
+/**
+ * @short Bounds of large allocation area (see shlarge.h). All members are
+ * zero while the area is not created.
+ */
+struct LargeAreaInfo_t {
+    char *begin;            //< first byte of area.
+    char *end;              //< byte after area.
+    std::size_t threshold;  //< blocks of this size and bigger go to area.
+};
+
+/**
+ * @short Large allocation area of this process (inherited by fork).
+ */
+extern LargeAreaInfo_t SHLargeArea;
+
+/**
+ * @short Alloc block from large allocation area.
+ * @param size size of block.
+ * @return pointer to block or 0 if there is no space.
+ */
+void *large_allocate(std::size_t size);
+
+/**
+ * @short Return block to large allocation area and its pages to the OS.
+ * @param ptr pointer to block from large_allocate().
+ */
+void large_deallocate(void *ptr);
+
+/**
+ * @short Bounds of writable memfd pool attached to this process (see
+ * shmemfd.h). All members are zero while there is no such pool.
+ */
+struct MemfdPoolInfo_t {
+    char *begin;            //< first byte of pool mapping.
+    char *end;              //< byte after pool mapping.
+    bool writable;          //< pool is neither read only nor frozen.
+};
+
+/**
+ * @short Memfd pool of this process.
+ */
+extern MemfdPoolInfo_t SHMemfdPool;
+
+/**
+ * @short Alloc block from memfd pool.
+ * @param size size of block.
+ * @return pointer to block or 0 if there is no space or pool is read only
+ * or frozen (SHMemfdPool.writable is cleared then).
+ */
+void *memfd_allocate(std::size_t size);
+
+/**
+ * @short Return block to memfd pool. Blocks of read only or frozen pool
+ * are not freed, they are counted in memfd_pool_stats().ignored_frees.
+ * @param ptr pointer to block from memfd_allocate().
+ */
+void memfd_deallocate(void *ptr);
+
+/**
+ * @short Memory pressure checking of this process (see shpressure.h).
+ */
+struct PressureInfo_t {
+    unsigned check_every;   //< check pool usage every n-th alloc, 0 = off.
+    unsigned countdown;     //< allocs to next check.
+};
+
+/**
+ * @short Memory pressure checking of this process.
+ */
+extern PressureInfo_t SHPressure;
+
+/**
+ * @short Check pool usage, fire callbacks and retry failed alloc.
+ * @param ptr result of libmm alloc (0 if failed).
+ * @param size size of block.
+ * @return pointer to block or 0.
+ */
+void *pressure_allocate(void *ptr, std::size_t size);
+
+/**
+ * @short Events reported to allocation hook.
+ */
+enum AllocEvent_t {
+    ALLOC_EVENT_ALLOC,      //< block has been allocated.
+    ALLOC_EVENT_FREE,       //< block has been freed.
+    ALLOC_EVENT_FAIL        //< allocation failed.
+};
+
+/**
+ * @short Allocation hook (e.g. statistics, see shmetrics.h).
+ * @param event event.
+ * @param ptr block (0 for failure).
+ * @param size requested size (0 for free).
+ */
+typedef void (*AllocHook_t)(AllocEvent_t event, void *ptr, std::size_t size);
+
+/**
+ * @short Allocation hook of this process, 0 if there is none.
+ */
+extern AllocHook_t SHAllocHook;
+
+/**
+ * @short Alloc raw shared memory. Big blocks go to the large allocation
+ * area if there is one, everything else (and big blocks that don't fit
+ * there) to memfd pool if process has writable one, blocks that don't fit
+ * there either (or all if there is no writable pool) to libmm.
+ * @param size size of block.
+ * @return pointer to block or 0.
+ */
+inline void *shmalloc(std::size_t size) {
+    void *ret = 0;
+    if (SHLargeArea.threshold && (size >= SHLargeArea.threshold))
+        ret = large_allocate(size);
+    if (!ret && SHMemfdPool.writable)
+        ret = memfd_allocate(size);
+    // full, read only or frozen memfd pool falls back to libmm
+    if (!ret) {
+        ret = MM_malloc(size);
+        if (SHPressure.check_every && (!ret || !--SHPressure.countdown))
+            ret = pressure_allocate(ret, size);
+    }
+    if (SHAllocHook)
+        SHAllocHook(ret? ALLOC_EVENT_ALLOC: ALLOC_EVENT_FAIL, ret, size);
+    return ret;
+}
+
+/**
+ * @short Free raw shared memory alloced by shmalloc().
+ * @param ptr pointer to block.
+ */
+inline void shfree(void *ptr) {
+    if (SHAllocHook && ptr) SHAllocHook(ALLOC_EVENT_FREE, ptr, 0);
+    if (((char *)ptr >= SHLargeArea.begin) && ((char *)ptr < SHLargeArea.end))
+        large_deallocate(ptr);
+    else if (((char *)ptr >= SHMemfdPool.begin)
+             && ((char *)ptr < SHMemfdPool.end))
+        memfd_deallocate(ptr);
+    else
+        MM_free(ptr);
+}
+
+/**
+ * @short Alignment of blocks from shmalloc() (libmm aligns to 16 bytes).
+ */
+#ifndef SHALLOCATOR_MALLOC_ALIGN
+#define SHALLOCATOR_MALLOC_ALIGN 16
+#endif
+
+/**
+ * @short Alloc raw shared memory aligned to align bytes. Block aligned
+ * above SHALLOCATOR_MALLOC_ALIGN keeps pointer to underlying block just
+ * before itself.
+ * @param size size of block.
+ * @param align alignment (power of two).
+ * @return pointer to block or 0.
+ */
+inline void *shmalloc_aligned(std::size_t size, std::size_t align) {
+    if (align <= SHALLOCATOR_MALLOC_ALIGN) return shmalloc(size);
+    char *raw = static_cast<char *>(shmalloc(size + align + sizeof(void *)));
+    if (!raw) return 0;
+    std::size_t addr = reinterpret_cast<std::size_t>(raw + sizeof(void *));
+    void **ret = reinterpret_cast<void **>((addr + align - 1) & ~(align - 1));
+    ret[-1] = raw;
+    return ret;
+}
+
+/**
+ * @short Free raw shared memory alloced by shmalloc_aligned().
+ * @param ptr pointer to block.
+ * @param align alignment given to shmalloc_aligned().
+ */
+inline void shfree_aligned(void *ptr, std::size_t align) {
+    if (ptr && (align > SHALLOCATOR_MALLOC_ALIGN))
+        ptr = static_cast<void **>(ptr)[-1];
+    shfree(ptr);
+}
+
+/**
+ * @short Alignment that new (SHAlloc) uses for type: alignment of
+ * over-aligned types under C++17 aligned new, 0 (default) otherwise.
+ * Allocator_t uses the same so destroy() can free objects from both.
+ */
+template <class Type_t>
+struct NewAlign_t {
+#ifdef __cpp_aligned_new
+    static const std::size_t value
+        = (__alignof__(Type_t) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)?
+          __alignof__(Type_t): 0;
+#else
+    static const std::size_t value = 0;
+#endif
+};
+
 /**
  * @short STL allocator class implemented via libmm Global API.
  */
@@ -111,7 +313,9 @@ public:
      */
     pointer allocate(size_type num, const void * = 0) {
         // alloc
-        pointer ret = (pointer) MM_malloc(((num)? num: 1) * sizeof(value_type));
+        pointer ret = (pointer) shmalloc_aligned(
+                ((num)? num: 1) * sizeof(value_type),
+                NewAlign_t<value_type>::value);
 
 #ifdef DEBUG
         std::cout << "Alloc: " << num << "x" << sizeof(value_type)
@@ -124,6 +328,48 @@ public:
         return ret;
     }
 
+    /**
+     * @short Allocate but don't initialize num elements, don't throw.
+     * @param num count of elements.
+     * @return pointer to new allocated memory or 0.
+     */
+    pointer try_allocate(size_type num) throw() {
+        return (pointer) shmalloc_aligned(
+                ((num)? num: 1) * sizeof(value_type),
+                NewAlign_t<value_type>::value);
+    }
+
+    /**
+     * @short Allocate num elements starting at align boundary, e.g. at
+     * cache line so that they don't share it with other objects.
+     * @param num count of elements.
+     * @param align alignment (power of two).
+     * @return pointer to new allocated memory.
+     */
+    pointer allocate_aligned(size_type num,
+                             std::size_t align = SHALLOCATOR_CACHE_LINE)
+    {
+        if (align < __alignof__(value_type)) align = __alignof__(value_type);
+        pointer ret = (pointer) shmalloc_aligned(
+                ((num)? num: 1) * sizeof(value_type), align);
+        if (!ret)
+            throw std::bad_alloc();
+        return ret;
+    }
+
+    /**
+     * @short Deallocate storage from allocate_aligned().
+     * @param p deallocate mem at pointer.
+     * @param num count of objects.
+     * @param align alignment given to allocate_aligned().
+     */
+    void deallocate_aligned(pointer p, size_type /*num*/,
+                            std::size_t align = SHALLOCATOR_CACHE_LINE)
+    {
+        if (align < __alignof__(value_type)) align = __alignof__(value_type);
+        shfree_aligned((void *)p, align);
+    }
+
     /**
      * @short Initialize elements of allocated storage p with value value.
      * @param p pointer to memory.
@@ -151,7 +397,7 @@ public:
             << " bytes  at " << (void *)p << std::endl;
 #endif
 
-        MM_free((void *)p);
+        shfree_aligned((void *)p, NewAlign_t<value_type>::value);
     }
 };
 
@@ -214,7 +460,7 @@ extern SHAlloc_t *SHAlloc;
  */
 inline void *operator new(std::size_t size, SHAllocator::SHAlloc_t *) {
     // alloc
-    void *ret = (void *) MM_malloc(size);
+    void *ret = SHAllocator::shmalloc(size);
 
 #ifdef DEBUG
    std::cout << "GAlloc: " << "1x" << size
@@ -235,7 +481,7 @@ inline void *operator new(std::size_t size, SHAllocator::SHAlloc_t *) {
  */
 inline void *operator new[](std::size_t size, SHAllocator::SHAlloc_t *) {
     // alloc
-    void *ret = (void *) MM_malloc(size);
+    void *ret = SHAllocator::shmalloc(size);
 
 #ifdef DEBUG
     std::cout << "GAlloc: " << "1x" << size
@@ -248,6 +494,125 @@ inline void *operator new[](std::size_t size, SHAllocator::SHAlloc_t *) {
     return ret;
 }
 
+#ifdef __cpp_aligned_new
+/**
+ * @short Placement new operator for over-aligned types (picked by compiler
+ * for types aligned above __STDCPP_DEFAULT_NEW_ALIGNMENT__ or explicitly).
+ * @param size size of allocated object.
+ * @param align alignment of object.
+ * @param shalloc fake pointer for choosing this new.
+ * @return pointer to alloc memory.
+ */
+inline void *operator new(std::size_t size, std::align_val_t align,
+                          SHAllocator::SHAlloc_t *)
+{
+    void *ret = SHAllocator::shmalloc_aligned(size, std::size_t(align));
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+/**
+ * @short Array placement new operator for over-aligned types.
+ * @param size size of allocated object.
+ * @param align alignment of object.
+ * @param shalloc fake pointer for choosing this new.
+ * @return pointer to alloc memory.
+ */
+inline void *operator new[](std::size_t size, std::align_val_t align,
+                            SHAllocator::SHAlloc_t *)
+{
+    void *ret = SHAllocator::shmalloc_aligned(size, std::size_t(align));
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+/**
+ * @short Placement delete operator for over-aligned types.
+ * @param __p pointer to delete object
+ * @param align alignment of object.
+ */
+inline void operator delete(void *__p, std::align_val_t align,
+                            SHAllocator::SHAlloc_t *) throw()
+{
+    SHAllocator::shfree_aligned(__p, std::size_t(align));
+}
+
+/**
+ * @short Array placement delete operator for over-aligned types.
+ * @param __p pointer to delete object
+ * @param align alignment of object.
+ */
+inline void operator delete[](void *__p, std::align_val_t align,
+                              SHAllocator::SHAlloc_t *) throw()
+{
+    SHAllocator::shfree_aligned(__p, std::size_t(align));
+}
+
+/**
+ * @short Plain placement new of over-aligned types. Without it gcc picks
+ * SHAlloc_t* overload above for new (void *) of over-aligned type (e.g.
+ * in construct() of allocators) and fails on pointer conversion.
+ * @param size size of object.
+ * @param align alignment of object.
+ * @param __p storage for object.
+ * @return __p.
+ */
+inline void *operator new(std::size_t, std::align_val_t, void *__p) throw() {
+    return __p;
+}
+
+/**
+ * @short Plain placement delete of over-aligned types, does nothing.
+ */
+inline void operator delete(void *, std::align_val_t, void *) throw() {}
+#endif /* __cpp_aligned_new */
+
+/**
+ * @short Placement new operator that returns 0 instead of throwing.
+ * @param size size of allocated object.
+ * @param shalloc fake pointer for choosing this new.
+ * @return pointer to alloc memory or 0.
+ */
+inline void *operator new(std::size_t size, SHAllocator::SHAlloc_t *,
+                          const std::nothrow_t &) throw()
+{
+    return SHAllocator::shmalloc(size);
+}
+
+/**
+ * @short Array placement new operator that returns 0 instead of throwing.
+ * @param size size of allocated object.
+ * @param shalloc fake pointer for choosing this new.
+ * @return pointer to alloc memory or 0.
+ */
+inline void *operator new[](std::size_t size, SHAllocator::SHAlloc_t *,
+                            const std::nothrow_t &) throw()
+{
+    return SHAllocator::shmalloc(size);
+}
+
+/**
+ * @short Placement delete operator for nothrow new.
+ * @param __p pointer to delete object
+ */
+inline void operator delete(void *__p, SHAllocator::SHAlloc_t *,
+                            const std::nothrow_t &) throw()
+{
+    SHAllocator::shfree(__p);
+}
+
+/**
+ * @short Array placement delete operator for nothrow new.
+ * @param __p pointer to delete object
+ */
+inline void operator delete[](void *__p, SHAllocator::SHAlloc_t *,
+                              const std::nothrow_t &) throw()
+{
+    SHAllocator::shfree(__p);
+}
+
 /** 
  * @short Array placement delete operator.
  * @param __p pointer to delete object
@@ -256,7 +621,7 @@ inline void operator delete(void *__p, SHAllocator::SHAlloc_t *) throw() {
 #ifdef DEBUG
     std::cout << "GDeAlloc: " << (void *)__p << std::endl;
 #endif
-    MM_free((void *)__p);
+    SHAllocator::shfree((void *)__p);
 }
 
 /** 
@@ -267,7 +632,7 @@ inline void operator delete[](void *__p, SHAllocator::SHAlloc_t *) throw() {
 #ifdef DEBUG
     std::cout << "GDeAlloc: " << (void *)__p << std::endl;
 #endif
-    MM_free((void *)__p);
+    SHAllocator::shfree((void *)__p);
 }
 
 #endif /* SHALLOCATOR_SHALLOC_H */
@@ -0,0 +1,403 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Interned shared memory strings.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHATOM_H
+#define SHALLOCATOR_SHATOM_H
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+#include <shallocator/shmutex.h>
+#include <shallocator/shhash.h>
+
+namespace SHAllocator {
+
+class shatom_table;
+
+/**
+ * @short Interned string as stored in table (one block with its chars).
+ */
+struct AtomEntry_t {
+    AtomEntry_t *next;      //< next entry in bucket.
+    std::size_t hash;       //< hash of string.
+    uint32_t refs;          //< reference count (refcounted table only).
+    uint32_t size;          //< length of string.
+    char data[1];           //< zero terminated string.
+};
+
+/**
+ * @short Handle of interned string.
+ *
+ * It is one pointer wide, trivially copyable and it can be stored in other
+ * shared containers instead of %shstring. Atoms from one table are equal
+ * if and only if their handles are equal, so comparison is O(1).
+ */
+class shatom {
+public:
+    /**
+     * @short Create null atom.
+     */
+    shatom(): entry(0) {}
+
+    /**
+     * @short Return pointer to zero terminated string.
+     */
+    const char *c_str() const { return entry? entry->data: "";}
+
+    /**
+     * @short Return pointer to chars.
+     */
+    const char *data() const { return c_str();}
+
+    /**
+     * @short Return length of string.
+     */
+    std::size_t size() const { return entry? entry->size: 0;}
+
+    /**
+     * @short Return true if atom is null or empty string.
+     */
+    bool empty() const { return !size();}
+
+    /**
+     * @short Return true if atom is null.
+     */
+    bool null() const { return !entry;}
+
+    /**
+     * @short Return precomputed hash of string.
+     */
+    std::size_t hash() const { return entry? entry->hash: 0;}
+
+    /**
+     * @short Return copy of string.
+     */
+    std::string str() const { return std::string(c_str(), size());}
+
+    /**
+     * @short Compare strings lexicographically (operator< orders handles).
+     * @param __other other atom.
+     * @return <0, 0 or >0 like strcmp.
+     */
+    int compare(const shatom &__other) const {
+        if (entry == __other.entry) return 0;
+        std::size_t __n = std::min(size(), __other.size());
+        int __res = std::memcmp(c_str(), __other.c_str(), __n);
+        if (__res) return __res;
+        return (size() < __other.size())? -1: (size() > __other.size());
+    }
+
+    bool operator==(const shatom &__other) const {
+        return entry == __other.entry;
+    }
+
+    bool operator!=(const shatom &__other) const {
+        return entry != __other.entry;
+    }
+
+    /**
+     * @short Order by handle, fast but not alphabetical (see compare()).
+     */
+    bool operator<(const shatom &__other) const {
+        return entry < __other.entry;
+    }
+
+private:
+    explicit shatom(const AtomEntry_t *__entry): entry(__entry) {}
+
+    friend class shatom_table;
+
+    const AtomEntry_t *entry;   //< interned string.
+};
+
+/**
+ * @short Hash functor for atoms.
+ */
+template <>
+struct shhash<shatom> {
+    std::size_t operator()(const shatom &__atom) const {
+        return __atom.hash();
+    }
+};
+
+/**
+ * @short Shared table of interned strings.
+ *
+ * Each distinct string is stored once. In arena mode (default) strings
+ * live until table is cleared or destroyed. In refcounted mode every
+ * intern() must be paired with release() and string is freed when last
+ * reference is released.
+ *
+ * Lookups of already interned strings take only read lock.
+ */
+class shatom_table {
+public:
+    /// type of size
+    typedef std::size_t size_type;
+
+    /**
+     * @short Create empty table.
+     * @param __refcounted free strings when not referenced.
+     * @param __buckets initial count of buckets.
+     */
+    explicit
+    shatom_table(bool __refcounted = false, size_type __buckets = 1024)
+        : buckets(0), mask(0), count(0), bytes(0), refcounted(__refcounted)
+    {
+        size_type __n = 16;
+        while (__n < __buckets) __n <<= 1;
+        buckets = new_buckets(__n);
+        mask = __n - 1;
+    }
+
+    /**
+     * @short Free all strings.
+     */
+    ~shatom_table() {
+        clear();
+        Allocator_t<AtomEntry_t *>().deallocate(buckets, mask + 1);
+    }
+
+    /**
+     * @short Intern string.
+     * @param __str string.
+     * @param __size length of string.
+     * @return atom.
+     */
+    shatom intern(const char *__str, size_type __size) {
+        size_type __h = static_cast<size_type>(hash_bytes(__str, __size));
+        {
+            SharedLock_t<RWLock_t> __lock(lock);
+            AtomEntry_t *__entry = lookup(__str, __size, __h);
+            if (__entry) {
+                if (refcounted)
+                    __atomic_fetch_add(&__entry->refs, 1, __ATOMIC_RELAXED);
+                return shatom(__entry);
+            }
+        }
+
+        ScopedLock_t<RWLock_t> __lock(lock);
+        AtomEntry_t *__entry = lookup(__str, __size, __h);
+        if (__entry) {
+            if (refcounted)
+                __atomic_fetch_add(&__entry->refs, 1, __ATOMIC_RELAXED);
+            return shatom(__entry);
+        }
+
+        // new string
+        if (count >= mask + 1) rehash(2 * (mask + 1));
+        size_type __block = block_size(__size);
+        __entry = reinterpret_cast<AtomEntry_t *>(
+                Allocator_t<char>().allocate(__block));
+        __entry->hash = __h;
+        __entry->refs = 1;
+        __entry->size = static_cast<uint32_t>(__size);
+        std::memcpy(__entry->data, __str, __size);
+        __entry->data[__size] = 0;
+        __entry->next = buckets[__h & mask];
+        buckets[__h & mask] = __entry;
+        ++count;
+        bytes += __block;
+        return shatom(__entry);
+    }
+
+    /**
+     * @short Intern zero terminated string.
+     */
+    shatom intern(const char *__str) {
+        return intern(__str, std::strlen(__str));
+    }
+
+    /**
+     * @short Intern string (std::string, %shstring, ...).
+     */
+    template <typename _Traits, typename _Alloc>
+    shatom intern(const std::basic_string<char, _Traits, _Alloc> &__str) {
+        return intern(__str.data(), __str.size());
+    }
+
+    /**
+     * @short Find already interned string, don't intern it.
+     * @param __str string.
+     * @param __size length of string.
+     * @return atom or null atom if not found (no reference is taken).
+     */
+    shatom find(const char *__str, size_type __size) const {
+        size_type __h = static_cast<size_type>(hash_bytes(__str, __size));
+        SharedLock_t<RWLock_t> __lock(lock);
+        return shatom(lookup(__str, __size, __h));
+    }
+
+    /**
+     * @short Find already interned string (std::string, %shstring, ...).
+     */
+    template <typename _Traits, typename _Alloc>
+    shatom find(const std::basic_string<char, _Traits, _Alloc> &__str) const {
+        return find(__str.data(), __str.size());
+    }
+
+    /**
+     * @short Take another reference of atom (refcounted table only).
+     * @param __atom atom.
+     * @return the same atom.
+     */
+    shatom acquire(const shatom &__atom) {
+        if (refcounted && __atom.entry)
+            __atomic_fetch_add(&entry_of(__atom)->refs, 1, __ATOMIC_RELAXED);
+        return __atom;
+    }
+
+    /**
+     * @short Release reference of atom, string is freed when last reference
+     * is released. Noop in arena mode.
+     * @param __atom atom.
+     */
+    void release(const shatom &__atom) {
+        if (!refcounted || !__atom.entry) return;
+        AtomEntry_t *__entry = entry_of(__atom);
+
+        // not last reference, entry can't be freed under our hands because
+        // it's freed only under write lock by the one who drops last ref
+        uint32_t __refs = __atomic_load_n(&__entry->refs, __ATOMIC_RELAXED);
+        while (__refs > 1)
+            if (__atomic_compare_exchange_n(&__entry->refs, &__refs,
+                        __refs - 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                return;
+
+        ScopedLock_t<RWLock_t> __lock(lock);
+        if (__atomic_sub_fetch(&__entry->refs, 1, __ATOMIC_ACQ_REL)) return;
+        AtomEntry_t **__link = buckets + (__entry->hash & mask);
+        while (*__link != __entry) __link = &(*__link)->next;
+        *__link = __entry->next;
+        --count;
+        bytes -= block_size(__entry->size);
+        free_entry(__entry);
+    }
+
+    /**
+     * @short Free all strings, all atoms become invalid.
+     */
+    void clear() {
+        ScopedLock_t<RWLock_t> __lock(lock);
+        for (size_type __i = 0; __i <= mask; ++__i) {
+            while (AtomEntry_t *__entry = buckets[__i]) {
+                buckets[__i] = __entry->next;
+                free_entry(__entry);
+            }
+        }
+        count = 0;
+        bytes = 0;
+    }
+
+    /**
+     * @short Return count of distinct strings.
+     */
+    size_type size() const {
+        SharedLock_t<RWLock_t> __lock(lock);
+        return count;
+    }
+
+    /**
+     * @short Return bytes allocated for strings (without bucket array).
+     */
+    size_type allocated() const {
+        SharedLock_t<RWLock_t> __lock(lock);
+        return bytes;
+    }
+
+private:
+    shatom_table(const shatom_table &);
+    shatom_table &operator=(const shatom_table &);
+
+    /**
+     * @short Size of block holding string of given length.
+     */
+    static size_type block_size(size_type __size) {
+        return offsetof(AtomEntry_t, data) + __size + 1;
+    }
+
+    /**
+     * @short Return writable entry of atom created by this table.
+     */
+    static AtomEntry_t *entry_of(const shatom &__atom) {
+        return const_cast<AtomEntry_t *>(__atom.entry);
+    }
+
+    /**
+     * @short Allocate zeroed bucket array.
+     */
+    static AtomEntry_t **new_buckets(size_type __n) {
+        AtomEntry_t **__buckets = Allocator_t<AtomEntry_t *>().allocate(__n);
+        for (size_type __i = 0; __i < __n; ++__i) __buckets[__i] = 0;
+        return __buckets;
+    }
+
+    /**
+     * @short Free entry block.
+     */
+    static void free_entry(AtomEntry_t *__entry) {
+        Allocator_t<char>().deallocate(reinterpret_cast<char *>(__entry),
+                                       block_size(__entry->size));
+    }
+
+    /**
+     * @short Find entry, lock must be held.
+     */
+    AtomEntry_t *lookup(const char *__str, size_type __size,
+                        size_type __h) const
+    {
+        for (AtomEntry_t *__entry = buckets[__h & mask]; __entry;
+                __entry = __entry->next)
+            if ((__entry->hash == __h) && (__entry->size == __size)
+                    && !std::memcmp(__entry->data, __str, __size))
+                return __entry;
+        return 0;
+    }
+
+    /**
+     * @short Resize bucket array, write lock must be held.
+     */
+    void rehash(size_type __n) {
+        AtomEntry_t **__buckets = new_buckets(__n);
+        for (size_type __i = 0; __i <= mask; ++__i) {
+            while (AtomEntry_t *__entry = buckets[__i]) {
+                buckets[__i] = __entry->next;
+                __entry->next = __buckets[__entry->hash & (__n - 1)];
+                __buckets[__entry->hash & (__n - 1)] = __entry;
+            }
+        }
+        Allocator_t<AtomEntry_t *>().deallocate(buckets, mask + 1);
+        buckets = __buckets;
+        mask = __n - 1;
+    }
+
+    mutable RWLock_t lock;      //< table lock.
+    AtomEntry_t **buckets;      //< bucket array.
+    size_type mask;             //< count of buckets - 1.
+    size_type count;            //< count of strings.
+    size_type bytes;            //< bytes allocated for strings.
+    bool refcounted;            //< free unreferenced strings.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHATOM_H */
@@ -1,7 +1,7 @@
 /*
  * FILE             $Id$
  *
- * DESCRIPTION      Shared memory STL bitset.
+ * DESCRIPTION      Shared memory dynamic bitset.
  *
  * PROJECT          Shared memory STL allocator.
  *
@@ -15,14 +15,554 @@
  * HISTORY
  *       2007-04-27 (bukovsky)
  *                  First draft.
+ *       2026-10-19 (bukovsky)
+ *                  Dynamic bitset with vectorized set operations.
  */
 
 #ifndef SHALLOCATOR_SHBITSET_H
 #define SHALLOCATOR_SHBITSET_H
 
-// std::bitset is strange. They dont use allocator as other containers.
-// If you need it, write and try it.
-#error std::bitset is not supported by SHAllocator library.
+#include <stdint.h>
+#include <cstring>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shsimd.h>
 
-#endif /* SHALLOCATOR_SHBITSET_H */
+// std::bitset is strange. They dont use allocator as other containers,
+// so there is shdynamic_bitset with words allocated in shared memory.
+
+namespace SHAllocator {
+
+/**
+ * @short Word kernels of %shdynamic_bitset.
+ */
+struct BitsetKernels_t {
+    /// operation between two bitsets
+    enum Op_t { AND, OR, XOR, ANDNOT };
+
+    /**
+     * @short dst = dst op src for n words.
+     */
+    static void apply(Op_t __op, uint64_t *__dst, const uint64_t *__src,
+                      std::size_t __n)
+    {
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) {
+            switch (__op) {
+            case AND: apply_avx2<AND>(__dst, __src, __n); return;
+            case OR: apply_avx2<OR>(__dst, __src, __n); return;
+            case XOR: apply_avx2<XOR>(__dst, __src, __n); return;
+            case ANDNOT: apply_avx2<ANDNOT>(__dst, __src, __n); return;
+            }
+        }
+#endif
+        switch (__op) {
+        case AND: apply_generic<AND>(__dst, __src, __n); return;
+        case OR: apply_generic<OR>(__dst, __src, __n); return;
+        case XOR: apply_generic<XOR>(__dst, __src, __n); return;
+        case ANDNOT: apply_generic<ANDNOT>(__dst, __src, __n); return;
+        }
+    }
+
+    /**
+     * @short Count set bits in n words, optionally of (a & b).
+     */
+    static std::size_t count(const uint64_t *__a, const uint64_t *__b,
+                             std::size_t __n)
+    {
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_popcnt()) return count_popcnt(__a, __b, __n);
+#endif
+        std::size_t __count = 0;
+        for (std::size_t __i = 0; __i < __n; ++__i)
+            __count += static_cast<std::size_t>(
+                    __builtin_popcountll(__b? __a[__i] & __b[__i]: __a[__i]));
+        return __count;
+    }
+
+private:
+// a = a op b, works for words and vectors of words; vector operands are
+// not passed to template function because it would drop their alignment.
+#define SHALLOCATOR_BITSET_OP(_Op, __a, __b)             \
+    switch (_Op) {                                      \
+    case AND: (__a) &= (__b); break;                    \
+    case OR: (__a) |= (__b); break;                     \
+    case XOR: (__a) ^= (__b); break;                    \
+    default: (__a) &= ~(__b); break;                    \
+    }
+
+    /**
+     * @short Two words at once, SSE2 is baseline of x86_64, other
+     * platforms get scalar code from vector extensions.
+     */
+    template <int _Op>
+    static void apply_generic(uint64_t *__dst, const uint64_t *__src,
+                              std::size_t __n)
+    {
+        typedef uint64_t v2_t __attribute__((vector_size(16), aligned(8)));
+        std::size_t __i = 0;
+        for (; __i + 2 <= __n; __i += 2) {
+            v2_t __a = *reinterpret_cast<const v2_t *>(__dst + __i);
+            v2_t __b = *reinterpret_cast<const v2_t *>(__src + __i);
+            SHALLOCATOR_BITSET_OP(_Op, __a, __b);
+            *reinterpret_cast<v2_t *>(__dst + __i) = __a;
+        }
+        for (; __i < __n; ++__i) {
+            SHALLOCATOR_BITSET_OP(_Op, __dst[__i], __src[__i]);
+        }
+    }
+
+#ifdef SHALLOCATOR_X86_SIMD
+    /**
+     * @short Eight words per iteration (two AVX2 registers).
+     */
+    template <int _Op>
+    __attribute__((target("avx2")))
+    static void apply_avx2(uint64_t *__dst, const uint64_t *__src,
+                           std::size_t __n)
+    {
+        typedef uint64_t v4_t __attribute__((vector_size(32), aligned(8)));
+        std::size_t __i = 0;
+        for (; __i + 8 <= __n; __i += 8) {
+            v4_t __a0 = *reinterpret_cast<const v4_t *>(__dst + __i);
+            v4_t __a1 = *reinterpret_cast<const v4_t *>(__dst + __i + 4);
+            v4_t __b0 = *reinterpret_cast<const v4_t *>(__src + __i);
+            v4_t __b1 = *reinterpret_cast<const v4_t *>(__src + __i + 4);
+            SHALLOCATOR_BITSET_OP(_Op, __a0, __b0);
+            SHALLOCATOR_BITSET_OP(_Op, __a1, __b1);
+            *reinterpret_cast<v4_t *>(__dst + __i) = __a0;
+            *reinterpret_cast<v4_t *>(__dst + __i + 4) = __a1;
+        }
+        for (; __i < __n; ++__i) {
+            SHALLOCATOR_BITSET_OP(_Op, __dst[__i], __src[__i]);
+        }
+    }
+
+    /**
+     * @short Count with hardware popcnt, four independent accumulators.
+     */
+    __attribute__((target("popcnt")))
+    static std::size_t count_popcnt(const uint64_t *__a, const uint64_t *__b,
+                                    std::size_t __n)
+    {
+        uint64_t __c0 = 0, __c1 = 0, __c2 = 0, __c3 = 0;
+        std::size_t __i = 0;
+        if (__b) {
+            for (; __i + 4 <= __n; __i += 4) {
+                __c0 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i] & __b[__i]));
+                __c1 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 1] & __b[__i + 1]));
+                __c2 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 2] & __b[__i + 2]));
+                __c3 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 3] & __b[__i + 3]));
+            }
+            for (; __i < __n; ++__i)
+                __c0 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i] & __b[__i]));
+        } else {
+            for (; __i + 4 <= __n; __i += 4) {
+                __c0 += static_cast<uint64_t>(__builtin_popcountll(__a[__i]));
+                __c1 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 1]));
+                __c2 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 2]));
+                __c3 += static_cast<uint64_t>(
+                        __builtin_popcountll(__a[__i + 3]));
+            }
+            for (; __i < __n; ++__i)
+                __c0 += static_cast<uint64_t>(__builtin_popcountll(__a[__i]));
+        }
+        return static_cast<std::size_t>(__c0 + __c1 + __c2 + __c3);
+    }
+#endif
+
+#undef SHALLOCATOR_BITSET_OP
+};
+
+/**
+ * @short Shared memory bitset with size given at runtime.
+ *
+ * Words are allocated by Allocator_t, so bitset created by new (SHAlloc)
+ * is visible from all processes. Set operations between bitsets of the
+ * same size are vectorized (AVX2 when CPU has it).
+ */
+class shdynamic_bitset {
+public:
+    /// type of size
+    typedef std::size_t size_type;
+    /// type of storage word
+    typedef uint64_t word_type;
+
+    /// bits per word
+    static const size_type bits_per_word = 64;
+    /// not found position
+    static const size_type npos = ~size_type(0);
+
+    /**
+     * @short Create bitset.
+     * @param __size count of bits.
+     * @param __value initial value of bits.
+     */
+    explicit
+    shdynamic_bitset(size_type __size = 0, bool __value = false)
+        : words(0), bits(0)
+    {
+        resize(__size, __value);
+    }
+
+    /**
+     * @short Copy constructor.
+     */
+    shdynamic_bitset(const shdynamic_bitset &__other): words(0), bits(0) {
+        resize(__other.bits);
+        copy_words(words, __other.words, num_words());
+    }
+
+    /**
+     * @short Free words.
+     */
+    ~shdynamic_bitset() {
+        if (words) Allocator_t<word_type>().deallocate(words, num_words());
+    }
+
+    /**
+     * @short Assignment operator.
+     */
+    shdynamic_bitset &operator=(const shdynamic_bitset &__other) {
+        if (this != &__other) {
+            shdynamic_bitset __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap with other bitset.
+     */
+    void swap(shdynamic_bitset &__other) {
+        std::swap(words, __other.words);
+        std::swap(bits, __other.bits);
+    }
+
+    /**
+     * @short Return count of bits.
+     */
+    size_type size() const { return bits;}
+
+    /**
+     * @short Return count of words.
+     */
+    size_type num_words() const {
+        return (bits + bits_per_word - 1) / bits_per_word;
+    }
+
+    /**
+     * @short Return words (trailing bits of last word are zero).
+     */
+    const word_type *data() const { return words;}
+
+    /**
+     * @short Return words for bulk writes, writer must keep trailing bits
+     * of last word zero.
+     */
+    word_type *data() { return words;}
+
+    /**
+     * @short Change count of bits.
+     * @param __size new count of bits.
+     * @param __value value of added bits.
+     */
+    void resize(size_type __size, bool __value = false) {
+        size_type __old = num_words();
+        size_type __new = (__size + bits_per_word - 1) / bits_per_word;
+        if (__new != __old) {
+            word_type *__words = __new?
+                Allocator_t<word_type>().allocate(__new): 0;
+            if (__words) copy_words(__words, words, std::min(__old, __new));
+            for (size_type __i = __old; __i < __new; ++__i)
+                __words[__i] = __value? ~word_type(0): 0;
+            if (words) Allocator_t<word_type>().deallocate(words, __old);
+            words = __words;
+        }
+        if (__value && (__size > bits) && (bits % bits_per_word))
+            words[bits / bits_per_word]
+                |= ~word_type(0) << (bits % bits_per_word);
+        bits = __size;
+        trim();
+    }
+
+    /**
+     * @short Remove all bits.
+     */
+    void clear() { resize(0);}
+
+    /**
+     * @short Return value of bit.
+     */
+    bool test(size_type __pos) const {
+        return (words[__pos / bits_per_word] >> (__pos % bits_per_word)) & 1;
+    }
+
+    /**
+     * @short Return value of bit.
+     */
+    bool operator[](size_type __pos) const { return test(__pos);}
+
+    /**
+     * @short Set bit to value.
+     */
+    shdynamic_bitset &set(size_type __pos, bool __value = true) {
+        if (__value) words[__pos / bits_per_word] |= mask(__pos);
+        else words[__pos / bits_per_word] &= ~mask(__pos);
+        return *this;
+    }
+
+    /**
+     * @short Clear bit.
+     */
+    shdynamic_bitset &reset(size_type __pos) { return set(__pos, false);}
+
+    /**
+     * @short Flip bit.
+     */
+    shdynamic_bitset &flip(size_type __pos) {
+        words[__pos / bits_per_word] ^= mask(__pos);
+        return *this;
+    }
+
+    /**
+     * @short Set all bits.
+     */
+    shdynamic_bitset &set() {
+        for (size_type __i = 0; __i < num_words(); ++__i)
+            words[__i] = ~word_type(0);
+        trim();
+        return *this;
+    }
+
+    /**
+     * @short Clear all bits.
+     */
+    shdynamic_bitset &reset() {
+        for (size_type __i = 0; __i < num_words(); ++__i) words[__i] = 0;
+        return *this;
+    }
+
+    /**
+     * @short Flip all bits.
+     */
+    shdynamic_bitset &flip() {
+        for (size_type __i = 0; __i < num_words(); ++__i)
+            words[__i] = ~words[__i];
+        trim();
+        return *this;
+    }
 
+    /**
+     * @short Set bit atomically, other processes may update the same word.
+     * @return previous value of bit.
+     */
+    bool atomic_set(size_type __pos) {
+        return __atomic_fetch_or(words + __pos / bits_per_word, mask(__pos),
+                                 __ATOMIC_RELAXED) & mask(__pos);
+    }
+
+    /**
+     * @short Clear bit atomically, other processes may update the same word.
+     * @return previous value of bit.
+     */
+    bool atomic_reset(size_type __pos) {
+        return __atomic_fetch_and(words + __pos / bits_per_word, ~mask(__pos),
+                                  __ATOMIC_RELAXED) & mask(__pos);
+    }
+
+    /**
+     * @short Read bit atomically.
+     */
+    bool atomic_test(size_type __pos) const {
+        return __atomic_load_n(words + __pos / bits_per_word,
+                               __ATOMIC_RELAXED) & mask(__pos);
+    }
+
+    /**
+     * @short Return count of set bits.
+     */
+    size_type count() const {
+        return BitsetKernels_t::count(words, 0, num_words());
+    }
+
+    /**
+     * @short Return count of bits set in both bitsets.
+     */
+    size_type count_and(const shdynamic_bitset &__other) const {
+        check_size(__other);
+        return BitsetKernels_t::count(words, __other.words, num_words());
+    }
+
+    /**
+     * @short Return true if any bit is set.
+     */
+    bool any() const { return find_first() != npos;}
+
+    /**
+     * @short Return true if no bit is set.
+     */
+    bool none() const { return !any();}
+
+    /**
+     * @short Return true if all bits are set.
+     */
+    bool all() const { return count() == bits;}
+
+    /**
+     * @short Return position of first set bit or npos.
+     */
+    size_type find_first() const { return find_from(0);}
+
+    /**
+     * @short Return position of first set bit after pos or npos.
+     */
+    size_type find_next(size_type __pos) const {
+        if (++__pos >= bits) return npos;
+        size_type __w = __pos / bits_per_word;
+        word_type __word = words[__w]
+            & (~word_type(0) << (__pos % bits_per_word));
+        if (__word)
+            return __w * bits_per_word
+                + static_cast<size_type>(__builtin_ctzll(__word));
+        return find_from(__w + 1);
+    }
+
+    shdynamic_bitset &operator&=(const shdynamic_bitset &__other) {
+        return apply(BitsetKernels_t::AND, __other);
+    }
+
+    shdynamic_bitset &operator|=(const shdynamic_bitset &__other) {
+        return apply(BitsetKernels_t::OR, __other);
+    }
+
+    shdynamic_bitset &operator^=(const shdynamic_bitset &__other) {
+        return apply(BitsetKernels_t::XOR, __other);
+    }
+
+    /**
+     * @short Clear bits set in other bitset (and not).
+     */
+    shdynamic_bitset &operator-=(const shdynamic_bitset &__other) {
+        return apply(BitsetKernels_t::ANDNOT, __other);
+    }
+
+    bool operator==(const shdynamic_bitset &__other) const {
+        return (bits == __other.bits) && (!bits || !std::memcmp(words,
+                    __other.words, num_words() * sizeof(word_type)));
+    }
+
+    bool operator!=(const shdynamic_bitset &__other) const {
+        return !(*this == __other);
+    }
+
+private:
+    /**
+     * @short Bit mask of position in its word.
+     */
+    static word_type mask(size_type __pos) {
+        return word_type(1) << (__pos % bits_per_word);
+    }
+
+    /**
+     * @short Copy words.
+     */
+    static void copy_words(word_type *__dst, const word_type *__src,
+                           size_type __n)
+    {
+        if (__n) std::memcpy(__dst, __src, __n * sizeof(word_type));
+    }
+
+    /**
+     * @short Clear bits behind size in last word.
+     */
+    void trim() {
+        if (bits % bits_per_word)
+            words[bits / bits_per_word]
+                &= ~(~word_type(0) << (bits % bits_per_word));
+    }
+
+    /**
+     * @short Find first set bit in words from w.
+     */
+    size_type find_from(size_type __w) const {
+        for (size_type __n = num_words(); __w < __n; ++__w)
+            if (words[__w])
+                return __w * bits_per_word
+                    + static_cast<size_type>(__builtin_ctzll(words[__w]));
+        return npos;
+    }
+
+    /**
+     * @short Throw if sizes differ.
+     */
+    void check_size(const shdynamic_bitset &__other) const {
+        if (bits != __other.bits)
+            throw std::invalid_argument("shdynamic_bitset: size mismatch");
+    }
+
+    /**
+     * @short Apply set operation.
+     */
+    shdynamic_bitset &apply(BitsetKernels_t::Op_t __op,
+                            const shdynamic_bitset &__other)
+    {
+        check_size(__other);
+        BitsetKernels_t::apply(__op, words, __other.words, num_words());
+        return *this;
+    }
+
+    word_type *words;   //< bit storage.
+    size_type bits;     //< count of bits.
+};
+
+/**
+ * @short Return intersection of bitsets.
+ */
+inline shdynamic_bitset operator&(const shdynamic_bitset &__a,
+                                  const shdynamic_bitset &__b)
+{
+    shdynamic_bitset __res(__a);
+    return __res &= __b;
+}
+
+/**
+ * @short Return union of bitsets.
+ */
+inline shdynamic_bitset operator|(const shdynamic_bitset &__a,
+                                  const shdynamic_bitset &__b)
+{
+    shdynamic_bitset __res(__a);
+    return __res |= __b;
+}
+
+/**
+ * @short Return symmetric difference of bitsets.
+ */
+inline shdynamic_bitset operator^(const shdynamic_bitset &__a,
+                                  const shdynamic_bitset &__b)
+{
+    shdynamic_bitset __res(__a);
+    return __res ^= __b;
+}
+
+/**
+ * @short Return difference of bitsets.
+ */
+inline shdynamic_bitset operator-(const shdynamic_bitset &__a,
+                                  const shdynamic_bitset &__b)
+{
+    shdynamic_bitset __res(__a);
+    return __res -= __b;
+}
+
+}
+
+#endif /* SHALLOCATOR_SHBITSET_H */
@@ -0,0 +1,391 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Compressed store of cold blobs.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHBLOB_STORE_H
+#define SHALLOCATOR_SHBLOB_STORE_H
+
+#include <new>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shstring.h>
+#include <shallocator/shsharded_map.h>
+#include <shallocator/shlru_cache.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Compress block by built-in LZ77 codec (byte oriented, sequences
+ * of literals and matches with 16 bit offsets, like LZ4 block format).
+ * @param src source.
+ * @param size size of source.
+ * @param dst destination.
+ * @param capacity size of destination.
+ * @return size of compressed block, 0 if it doesn't fit to capacity.
+ */
+std::size_t blob_compress(const char *src, std::size_t size,
+                          char *dst, std::size_t capacity);
+
+/**
+ * @short Decompress block compressed by blob_compress().
+ * @param src compressed block.
+ * @param size size of compressed block.
+ * @param dst destination.
+ * @param capacity size of destination.
+ * @return size of decompressed data.
+ * @exception std::runtime_error if block is corrupted or doesn't fit to
+ * capacity.
+ */
+std::size_t blob_decompress(const char *src, std::size_t size,
+                            char *dst, std::size_t capacity);
+
+/**
+ * @short Default charge of hot cache entry: size of blob.
+ */
+template <typename _Key>
+struct shblob_charge {
+    std::size_t operator()(const _Key &, const shstring &__value) const {
+        return sizeof(_Key) + __value.size();
+    }
+};
+
+/**
+ * @short Store of rarely read blobs (JSON documents, descriptions, ...)
+ * compressed in shared memory.
+ *
+ * Each value is compressed by blob_compress() to a frame allocated by
+ * Allocator_t; values that don't get smaller are kept as they are.
+ * Frames are indexed by %shsharded_map, readers decompress them into
+ * their own buffers while shard of key is locked. Recently read values
+ * are kept decompressed in %shlru_cache bounded by count of entries and
+ * by bytes (cache entries = 0 disables it).
+ *
+ * Create it in shared memory before fork:
+ * @code
+ *     shblob_store<int> *store = new (SHAlloc) shblob_store<int>(1024);
+ * @endcode
+ */
+template <typename _Key, std::size_t _Shards = 16,
+          typename _Hash = shhash<_Key>, typename _Compare = std::less<_Key> >
+class shblob_store {
+public:
+    /// type of key
+    typedef _Key key_type;
+    /// type of size
+    typedef std::size_t size_type;
+    /// hot cache type
+    typedef shlru_cache<_Key, shstring, _Shards, _Hash, shblob_charge<_Key> >
+        cache_type;
+
+    /**
+     * @short Create empty store.
+     * @param __cache_entries max count of entries in hot cache.
+     * @param __cache_bytes max sum of sizes of values in hot cache, 0 means
+     *        unlimited.
+     * @param __hash A hash functor.
+     */
+    explicit
+    shblob_store(size_type __cache_entries = 1024,
+                 size_type __cache_bytes = 1 << 20,
+                 const _Hash &__hash = _Hash())
+        : frames(__hash), cache(__cache_entries, __cache_bytes, __hash),
+          caching(__cache_entries != 0), raw(0), stored(0)
+    {}
+
+    /**
+     * @short Free all frames.
+     */
+    ~shblob_store() { frames.clear(Release_t(0, 0));}
+
+    /**
+     * @short Insert or replace value of key.
+     * @param __key key.
+     * @param __data value.
+     * @param __size size of value.
+     */
+    void put(const _Key &__key, const char *__data, size_type __size) {
+        Frame_t __frame = make_frame(__data, __size);
+        try {
+            while (!frames.update(__key, Replace_t(this, &__key, __frame))) {
+                if (frames.insert(typename Map_t::value_type(__key, __frame))) {
+                    account(__frame, 1);
+                    break;
+                }
+            }
+        } catch (...) {
+            free_frame(__frame);
+            throw;
+        }
+    }
+
+    /**
+     * @short Insert or replace value of key.
+     * @param __key key.
+     * @param __value value (string, e.g. %shstring or std::string).
+     */
+    template <typename _String>
+    void put(const _Key &__key, const _String &__value) {
+        put(__key, __value.data(), __value.size());
+    }
+
+    /**
+     * @short Copy value of key to buffer. Value is copied only if it fits
+     * to buffer; call it again with bigger buffer if __size > __capacity.
+     * @param __key key.
+     * @param __buffer buffer.
+     * @param __capacity size of buffer.
+     * @param __size size of value will be stored here.
+     * @return true if key has been found.
+     */
+    bool get(const _Key &__key, char *__buffer, size_type __capacity,
+             size_type &__size) const
+    {
+        Output_t __out(__buffer, __capacity, &__size);
+        if (caching && cache.get(__key, __out)) return true;
+        return frames.update(__key, Load_t(this, &__key, __out));
+    }
+
+    /**
+     * @short Copy value of key to string.
+     * @param __key key.
+     * @param __value string (e.g. std::string or %shstring).
+     * @return true if key has been found.
+     */
+    template <typename _String>
+    bool get(const _Key &__key, _String &__value) const {
+        for (;;) {
+            size_type __size = 0;
+            if (!get(__key, __value.empty()? 0: &__value[0], __value.size(),
+                     __size))
+                return false;
+            bool __fits = __size <= __value.size();
+            __value.resize(__size);
+            if (__fits) return true;
+        }
+    }
+
+    /**
+     * @short Return true if key is present.
+     */
+    bool contains(const _Key &__key) const {
+        return frames.count(__key) != 0;
+    }
+
+    /**
+     * @short Remove value of key.
+     * @param __key key.
+     * @return true if key has been found.
+     */
+    bool erase(const _Key &__key) {
+        return frames.erase(__key, Release_t(this, &__key)) != 0;
+    }
+
+    /**
+     * @short Remove all values.
+     */
+    void clear() {
+        frames.clear(Release_t(this, 0));
+        if (caching) cache.clear();
+    }
+
+    /**
+     * @short Return count of values.
+     */
+    size_type size() const { return frames.size();}
+
+    /**
+     * @short Return sum of sizes of values.
+     */
+    uint64_t raw_bytes() const {
+        return __atomic_load_n(&raw, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Return sum of sizes of frames holding values.
+     */
+    uint64_t stored_bytes() const {
+        return __atomic_load_n(&stored, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Return hot cache (for statistics or shrinking under memory
+     * pressure).
+     */
+    cache_type &hot_cache() const { return cache;}
+
+private:
+    shblob_store(const shblob_store &);
+    shblob_store &operator=(const shblob_store &);
+
+    /**
+     * @short Stored value.
+     */
+    struct Frame_t {
+        char *data;             //< compressed value (or value itself).
+        size_type size;         //< size of data.
+        size_type raw;          //< size of value, equals size if stored.
+    };
+
+    typedef shsharded_map<_Key, Frame_t, _Shards, _Hash, _Compare> Map_t;
+
+    /**
+     * @short Copies value to caller's buffer if it fits.
+     */
+    struct Output_t {
+        Output_t(char *__buffer, size_type __capacity, size_type *__size)
+            : buffer(__buffer), capacity(__capacity), size(__size)
+        {}
+
+        /**
+         * @short Copy value from hot cache.
+         */
+        Output_t &operator=(const shstring &__value) {
+            *size = __value.size();
+            if (*size <= capacity) std::memcpy(buffer, __value.data(), *size);
+            return *this;
+        }
+
+        char *buffer;           //< caller's buffer.
+        size_type capacity;     //< size of buffer.
+        size_type *size;        //< size of value.
+    };
+
+    /**
+     * @short Decompresses frame to caller's buffer and puts value to hot
+     * cache, while shard of key is locked.
+     */
+    struct Load_t {
+        Load_t(const shblob_store *__store, const _Key *__key,
+               const Output_t &__out)
+            : store(__store), key(__key), out(__out)
+        {}
+
+        void operator()(const Frame_t &__frame) const {
+            *out.size = __frame.raw;
+            if (__frame.raw > out.capacity) return;
+            if (__frame.size == __frame.raw) {
+                std::memcpy(out.buffer, __frame.data, __frame.raw);
+            } else if (blob_decompress(__frame.data, __frame.size, out.buffer,
+                                       __frame.raw) != __frame.raw) {
+                throw std::runtime_error("shblob_store: corrupted frame");
+            }
+            if (!store->caching) return;
+            try {
+                store->cache.put(*key, shstring(out.buffer,
+                                                out.buffer + __frame.raw));
+            } catch (const std::bad_alloc &) {
+                // hot cache is optional
+            }
+        }
+
+        const shblob_store *store;  //< store.
+        const _Key *key;            //< key of frame.
+        Output_t out;               //< caller's buffer.
+    };
+
+    /**
+     * @short Replaces frame while shard of key is locked.
+     */
+    struct Replace_t {
+        Replace_t(shblob_store *__store, const _Key *__key,
+                  const Frame_t &__frame)
+            : store(__store), key(__key), frame(__frame)
+        {}
+
+        void operator()(Frame_t &__frame) const {
+            store->account(__frame, -1);
+            store->free_frame(__frame);
+            __frame = frame;
+            store->account(__frame, 1);
+            if (store->caching) store->cache.erase(*key);
+        }
+
+        shblob_store *store;        //< store.
+        const _Key *key;            //< key of frame.
+        Frame_t frame;              //< new frame.
+    };
+
+    /**
+     * @short Frees frame while shard of key is locked (store is 0 in
+     * destructor, key is 0 when all frames are freed).
+     */
+    struct Release_t {
+        Release_t(shblob_store *__store, const _Key *__key)
+            : store(__store), key(__key)
+        {}
+
+        void operator()(Frame_t &__frame) const {
+            if (store) {
+                store->account(__frame, -1);
+                if (key && store->caching) store->cache.erase(*key);
+            }
+            free_frame(__frame);
+        }
+
+        shblob_store *store;        //< store.
+        const _Key *key;            //< key of frame.
+    };
+
+    /**
+     * @short Compress value to new frame.
+     */
+    static Frame_t make_frame(const char *__data, size_type __size) {
+        Frame_t __frame = {0, __size, __size};
+        if (!__size) return __frame;
+
+        // keep compressed value only if it is smaller
+        std::vector<char> __tmp(__size);
+        size_type __packed = blob_compress(__data, __size, &__tmp[0],
+                                           __size - 1);
+        if (__packed) {
+            __data = &__tmp[0];
+            __frame.size = __packed;
+        }
+        __frame.data = Allocator_t<char>().allocate(__frame.size);
+        std::memcpy(__frame.data, __data, __frame.size);
+        return __frame;
+    }
+
+    static void free_frame(const Frame_t &__frame) {
+        if (__frame.data)
+            Allocator_t<char>().deallocate(__frame.data, __frame.size);
+    }
+
+    void account(const Frame_t &__frame, int __sign) {
+        if (__sign > 0) {
+            __atomic_fetch_add(&raw, __frame.raw, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&stored, __frame.size, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_sub(&raw, __frame.raw, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&stored, __frame.size, __ATOMIC_RELAXED);
+        }
+    }
+
+    mutable Map_t frames;           //< frames of values.
+    mutable cache_type cache;       //< decompressed hot values.
+    bool caching;                   //< hot cache is enabled.
+    uint64_t raw;                   //< sum of sizes of values.
+    uint64_t stored;                //< sum of sizes of frames.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHBLOB_STORE_H */
@@ -0,0 +1,476 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory Bloom filters.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHBLOOM_H
+#define SHALLOCATOR_SHBLOOM_H
+
+#include <stdint.h>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shhash.h>
+#include <shallocator/shsimd.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Map 64-bit hash to [0, __range) without division. Targets without
+ * 128-bit integers use high half of hash, range must be below 2^32 there.
+ */
+inline uint64_t bloom_reduce(uint64_t __hash, uint64_t __range) {
+#ifdef __SIZEOF_INT128__
+    return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(__hash) * __range) >> 64);
+#else
+    return ((__hash >> 32) * (__range & 0xffffffffU)) >> 32;
+#endif
+}
+
+/**
+ * @short Return count of bits for n elements and false positive rate.
+ */
+inline uint64_t bloom_bits(std::size_t __expected, double __fpp) {
+    if (!(__fpp > 0) || !(__fpp < 1))
+        throw std::invalid_argument("bloom filter: false positive rate "
+                                    "must be in (0, 1)");
+    double __ln2 = std::log(2.0);
+    double __bits = -static_cast<double>(__expected ? __expected: 1)
+                  * std::log(__fpp) / (__ln2 * __ln2);
+    return static_cast<uint64_t>(__bits) + 1;
+}
+
+/**
+ * @short Classic Bloom filter in shared memory.
+ *
+ * Bits are set by atomic or (skipped when bit is already set, so hot keys
+ * don't dirty cache lines), so insert() and contains() may run in more
+ * processes at once without lock. Probes are h1 + i * h2 of one 64-bit
+ * hash of _Hash (Kirsch-Mitzenmacher). Each probe touches other cache
+ * line; see shblocked_bloom_filter for one line per lookup.
+ */
+template <typename _Key, typename _Hash = shhash<_Key> >
+class shbloom_filter {
+public:
+    /// key type
+    typedef _Key key_type;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Create filter for expected count of elements.
+     * @param __expected expected count of elements.
+     * @param __fpp false positive rate at expected count of elements.
+     */
+    explicit shbloom_filter(size_type __expected, double __fpp = 0.01)
+        : words(0), bits(0), hashes(0)
+    {
+        uint64_t __bits = bloom_bits(__expected, __fpp);
+        double __k = static_cast<double>(__bits)
+                   / static_cast<double>(__expected? __expected: 1)
+                   * std::log(2.0);
+        hashes = static_cast<unsigned>(__k + 0.5);
+        if (!hashes) hashes = 1;
+        if (hashes > 16) hashes = 16;
+        allocate((__bits + 63) / 64);
+    }
+
+    /**
+     * @short Destructor frees bits.
+     */
+    ~shbloom_filter() {
+        Allocator_t<uint64_t>().deallocate_aligned(words, bits / 64);
+    }
+
+    /**
+     * @short Add key.
+     * @param __key key.
+     */
+    void insert(const _Key &__key) { insert_hash(_Hash()(__key));}
+
+    /**
+     * @short Return false if key has surely not been inserted.
+     * @param __key key.
+     */
+    bool contains(const _Key &__key) const {
+        return contains_hash(_Hash()(__key));
+    }
+
+    /**
+     * @short Add precomputed hash.
+     * @param __hash hash of key.
+     */
+    void insert_hash(uint64_t __hash) {
+        uint64_t __h2 = (__hash >> 32) | (__hash << 32) | 1;
+        for (unsigned __i = 0; __i < hashes; ++__i, __hash += __h2) {
+            uint64_t __bit = bloom_reduce(__hash, bits);
+            uint64_t __mask = uint64_t(1) << (__bit & 63);
+            uint64_t *__word = words + (__bit >> 6);
+            if (!(__atomic_load_n(__word, __ATOMIC_RELAXED) & __mask))
+                __atomic_fetch_or(__word, __mask, __ATOMIC_RELAXED);
+        }
+    }
+
+    /**
+     * @short Check precomputed hash.
+     * @param __hash hash of key.
+     */
+    bool contains_hash(uint64_t __hash) const {
+        uint64_t __h2 = (__hash >> 32) | (__hash << 32) | 1;
+        for (unsigned __i = 0; __i < hashes; ++__i, __hash += __h2) {
+            uint64_t __bit = bloom_reduce(__hash, bits);
+            if (!(__atomic_load_n(words + (__bit >> 6), __ATOMIC_RELAXED)
+                        & (uint64_t(1) << (__bit & 63))))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @short Remove all keys.
+     */
+    void clear() { std::memset(words, 0, bits / 8);}
+
+    /**
+     * @short Return count of bits.
+     */
+    uint64_t bit_count() const { return bits;}
+
+    /**
+     * @short Return count of probes per key.
+     */
+    unsigned hash_count() const { return hashes;}
+
+private:
+    shbloom_filter(const shbloom_filter &);
+    shbloom_filter &operator=(const shbloom_filter &);
+
+    /**
+     * @short Allocate zeroed words.
+     */
+    void allocate(uint64_t __words) {
+        words = Allocator_t<uint64_t>().allocate_aligned(
+                static_cast<size_type>(__words));
+        bits = __words * 64;
+        clear();
+    }
+
+    uint64_t *words;    //< bits.
+    uint64_t bits;      //< count of bits.
+    unsigned hashes;    //< count of probes.
+};
+
+/**
+ * @short Split block Bloom filter in shared memory.
+ *
+ * Key selects one 256-bit block (half of 64 byte cache line) and sets one
+ * bit in each of its eight 32-bit words; the bits are chosen by multiplying
+ * hash by eight odd constants, so probe is few vector instructions (AVX2
+ * when CPU has it) and lookup touches one cache line. It needs about 10%
+ * more bits than classic filter for the same false positive rate. Bits are
+ * set by atomic or, insert() and contains() may run in more processes at
+ * once without lock.
+ */
+template <typename _Key, typename _Hash = shhash<_Key> >
+class shblocked_bloom_filter {
+public:
+    /// key type
+    typedef _Key key_type;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Create filter for expected count of elements.
+     * @param __expected expected count of elements.
+     * @param __fpp false positive rate at expected count of elements.
+     */
+    explicit shblocked_bloom_filter(size_type __expected, double __fpp = 0.01)
+        : words(0), blocks(0)
+    {
+        uint64_t __bits = bloom_bits(__expected, __fpp) * 11 / 10;
+        blocks = (__bits + 255) / 256;
+        words = Allocator_t<uint32_t>().allocate_aligned(
+                static_cast<size_type>(blocks * 8));
+        clear();
+    }
+
+    /**
+     * @short Destructor frees bits.
+     */
+    ~shblocked_bloom_filter() {
+        Allocator_t<uint32_t>().deallocate_aligned(
+                words, static_cast<size_type>(blocks * 8));
+    }
+
+    /**
+     * @short Add key.
+     * @param __key key.
+     */
+    void insert(const _Key &__key) { insert_hash(_Hash()(__key));}
+
+    /**
+     * @short Return false if key has surely not been inserted.
+     * @param __key key.
+     */
+    bool contains(const _Key &__key) const {
+        return contains_hash(_Hash()(__key));
+    }
+
+    /**
+     * @short Add precomputed hash.
+     * @param __hash hash of key.
+     */
+    void insert_hash(uint64_t __hash) {
+        uint32_t *__block = words + 8 * bloom_reduce(__hash, blocks);
+        uint32_t __masks[8];
+        masks(static_cast<uint32_t>(__hash), __masks);
+        for (unsigned __i = 0; __i < 8; ++__i)
+            if ((__atomic_load_n(__block + __i, __ATOMIC_RELAXED)
+                        & __masks[__i]) != __masks[__i])
+                __atomic_fetch_or(__block + __i, __masks[__i],
+                                  __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Check precomputed hash.
+     * @param __hash hash of key.
+     */
+    bool contains_hash(uint64_t __hash) const {
+        const uint32_t *__block = words + 8 * bloom_reduce(__hash, blocks);
+        uint32_t __key = static_cast<uint32_t>(__hash);
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return probe_avx2(__block, __key);
+#endif
+        uint32_t __masks[8];
+        masks(__key, __masks);
+        for (unsigned __i = 0; __i < 8; ++__i)
+            if ((__atomic_load_n(__block + __i, __ATOMIC_RELAXED)
+                        & __masks[__i]) != __masks[__i])
+                return false;
+        return true;
+    }
+
+    /**
+     * @short Remove all keys.
+     */
+    void clear() {
+        std::memset(words, 0, static_cast<size_type>(blocks * 32));
+    }
+
+    /**
+     * @short Return count of bits.
+     */
+    uint64_t bit_count() const { return blocks * 256;}
+
+private:
+    shblocked_bloom_filter(const shblocked_bloom_filter &);
+    shblocked_bloom_filter &operator=(const shblocked_bloom_filter &);
+
+    // odd constants choosing bit in each word
+    static const uint32_t SALT0 = 0x47b6137bU;
+    static const uint32_t SALT1 = 0x44974d91U;
+    static const uint32_t SALT2 = 0x8824ad5bU;
+    static const uint32_t SALT3 = 0xa2b7289dU;
+    static const uint32_t SALT4 = 0x705495c7U;
+    static const uint32_t SALT5 = 0x2df1424bU;
+    static const uint32_t SALT6 = 0x9efc4947U;
+    static const uint32_t SALT7 = 0x5c6bfb31U;
+
+    /**
+     * @short Compute bit of each word of block.
+     */
+    static void masks(uint32_t __key, uint32_t *__masks) {
+        static const uint32_t __salt[8] = {SALT0, SALT1, SALT2, SALT3,
+                                           SALT4, SALT5, SALT6, SALT7};
+        for (unsigned __i = 0; __i < 8; ++__i)
+            __masks[__i] = uint32_t(1) << ((__key * __salt[__i]) >> 27);
+    }
+
+#ifdef SHALLOCATOR_X86_SIMD
+    /**
+     * @short Check all words of block at once. Bits of block are only set,
+     * torn read can't give false negative.
+     */
+    __attribute__((target("avx2")))
+    static bool probe_avx2(const uint32_t *__block, uint32_t __key) {
+        typedef uint32_t v8_t __attribute__((vector_size(32), aligned(32)));
+        v8_t __salt = {SALT0, SALT1, SALT2, SALT3,
+                       SALT4, SALT5, SALT6, SALT7};
+        v8_t __one = {1, 1, 1, 1, 1, 1, 1, 1};
+        v8_t __mask = __one << ((__key * __salt) >> 27);
+        v8_t __bits = *reinterpret_cast<const v8_t *>(__block);
+        v8_t __miss = ~__bits & __mask;
+        uint32_t __any = 0;
+        for (unsigned __i = 0; __i < 8; ++__i) __any |= __miss[__i];
+        return !__any;
+    }
+#endif
+
+    uint32_t *words;    //< blocks of 8 words.
+    uint64_t blocks;    //< count of blocks.
+};
+
+/**
+ * @short Wrapper of shset/shmap (or other container with find()) that
+ * consults Bloom filter before find(), so most lookups of missing keys
+ * are answered from one cache line instead of walk down the tree.
+ *
+ * Keys are added to filter by insert() of wrapper; erased keys stay in
+ * filter (they only cost a tree lookup), call rebuild() after many
+ * erases. Container must be modified only through the wrapper.
+ */
+template <typename _Container,
+          typename _Filter = shblocked_bloom_filter<
+                                typename _Container::key_type> >
+class shbloom_guard {
+public:
+    /// container type
+    typedef _Container container_type;
+    /// filter type
+    typedef _Filter filter_type;
+    /// key type
+    typedef typename _Container::key_type key_type;
+    /// value type
+    typedef typename _Container::value_type value_type;
+    /// iterator
+    typedef typename _Container::iterator iterator;
+    /// const iterator
+    typedef typename _Container::const_iterator const_iterator;
+    /// size type
+    typedef typename _Container::size_type size_type;
+
+    /**
+     * @short Create empty container and filter.
+     * @param __expected expected count of elements.
+     * @param __fpp false positive rate at expected count of elements.
+     */
+    explicit shbloom_guard(std::size_t __expected, double __fpp = 0.01)
+        : filter(__expected, __fpp)
+    {}
+
+    /**
+     * @short Insert value to container and its key to filter.
+     * @param __value value.
+     * @return result of container insert().
+     */
+    std::pair<iterator, bool> insert(const value_type &__value) {
+        std::pair<iterator, bool> __res = container.insert(__value);
+        filter.insert(key_of(*__res.first));
+        return __res;
+    }
+
+    /**
+     * @short Find key, ask filter first.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    iterator find(const key_type &__key) {
+        return filter.contains(__key)? container.find(__key): container.end();
+    }
+
+    /**
+     * @short Find key, ask filter first.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    const_iterator find(const key_type &__key) const {
+        return filter.contains(__key)? container.find(__key): container.end();
+    }
+
+    /**
+     * @short Return count of elements with key, ask filter first.
+     */
+    size_type count(const key_type &__key) const {
+        return filter.contains(__key)? container.count(__key): 0;
+    }
+
+    /**
+     * @short Erase key from container (filter keeps it).
+     * @param __key key.
+     * @return count of erased elements.
+     */
+    size_type erase(const key_type &__key) { return container.erase(__key);}
+
+    /**
+     * @short Remove all elements.
+     */
+    void clear() {
+        container.clear();
+        filter.clear();
+    }
+
+    /**
+     * @short Rebuild filter from keys in container.
+     */
+    void rebuild() {
+        filter.clear();
+        for (const_iterator __it = container.begin();
+                __it != container.end(); ++__it)
+            filter.insert(key_of(*__it));
+    }
+
+    iterator begin() { return container.begin();}
+    const_iterator begin() const { return container.begin();}
+    iterator end() { return container.end();}
+    const_iterator end() const { return container.end();}
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return container.size();}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return container.empty();}
+
+    /**
+     * @short Return read only container (e.g. for range queries).
+     */
+    const _Container &get() const { return container;}
+
+    /**
+     * @short Return filter.
+     */
+    const _Filter &get_filter() const { return filter;}
+
+private:
+    shbloom_guard(const shbloom_guard &);
+    shbloom_guard &operator=(const shbloom_guard &);
+
+    /**
+     * @short Key of set element.
+     */
+    static const key_type &key_of(const key_type &__value) { return __value;}
+
+    /**
+     * @short Key of map element.
+     */
+    template <typename _Pair>
+    static const key_type &key_of(const _Pair &__value) {
+        return __value.first;
+    }
+
+    _Container container;   //< guarded container.
+    _Filter filter;         //< filter of keys.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHBLOOM_H */
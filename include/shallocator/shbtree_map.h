@@ -0,0 +1,1067 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory B+tree map.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHBTREE_MAP_H
+#define SHALLOCATOR_SHBTREE_MAP_H
+
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shsearch.h>
+#include <shallocator/shbulk.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory ordered map implemented as B+tree.
+ *
+ * Nodes are _NodeSize bytes wide (multiple of cache line), cache line
+ * aligned and keep keys in one contiguous array, so lookup touches only a
+ * few cache lines per level and per-entry overhead is a fraction of %shmap
+ * node. Leaves are linked, in-order scan is sequential walk over leaves.
+ *
+ * It implements subset of %shmap interface. Differences:
+ *   - _Key and _Tp must be default constructible and assignable,
+ *   - iterator dereference returns proxy with first/second references,
+ *     not std::pair,
+ *   - insert and erase invalidate all iterators,
+ *   - nodes are released when they become empty, partially filled nodes
+ *     are not merged.
+ */
+template <typename _Key, typename _Tp, typename _Compare = std::less<_Key>,
+          std::size_t _NodeSize = 4 * SHALLOCATOR_CACHE_LINE>
+class shbtree_map {
+public:
+    /// type of key
+    typedef _Key key_type;
+    /// type of mapped value
+    typedef _Tp mapped_type;
+    /// type of inserted value
+    typedef std::pair<const _Key, _Tp> value_type;
+    /// type of size
+    typedef std::size_t size_type;
+    /// key comparator
+    typedef _Compare key_compare;
+
+private:
+    struct Inner_t;
+    struct Leaf_t;
+    typedef SortedSearch_t<_Key, _Compare> Search_t;
+
+    /**
+     * @short Common header of nodes.
+     */
+    struct Node_t {
+        unsigned short level;   //< 0 for leaves, height above leaves else.
+        unsigned short count;   //< count of keys in node.
+    };
+
+    /// max count of keys in leaf
+    static const size_type leaf_slots
+        = ((_NodeSize - sizeof(Node_t) - 2 * sizeof(void *))
+           / (sizeof(_Key) + sizeof(_Tp)) < 3)? 3
+        : (_NodeSize - sizeof(Node_t) - 2 * sizeof(void *))
+           / (sizeof(_Key) + sizeof(_Tp));
+
+    /// max count of keys in inner node
+    static const size_type inner_slots
+        = ((_NodeSize - sizeof(Node_t) - sizeof(void *))
+           / (sizeof(_Key) + sizeof(void *)) < 3)? 3
+        : (_NodeSize - sizeof(Node_t) - sizeof(void *))
+           / (sizeof(_Key) + sizeof(void *));
+
+    /// max height of tree
+    static const size_type max_height = 32;
+
+    /**
+     * @short Leaf node: keys and values in separate arrays.
+     */
+    struct Leaf_t: public Node_t {
+        Leaf_t *prev;               //< previous leaf.
+        Leaf_t *next;               //< next leaf.
+        _Key keys[leaf_slots];      //< keys.
+        _Tp values[leaf_slots];     //< values.
+    };
+
+    /**
+     * @short Inner node: children[i] holds keys < keys[i] <= children[i + 1].
+     */
+    struct Inner_t: public Node_t {
+        _Key keys[inner_slots];                 //< separators.
+        Node_t *children[inner_slots + 1];      //< subtrees.
+    };
+
+public:
+    /**
+     * @short Value seen through iterator.
+     */
+    template <typename _Mapped>
+    struct Reference_t {
+        Reference_t(const _Key &__first, _Mapped &__second)
+            : first(__first), second(__second) {}
+
+        const _Key &first;  //< key.
+        _Mapped &second;    //< mapped value.
+    };
+
+    /**
+     * @short Bidirectional iterator over leaves.
+     */
+    template <typename _Mapped>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef Reference_t<_Mapped> value_type;
+        /// reference type
+        typedef Reference_t<_Mapped> reference;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        /**
+         * @short Keeps reference for operator->.
+         */
+        struct Pointer_t {
+            Pointer_t(const reference &__ref): ref(__ref) {}
+            const reference *operator->() const { return &ref;}
+            reference ref;  //< held reference.
+        };
+
+        /// pointer type
+        typedef Pointer_t pointer;
+
+        Iterator_t(): leaf(0), pos(0), map(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : leaf(__other.leaf), pos(__other.pos), map(__other.map) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            leaf = __other.leaf;
+            pos = __other.pos;
+            map = __other.map;
+            return *this;
+        }
+
+        reference operator*() const {
+            return reference(leaf->keys[pos], leaf->values[pos]);
+        }
+
+        pointer operator->() const { return pointer(**this);}
+
+        Iterator_t &operator++() {
+            if (++pos == leaf->count) {
+                leaf = leaf->next;
+                pos = 0;
+                if (leaf && leaf->next)
+                    prefetch(leaf->next, sizeof(Leaf_t));
+            }
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator--() {
+            if (!leaf) {
+                leaf = map->tail;
+                pos = leaf->count;
+            } else if (!pos) {
+                leaf = leaf->prev;
+                pos = leaf->count;
+            }
+            --pos;
+            return *this;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return (leaf == __other.leaf) && (pos == __other.pos);
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return !(*this == __other);
+        }
+
+    private:
+        Iterator_t(Leaf_t *__leaf, size_type __pos, const shbtree_map *__map)
+            : leaf(__leaf), pos(__pos), map(__map) {}
+
+        friend class shbtree_map;
+        template <typename> friend class Iterator_t;
+
+        Leaf_t *leaf;               //< current leaf, 0 for end().
+        size_type pos;              //< position in leaf.
+        const shbtree_map *map;     //< owning map (for --end()).
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    explicit
+    shbtree_map(const _Compare &__comp = _Compare())
+        : root(0), head(0), tail(0), elements(0), comp(__comp) {}
+
+    /**
+     * @short Builds a %shbtree_map from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shbtree_map(_InputIterator __first, _InputIterator __last,
+                const _Compare &__comp = _Compare())
+        : root(0), head(0), tail(0), elements(0), comp(__comp)
+    {
+        for (; __first != __last; ++__first)
+            insert(*__first);
+    }
+
+    /**
+     * @short Copy constructor, builds tree by bulk load.
+     * @param __other source map.
+     */
+    shbtree_map(const shbtree_map &__other)
+        : root(0), head(0), tail(0), elements(0), comp(__other.comp)
+    {
+        bulk_load(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Destructor frees all nodes.
+     */
+    ~shbtree_map() { clear();}
+
+    /**
+     * @short Assignment operator.
+     * @param __other source map.
+     */
+    shbtree_map &operator=(const shbtree_map &__other) {
+        if (this != &__other) {
+            shbtree_map __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap content with other map.
+     * @param __other other map.
+     */
+    void swap(shbtree_map &__other) {
+        std::swap(root, __other.root);
+        std::swap(head, __other.head);
+        std::swap(tail, __other.tail);
+        std::swap(elements, __other.elements);
+        std::swap(comp, __other.comp);
+    }
+
+    iterator begin() { return iterator(head, 0, this);}
+    const_iterator begin() const { return const_iterator(head, 0, this);}
+    iterator end() { return iterator(0, 0, this);}
+    const_iterator end() const { return const_iterator(0, 0, this);}
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    /**
+     * @short Return key comparator.
+     */
+    key_compare key_comp() const { return comp;}
+
+    /**
+     * @short Find element with key.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    iterator find(const _Key &__key) {
+        iterator __it = lower_bound(__key);
+        return (__it.leaf && !comp(__key, __it.leaf->keys[__it.pos]))?
+            __it: end();
+    }
+
+    /**
+     * @short Find element with key.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    const_iterator find(const _Key &__key) const {
+        const_iterator __it = lower_bound(__key);
+        return (__it.leaf && !comp(__key, __it.leaf->keys[__it.pos]))?
+            __it: end();
+    }
+
+    /**
+     * @short Return count of elements with key (0 or 1).
+     */
+    size_type count(const _Key &__key) const {
+        return (find(__key) != end())? 1: 0;
+    }
+
+    /**
+     * @short Return iterator to first element not less than key.
+     */
+    iterator lower_bound(const _Key &__key) {
+        return bound<iterator, false>(__key);
+    }
+
+    /**
+     * @short Return iterator to first element not less than key.
+     */
+    const_iterator lower_bound(const _Key &__key) const {
+        return const_cast<shbtree_map *>(this)
+            ->template bound<const_iterator, false>(__key);
+    }
+
+    /**
+     * @short Return iterator to first element greater than key.
+     */
+    iterator upper_bound(const _Key &__key) {
+        return bound<iterator, true>(__key);
+    }
+
+    /**
+     * @short Return iterator to first element greater than key.
+     */
+    const_iterator upper_bound(const _Key &__key) const {
+        return const_cast<shbtree_map *>(this)
+            ->template bound<const_iterator, true>(__key);
+    }
+
+    /**
+     * @short Return range of elements with key.
+     */
+    std::pair<iterator, iterator> equal_range(const _Key &__key) {
+        return std::make_pair(lower_bound(__key), upper_bound(__key));
+    }
+
+    /**
+     * @short Return range of elements with key.
+     */
+    std::pair<const_iterator, const_iterator>
+    equal_range(const _Key &__key) const {
+        return std::make_pair(lower_bound(__key), upper_bound(__key));
+    }
+
+    /**
+     * @short Return value of key, insert default value if not present.
+     * @param __key key.
+     * @return reference to value.
+     */
+    _Tp &operator[](const _Key &__key) {
+        iterator __it = insert(value_type(__key, _Tp())).first;
+        return __it.leaf->values[__it.pos];
+    }
+
+    /**
+     * @short Insert value if its key is not present.
+     * @param __value inserted value.
+     * @return iterator to element with key and true if inserted.
+     */
+    std::pair<iterator, bool> insert(const value_type &__value) {
+        const _Key &__key = __value.first;
+        if (!root) {
+            Leaf_t *__leaf = new_leaf();
+            root = head = tail = __leaf;
+        }
+
+        // descend and remember path
+        Inner_t *__path[max_height];
+        size_type __slot[max_height];
+        size_type __depth = 0;
+        Node_t *__node = root;
+        while (__node->level) {
+            Inner_t *__inner = static_cast<Inner_t *>(__node);
+            size_type __i = inner_position(__inner, __key);
+            __path[__depth] = __inner;
+            __slot[__depth++] = __i;
+            __node = __inner->children[__i];
+            prefetch(__node, node_size(__inner->level - 1));
+        }
+
+        // find in leaf
+        Leaf_t *__leaf = static_cast<Leaf_t *>(__node);
+        size_type __pos = leaf_position(__leaf, __key);
+        if ((__pos < __leaf->count) && !comp(__key, __leaf->keys[__pos]))
+            return std::make_pair(iterator(__leaf, __pos, this), false);
+
+        // simple case - free slot in leaf
+        if (__leaf->count < leaf_slots) {
+            leaf_insert(__leaf, __pos, __key, __value.second);
+            ++elements;
+            return std::make_pair(iterator(__leaf, __pos, this), true);
+        }
+
+        // split leaf
+        Leaf_t *__right = new_leaf();
+        size_type __mid = (leaf_slots + 1) / 2;
+        for (size_type __i = __mid; __i < leaf_slots; ++__i) {
+            __right->keys[__i - __mid] = __leaf->keys[__i];
+            __right->values[__i - __mid] = __leaf->values[__i];
+            __leaf->keys[__i] = _Key();
+            __leaf->values[__i] = _Tp();
+        }
+        __right->count = static_cast<unsigned short>(leaf_slots - __mid);
+        __leaf->count = static_cast<unsigned short>(__mid);
+        __right->next = __leaf->next;
+        __right->prev = __leaf;
+        if (__leaf->next) __leaf->next->prev = __right;
+        else tail = __right;
+        __leaf->next = __right;
+
+        iterator __result;
+        if (__pos < __mid) {
+            leaf_insert(__leaf, __pos, __key, __value.second);
+            __result = iterator(__leaf, __pos, this);
+        } else {
+            leaf_insert(__right, __pos - __mid, __key, __value.second);
+            __result = iterator(__right, __pos - __mid, this);
+        }
+        ++elements;
+
+        // propagate separator up
+        _Key __sep = __right->keys[0];
+        Node_t *__child = __right;
+        while (__depth) {
+            Inner_t *__inner = __path[--__depth];
+            size_type __i = __slot[__depth];
+            if (__inner->count < inner_slots) {
+                inner_insert(__inner, __i, __sep, __child);
+                return std::make_pair(__result, true);
+            }
+
+            // split inner node, middle key goes up
+            Inner_t *__rinner = new_inner(__inner->level);
+            size_type __imid = inner_slots / 2;
+            _Key __up = __inner->keys[__imid];
+            for (size_type __j = __imid + 1; __j < inner_slots; ++__j) {
+                __rinner->keys[__j - __imid - 1] = __inner->keys[__j];
+                __inner->keys[__j] = _Key();
+            }
+            for (size_type __j = __imid + 1; __j <= inner_slots; ++__j)
+                __rinner->children[__j - __imid - 1] = __inner->children[__j];
+            __inner->keys[__imid] = _Key();
+            __rinner->count
+                = static_cast<unsigned short>(inner_slots - __imid - 1);
+            __inner->count = static_cast<unsigned short>(__imid);
+
+            if (__i <= __imid) inner_insert(__inner, __i, __sep, __child);
+            else inner_insert(__rinner, __i - __imid - 1, __sep, __child);
+
+            __sep = __up;
+            __child = __rinner;
+        }
+
+        // root has been split
+        Inner_t *__root = new_inner(static_cast<unsigned short>(
+                    root->level + 1));
+        __root->keys[0] = __sep;
+        __root->children[0] = root;
+        __root->children[1] = __child;
+        __root->count = 1;
+        root = __root;
+        return std::make_pair(__result, true);
+    }
+
+    /**
+     * @short Insert range of values.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    void insert(_InputIterator __first, _InputIterator __last) {
+        for (; __first != __last; ++__first)
+            insert(*__first);
+    }
+
+    /**
+     * @short Erase element with key.
+     * @param __key key.
+     * @return count of erased elements.
+     */
+    size_type erase(const _Key &__key) {
+        if (!root) return 0;
+
+        Inner_t *__path[max_height];
+        size_type __slot[max_height];
+        size_type __depth = 0;
+        Node_t *__node = root;
+        while (__node->level) {
+            Inner_t *__inner = static_cast<Inner_t *>(__node);
+            size_type __i = inner_position(__inner, __key);
+            __path[__depth] = __inner;
+            __slot[__depth++] = __i;
+            __node = __inner->children[__i];
+        }
+
+        Leaf_t *__leaf = static_cast<Leaf_t *>(__node);
+        size_type __pos = leaf_position(__leaf, __key);
+        if ((__pos == __leaf->count) || comp(__key, __leaf->keys[__pos]))
+            return 0;
+
+        // remove from leaf
+        size_type __n = __leaf->count;
+        std::copy(__leaf->keys + __pos + 1, __leaf->keys + __n,
+                  __leaf->keys + __pos);
+        std::copy(__leaf->values + __pos + 1, __leaf->values + __n,
+                  __leaf->values + __pos);
+        __leaf->keys[__n - 1] = _Key();
+        __leaf->values[__n - 1] = _Tp();
+        --__leaf->count;
+        --elements;
+        if (__leaf->count) return 1;
+
+        // release empty leaf
+        if (__leaf->prev) __leaf->prev->next = __leaf->next;
+        else head = __leaf->next;
+        if (__leaf->next) __leaf->next->prev = __leaf->prev;
+        else tail = __leaf->prev;
+        delete_node(__leaf);
+
+        // remove it from parents, release empty parents
+        for (;;) {
+            if (!__depth) {
+                root = 0;
+                return 1;
+            }
+            Inner_t *__inner = __path[--__depth];
+            size_type __i = __slot[__depth];
+            if (__inner->count) {
+                inner_remove(__inner, __i);
+                break;
+            }
+            delete_node(__inner);
+        }
+
+        // shrink tree height
+        while (root->level && !root->count) {
+            Node_t *__old = root;
+            root = static_cast<Inner_t *>(root)->children[0];
+            delete_node(__old);
+        }
+        return 1;
+    }
+
+    /**
+     * @short Erase element at iterator.
+     * @param __it iterator.
+     */
+    void erase(iterator __it) {
+        _Key __key(__it.leaf->keys[__it.pos]);
+        erase(__key);
+    }
+
+    /**
+     * @short Erase all elements.
+     */
+    void clear() {
+        if (root) delete_tree(root);
+        root = 0;
+        head = tail = 0;
+        elements = 0;
+    }
+
+    /**
+     * @short Replace content with strictly ascending range. Tree is built
+     * bottom-up with full nodes, it is much faster than inserting one by
+     * one.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @exception std::invalid_argument if range is not strictly ascending
+     * (duplicate keys included), map is left empty.
+     */
+    template <typename _InputIterator>
+    void bulk_load(_InputIterator __first, _InputIterator __last) {
+        clear();
+
+        // fill leaves, on failure the map is left empty
+        try {
+            Leaf_t *__leaf = 0;
+            for (; __first != __last; ++__first) {
+                const _Key &__key = (*__first).first;
+                if (__leaf && __leaf->count) {
+                    const _Key &__prev = __leaf->keys[__leaf->count - 1];
+                    if (!comp(__prev, __key))
+                        throw std::invalid_argument("shbtree_map::bulk_load: "
+                                                    "range is not strictly "
+                                                    "ascending");
+                }
+                if (!__leaf || (__leaf->count == leaf_slots)) {
+                    Leaf_t *__next = new_leaf();
+                    __next->prev = __leaf;
+                    if (__leaf) __leaf->next = __next;
+                    else head = __next;
+                    __leaf = tail = __next;
+                }
+                __leaf->keys[__leaf->count] = __key;
+                __leaf->values[__leaf->count] = (*__first).second;
+                ++__leaf->count;
+                ++elements;
+            }
+            build_inner();
+        } catch (...) {
+            clear_leaves();
+            throw;
+        }
+    }
+
+    /**
+     * @short Replace content with strictly ascending range, leaves are
+     * filled by bulk workers in parallel (see run_bulk_workers()), inner
+     * levels by this process. Map object itself may be in local memory,
+     * nodes are in shared memory as always.
+     * @param __first A forward iterator.
+     * @param __last A forward iterator.
+     * @param __workers count of workers (0 means count of online CPUs).
+     * @exception std::invalid_argument if range is not strictly ascending
+     * (duplicate keys included), map is left empty.
+     */
+    template <typename _ForwardIterator>
+    void bulk_load(_ForwardIterator __first, _ForwardIterator __last,
+                   unsigned __workers)
+    {
+        typedef typename std::iterator_traits<_ForwardIterator>
+            ::difference_type Difference_t;
+        clear();
+        ParallelLoad_t<_ForwardIterator> __load;
+        __load.tree = this;
+        __load.size = static_cast<size_type>(std::distance(__first, __last));
+        if (!__load.size) return;
+        size_type __leaves = (__load.size + leaf_slots - 1) / leaf_slots;
+        __load.workers = bulk_workers(__leaves, __workers, 64);
+
+        // workers start at item before their slice (it checks order
+        // across slices), iterators are computed in one pass
+        std::vector<_ForwardIterator> __starts;
+        __starts.reserve(__load.workers);
+        size_type __pos = 0;
+        for (unsigned __i = 0; __i < __load.workers; ++__i) {
+            size_type __begin
+                = bulk_slice(__leaves, __load.workers, __i).first * leaf_slots;
+            if (__begin) --__begin;
+            std::advance(__first, static_cast<Difference_t>(__begin - __pos));
+            __pos = __begin;
+            __starts.push_back(__first);
+        }
+        __load.starts = &__starts[0];
+
+        // chains of leaves of workers are in shared memory
+        Allocator_t<Chain_t> __alloc;
+        __load.chains = __alloc.allocate(__load.workers);
+        for (unsigned __i = 0; __i < __load.workers; ++__i)
+            __load.chains[__i] = Chain_t();
+
+        bool __sorted = true;
+        try {
+            run_bulk_workers(__load.workers,
+                             ParallelLoad_t<_ForwardIterator>::fill, &__load);
+        } catch (...) {
+            link_chains(__load.chains, __load.workers);
+            __alloc.deallocate(__load.chains, __load.workers);
+            clear_leaves();
+            throw;
+        }
+        for (unsigned __i = 0; __i < __load.workers; ++__i)
+            __sorted = __sorted && __load.chains[__i].sorted;
+        link_chains(__load.chains, __load.workers);
+        __alloc.deallocate(__load.chains, __load.workers);
+        if (!__sorted) {
+            clear_leaves();
+            throw std::invalid_argument("shbtree_map::bulk_load: "
+                                        "range is not strictly ascending");
+        }
+        elements = __load.size;
+        try {
+            build_inner();
+        } catch (...) {
+            clear_leaves();
+            throw;
+        }
+    }
+
+private:
+    /**
+     * @short Leaves filled by one bulk worker.
+     */
+    struct Chain_t {
+        Chain_t(): head(0), tail(0), sorted(true) {}
+
+        Leaf_t *head;   //< first leaf.
+        Leaf_t *tail;   //< last leaf.
+        bool sorted;    //< worker's slice was strictly ascending.
+    };
+
+    /**
+     * @short State of parallel bulk_load() shared with workers.
+     */
+    template <typename _Iterator>
+    struct ParallelLoad_t {
+        /**
+         * @short Fill whole leaves of worker's slice of range.
+         */
+        static void fill(unsigned __worker, void *__arg) {
+            ParallelLoad_t &__self = *static_cast<ParallelLoad_t *>(__arg);
+            size_type __leaves = (__self.size + leaf_slots - 1) / leaf_slots;
+            std::pair<size_type, size_type> __slice
+                = bulk_slice(__leaves, __self.workers, __worker);
+            size_type __begin = __slice.first * leaf_slots;
+            size_type __end = std::min(__slice.second * leaf_slots,
+                                       __self.size);
+            Chain_t &__chain = __self.chains[__worker];
+            const _Compare &__comp = __self.tree->comp;
+
+            // previous item checks order across slices, its key is copied
+            // (iterator may return temporaries)
+            _Iterator __it = __self.starts[__worker];
+            _Key __before = _Key();
+            const _Key *__prev = 0;
+            if (__begin) {
+                __before = (*__it).first;
+                __prev = &__before;
+                ++__it;
+            }
+
+            Leaf_t *__leaf = 0;
+            for (size_type __i = __begin; __i < __end; ++__i, ++__it) {
+                const _Key &__key = (*__it).first;
+                if (__prev && !__comp(*__prev, __key)) {
+                    __chain.sorted = false;
+                    return;
+                }
+                if (!__leaf || (__leaf->count == leaf_slots)) {
+                    Leaf_t *__next = new_leaf();
+                    __next->prev = __leaf;
+                    if (__leaf) __leaf->next = __next;
+                    else __chain.head = __next;
+                    __leaf = __chain.tail = __next;
+                }
+                __leaf->keys[__leaf->count] = __key;
+                __leaf->values[__leaf->count] = (*__it).second;
+                ++__leaf->count;
+                __prev = &__leaf->keys[__leaf->count - 1];
+            }
+        }
+
+        shbtree_map *tree;      //< loaded tree.
+        const _Iterator *starts;    //< starts of slices of workers.
+        size_type size;         //< count of items.
+        unsigned workers;       //< count of workers.
+        Chain_t *chains;        //< leaves of workers.
+    };
+
+    /**
+     * @short Link chains of leaves to one list from head to tail.
+     */
+    void link_chains(const Chain_t *__chains, unsigned __count) {
+        head = tail = 0;
+        for (unsigned __i = 0; __i < __count; ++__i) {
+            if (!__chains[__i].head) continue;
+            if (tail) tail->next = __chains[__i].head;
+            else head = __chains[__i].head;
+            __chains[__i].head->prev = tail;
+            tail = __chains[__i].tail;
+        }
+    }
+
+    /**
+     * @short Release list of leaves that has no inner levels yet.
+     */
+    void clear_leaves() {
+        while (head) {
+            Leaf_t *__next = head->next;
+            delete_node(head);
+            head = __next;
+        }
+        tail = 0;
+        elements = 0;
+    }
+
+    /**
+     * @short Build inner levels over list of leaves from bulk load. On
+     * exception inner nodes built so far are released, leaves are kept.
+     */
+    void build_inner() {
+        if (!tail) return;
+
+        // last leaf may be almost empty, balance it with previous one
+        Leaf_t *__leaf = tail;
+        if (__leaf->prev && (__leaf->count < leaf_slots / 2)) {
+            Leaf_t *__prev = __leaf->prev;
+            size_type __move = (leaf_slots - __leaf->count) / 2;
+            size_type __n = __leaf->count;
+            for (size_type __i = __n; __i-- > 0;) {
+                __leaf->keys[__i + __move] = __leaf->keys[__i];
+                __leaf->values[__i + __move] = __leaf->values[__i];
+            }
+            for (size_type __i = 0; __i < __move; ++__i) {
+                size_type __src = __prev->count - __move + __i;
+                __leaf->keys[__i] = __prev->keys[__src];
+                __leaf->values[__i] = __prev->values[__src];
+                __prev->keys[__src] = _Key();
+                __prev->values[__src] = _Tp();
+            }
+            __prev->count = static_cast<unsigned short>(__prev->count - __move);
+            __leaf->count = static_cast<unsigned short>(__n + __move);
+        }
+
+        std::vector<std::pair<Node_t *, _Key> > __level;
+        for (__leaf = head; __leaf; __leaf = __leaf->next)
+            __level.push_back(std::make_pair(__leaf, __leaf->keys[0]));
+
+        // build inner levels
+        std::vector<Inner_t *> __built;
+        try {
+            unsigned short __height = 0;
+            while (__level.size() > 1) {
+                ++__height;
+                std::vector<std::pair<Node_t *, _Key> > __upper;
+                size_type __fanout = inner_slots + 1;
+                size_type __nodes = (__level.size() + __fanout - 1) / __fanout;
+                __built.reserve(__built.size() + __nodes);
+                size_type __i = 0;
+                for (size_type __k = 0; __k < __nodes; ++__k) {
+                    // distribute children evenly
+                    size_type __end = (__level.size() * (__k + 1)) / __nodes;
+                    Inner_t *__inner = new_inner(__height);
+                    __built.push_back(__inner);
+                    __upper.push_back(std::make_pair(__inner,
+                                                     __level[__i].second));
+                    __inner->children[0] = __level[__i].first;
+                    for (++__i; __i < __end; ++__i) {
+                        __inner->keys[__inner->count] = __level[__i].second;
+                        __inner->children[++__inner->count]
+                            = __level[__i].first;
+                    }
+                }
+                __level.swap(__upper);
+            }
+        } catch (...) {
+            for (size_type __i = 0; __i < __built.size(); ++__i)
+                delete_node(__built[__i]);
+            throw;
+        }
+        root = __level.front().first;
+    }
+
+    /**
+     * @short Prefetch all cache lines of node.
+     * @param __node node.
+     * @param __size size of node (see node_size()).
+     */
+    static void prefetch(const void *__node, size_type __size) {
+        const char *__p = static_cast<const char *>(__node);
+        for (size_type __i = 0; __i < __size; __i += SHALLOCATOR_CACHE_LINE)
+            __builtin_prefetch(__p + __i);
+    }
+
+    /**
+     * @short Return size of node of level.
+     */
+    static size_type node_size(size_type __level) {
+        return __level? sizeof(Inner_t): sizeof(Leaf_t);
+    }
+
+    /**
+     * @short Index of child of inner node where key belongs.
+     */
+    size_type inner_position(const Inner_t *__inner, const _Key &__key) const {
+        return static_cast<size_type>(Search_t::upper_bound(__inner->keys,
+                    __inner->keys + __inner->count, __key, comp)
+                - __inner->keys);
+    }
+
+    /**
+     * @short Index of first key not less than key in leaf.
+     */
+    size_type leaf_position(const Leaf_t *__leaf, const _Key &__key) const {
+        return static_cast<size_type>(Search_t::lower_bound(__leaf->keys,
+                    __leaf->keys + __leaf->count, __key, comp)
+                - __leaf->keys);
+    }
+
+    /**
+     * @short Find lower or upper bound.
+     */
+    template <typename _Iterator, bool _Upper>
+    _Iterator bound(const _Key &__key) {
+        if (!root) return _Iterator(0, 0, this);
+        Node_t *__node = root;
+        prefetch(__node, node_size(__node->level));
+        while (__node->level) {
+            Inner_t *__inner = static_cast<Inner_t *>(__node);
+            __node = __inner->children[inner_position(__inner, __key)];
+            prefetch(__node, node_size(__inner->level - 1));
+        }
+        Leaf_t *__leaf = static_cast<Leaf_t *>(__node);
+        size_type __pos = _Upper?
+            static_cast<size_type>(std::upper_bound(__leaf->keys,
+                    __leaf->keys + __leaf->count, __key, comp) - __leaf->keys)
+            : leaf_position(__leaf, __key);
+        if (__pos == __leaf->count) return _Iterator(__leaf->next, 0, this);
+        return _Iterator(__leaf, __pos, this);
+    }
+
+    /**
+     * @short Insert key and value to non full leaf.
+     */
+    static void leaf_insert(Leaf_t *__leaf, size_type __pos,
+                            const _Key &__key, const _Tp &__value)
+    {
+        std::copy_backward(__leaf->keys + __pos, __leaf->keys + __leaf->count,
+                           __leaf->keys + __leaf->count + 1);
+        std::copy_backward(__leaf->values + __pos,
+                           __leaf->values + __leaf->count,
+                           __leaf->values + __leaf->count + 1);
+        __leaf->keys[__pos] = __key;
+        __leaf->values[__pos] = __value;
+        ++__leaf->count;
+    }
+
+    /**
+     * @short Insert separator and its right child to non full inner node.
+     */
+    static void inner_insert(Inner_t *__inner, size_type __pos,
+                             const _Key &__key, Node_t *__child)
+    {
+        std::copy_backward(__inner->keys + __pos,
+                           __inner->keys + __inner->count,
+                           __inner->keys + __inner->count + 1);
+        std::copy_backward(__inner->children + __pos + 1,
+                           __inner->children + __inner->count + 1,
+                           __inner->children + __inner->count + 2);
+        __inner->keys[__pos] = __key;
+        __inner->children[__pos + 1] = __child;
+        ++__inner->count;
+    }
+
+    /**
+     * @short Remove child and one of its separators from inner node.
+     */
+    static void inner_remove(Inner_t *__inner, size_type __pos) {
+        size_type __key = __pos? __pos - 1: 0;
+        std::copy(__inner->keys + __key + 1, __inner->keys + __inner->count,
+                  __inner->keys + __key);
+        std::copy(__inner->children + __pos + 1,
+                  __inner->children + __inner->count + 1,
+                  __inner->children + __pos);
+        __inner->keys[--__inner->count] = _Key();
+    }
+
+    /**
+     * @short Allocate empty leaf.
+     */
+    static Leaf_t *new_leaf() {
+        Allocator_t<Leaf_t> __alloc;
+        Leaf_t *__leaf = __alloc.allocate_aligned(1);
+        try {
+            new ((void *)__leaf) Leaf_t();
+        } catch (...) {
+            __alloc.deallocate_aligned(__leaf, 1);
+            throw;
+        }
+        __leaf->level = 0;
+        __leaf->count = 0;
+        __leaf->prev = __leaf->next = 0;
+        return __leaf;
+    }
+
+    /**
+     * @short Allocate empty inner node.
+     */
+    static Inner_t *new_inner(unsigned short __level) {
+        Allocator_t<Inner_t> __alloc;
+        Inner_t *__inner = __alloc.allocate_aligned(1);
+        try {
+            new ((void *)__inner) Inner_t();
+        } catch (...) {
+            __alloc.deallocate_aligned(__inner, 1);
+            throw;
+        }
+        __inner->level = __level;
+        __inner->count = 0;
+        return __inner;
+    }
+
+    /**
+     * @short Destroy and deallocate node.
+     */
+    static void delete_node(Node_t *__node) {
+        if (__node->level) {
+            Allocator_t<Inner_t> __alloc;
+            Inner_t *__inner = static_cast<Inner_t *>(__node);
+            __alloc.destroy(__inner);
+            __alloc.deallocate_aligned(__inner, 1);
+        } else {
+            Allocator_t<Leaf_t> __alloc;
+            Leaf_t *__leaf = static_cast<Leaf_t *>(__node);
+            __alloc.destroy(__leaf);
+            __alloc.deallocate_aligned(__leaf, 1);
+        }
+    }
+
+    /**
+     * @short Release whole subtree.
+     */
+    static void delete_tree(Node_t *__node) {
+        if (__node->level) {
+            Inner_t *__inner = static_cast<Inner_t *>(__node);
+            for (size_type __i = 0; __i <= __inner->count; ++__i)
+                delete_tree(__inner->children[__i]);
+        }
+        delete_node(__node);
+    }
+
+    Node_t *root;       //< root node.
+    Leaf_t *head;       //< first leaf.
+    Leaf_t *tail;       //< last leaf.
+    size_type elements; //< count of elements.
+    _Compare comp;      //< key comparator.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHBTREE_MAP_H */
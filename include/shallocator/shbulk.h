@@ -0,0 +1,286 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Parallel bulk load of shared containers.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHBULK_H
+#define SHALLOCATOR_SHBULK_H
+
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <shallocator/shalloc.h>
+#include <shallocator/shvector.h>
+#include <shallocator/shsharded_map.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Work of one bulk worker.
+ * @param worker index of worker, 0 runs in calling process.
+ * @param arg argument given to run_bulk_workers().
+ */
+typedef void (*BulkWork_t)(unsigned worker, void *arg);
+
+/**
+ * @short Return count of workers for bulk load of items: workers (0 means
+ * count of online CPUs) limited so that each worker gets at least grain
+ * items, at least 1.
+ */
+unsigned bulk_workers(std::size_t items, unsigned workers = 0,
+                      std::size_t grain = 16384);
+
+/**
+ * @short Run work(0, arg) ... work(workers - 1, arg) in parallel.
+ *
+ * Workers are processes, because libmm (and so shmalloc()) is safe for
+ * more processes, not for more threads. Work 0 runs in the calling
+ * process, the others in children forked for it, so they see local data
+ * of caller (copy on write) and write their results to shared memory.
+ * Children exit by _exit() after their work without running any
+ * destructors or atexit handlers. Call it from a single threaded process
+ * holding no process shared lock the work may need.
+ *
+ * Function returns when all workers have finished. If fork fails, this
+ * process does the remaining works itself.
+ *
+ * @param workers count of workers.
+ * @param work function to run.
+ * @param arg argument of work (may point to local memory of caller).
+ * @exception std::bad_alloc, std::invalid_argument, std::runtime_error
+ * when a child's work threw exception of that type (other exceptions
+ * become std::runtime_error); exception of work 0 is passed as is.
+ */
+void run_bulk_workers(unsigned workers, BulkWork_t work, void *arg);
+
+/**
+ * @short Return slice [first, second) of n items processed by worker.
+ */
+inline std::pair<std::size_t, std::size_t>
+bulk_slice(std::size_t __n, unsigned __workers, unsigned __worker) {
+    return std::make_pair(__n * __worker / __workers,
+                          __n * (__worker + 1) / __workers);
+}
+
+/**
+ * @short Store pointer to container that has been built aside (e.g. by
+ * bulk loaders), readers that load the slot by bulk_acquire() see the
+ * complete container or the previous one, never partially built one.
+ * @param __slot pointer stored in shared memory.
+ * @param __fresh new container.
+ * @return previous container; destroy it when no reader can use it.
+ */
+template <typename _Tp>
+inline _Tp *bulk_publish(_Tp **__slot, _Tp *__fresh) {
+    return __atomic_exchange_n(__slot, __fresh, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @short Load container published by bulk_publish().
+ */
+template <typename _Tp>
+inline _Tp *bulk_acquire(_Tp *const *__slot) {
+    return __atomic_load_n(__slot, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @short Workers of bulk loaders.
+ */
+template <typename _Tp, typename _Iterator,
+          typename _Compare = std::less<_Tp> >
+struct BulkLoad_t {
+    /**
+     * @short Prepare load of range, iterators at starts of slices are
+     * computed here in one pass over range.
+     * @param __max_workers max count of workers.
+     */
+    BulkLoad_t(_Iterator __first, _Iterator __last, unsigned __workers,
+               const _Compare &__comp = _Compare(),
+               unsigned __max_workers = ~0U)
+        : size(static_cast<std::size_t>(std::distance(__first, __last))),
+          workers(std::min(bulk_workers(size, __workers), __max_workers)),
+          width(0), data(0), map(0), sort(false), comp(__comp)
+    {
+        typedef typename std::iterator_traits<_Iterator>::difference_type
+            Difference_t;
+        starts.reserve(workers);
+        std::size_t __pos = 0;
+        for (unsigned __i = 0; __i < workers; ++__i) {
+            std::size_t __begin = bulk_slice(size, workers, __i).first;
+            std::advance(__first, static_cast<Difference_t>(__begin - __pos));
+            __pos = __begin;
+            starts.push_back(__first);
+        }
+    }
+
+    /**
+     * @short Copy slice of source to its place in destination, sort it
+     * if requested.
+     */
+    static void copy(unsigned __worker, void *__arg) {
+        BulkLoad_t &__self = *static_cast<BulkLoad_t *>(__arg);
+        std::pair<std::size_t, std::size_t> __slice
+            = bulk_slice(__self.size, __self.workers, __worker);
+        _Iterator __first = __self.starts[__worker];
+        _Tp *__out = __self.data + __slice.first;
+        for (std::size_t __i = __slice.first; __i < __slice.second;
+             ++__i, ++__first)
+            *__out++ = *__first;
+        if (__self.sort)
+            std::sort(__self.data + __slice.first, __out, __self.comp);
+    }
+
+    /**
+     * @short Merge two neighbouring groups of sorted slices (groups of
+     * width slices).
+     */
+    static void merge(unsigned __pair, void *__arg) {
+        BulkLoad_t &__self = *static_cast<BulkLoad_t *>(__arg);
+        unsigned __lo = 2 * __pair * __self.width;
+        unsigned __mid = std::min(__lo + __self.width, __self.workers);
+        unsigned __hi = std::min(__mid + __self.width, __self.workers);
+        std::inplace_merge(
+                __self.data + bulk_slice(__self.size, __self.workers, __lo).first,
+                __self.data + bulk_slice(__self.size, __self.workers, __mid).first,
+                __self.data + bulk_slice(__self.size, __self.workers,
+                                         __hi - 1).second,
+                __self.comp);
+    }
+
+    /**
+     * @short Insert slice of source to map.
+     */
+    template <typename _Map>
+    static void insert(unsigned __worker, void *__arg) {
+        BulkLoad_t &__self = *static_cast<BulkLoad_t *>(__arg);
+        std::pair<std::size_t, std::size_t> __slice
+            = bulk_slice(__self.size, __self.workers, __worker);
+        _Iterator __first = __self.starts[__worker];
+        _Map &__map = *static_cast<_Map *>(__self.map);
+        for (std::size_t __i = __slice.first; __i < __slice.second;
+             ++__i, ++__first)
+            __map.insert(typename _Map::value_type(*__first));
+    }
+
+    std::vector<_Iterator> starts;  //< starts of slices of workers.
+    std::size_t size;       //< count of items.
+    unsigned workers;       //< count of workers (slices).
+    unsigned width;         //< slices in group of merge round.
+    _Tp *data;              //< destination array.
+    void *map;              //< destination map.
+    bool sort;              //< sort slices.
+    _Compare comp;          //< comparator of sort.
+};
+
+/**
+ * @short Replace content of vector by copy of range, in parallel.
+ *
+ * Array is allocated at once (one block) and filled by bulk workers (see
+ * run_bulk_workers()), each copies its slice of range; copies of items
+ * that allocate (e.g. %shstring from std::string) allocate in workers.
+ * Elements are default constructed first, then assigned. On exception
+ * destination is not changed.
+ *
+ * @param __dst destination vector.
+ * @param __first A forward iterator.
+ * @param __last A forward iterator.
+ * @param __workers count of workers (0 means count of online CPUs).
+ */
+template <typename _Tp, typename _ForwardIterator>
+void bulk_assign(shvector<_Tp> &__dst, _ForwardIterator __first,
+                 _ForwardIterator __last, unsigned __workers = 0)
+{
+    BulkLoad_t<_Tp, _ForwardIterator> __load(__first, __last, __workers);
+    shvector<_Tp> __tmp(__load.size);
+    __load.data = __tmp.empty()? 0: &__tmp[0];
+    run_bulk_workers(__load.workers, BulkLoad_t<_Tp, _ForwardIterator>::copy,
+                     &__load);
+    __dst.swap(__tmp);
+}
+
+/**
+ * @short Replace content of vector by sorted copy of range, in parallel.
+ *
+ * Like bulk_assign(), workers sort their slices after copying; sorted
+ * slices are merged in rounds by pairs, each round in parallel.
+ *
+ * @param __dst destination vector.
+ * @param __first A forward iterator.
+ * @param __last A forward iterator.
+ * @param __workers count of workers (0 means count of online CPUs).
+ * @param __comp A comparison functor.
+ */
+template <typename _Tp, typename _ForwardIterator, typename _Compare>
+void bulk_assign_sorted(shvector<_Tp> &__dst, _ForwardIterator __first,
+                        _ForwardIterator __last, unsigned __workers,
+                        _Compare __comp)
+{
+    typedef BulkLoad_t<_Tp, _ForwardIterator, _Compare> Load_t;
+    Load_t __load(__first, __last, __workers, __comp);
+    __load.sort = true;
+    shvector<_Tp> __tmp(__load.size);
+    __load.data = __tmp.empty()? 0: &__tmp[0];
+    run_bulk_workers(__load.workers, Load_t::copy, &__load);
+    for (__load.width = 1; __load.width < __load.workers; __load.width *= 2)
+        run_bulk_workers((__load.workers + 2 * __load.width - 1)
+                         / (2 * __load.width), Load_t::merge, &__load);
+    __dst.swap(__tmp);
+}
+
+/**
+ * @short Replace content of vector by sorted copy of range, in parallel
+ * (ordered by operator<).
+ */
+template <typename _Tp, typename _ForwardIterator>
+void bulk_assign_sorted(shvector<_Tp> &__dst, _ForwardIterator __first,
+                        _ForwardIterator __last, unsigned __workers = 0)
+{
+    bulk_assign_sorted(__dst, __first, __last, __workers, std::less<_Tp>());
+}
+
+/**
+ * @short Insert range to sharded map, in parallel.
+ *
+ * Each bulk worker inserts its slice of range; shards are locked
+ * separately, so workers mostly don't wait for each other (there are at
+ * most _Shards workers). Map must live in shared memory. On exception,
+ * map holds part of range.
+ *
+ * @param __dst destination map.
+ * @param __first A forward iterator.
+ * @param __last A forward iterator.
+ * @param __workers count of workers (0 means count of online CPUs).
+ */
+template <typename _Key, typename _Tp, std::size_t _Shards, typename _Hash,
+          typename _Compare, typename _ForwardIterator>
+void bulk_insert(shsharded_map<_Key, _Tp, _Shards, _Hash, _Compare> &__dst,
+                 _ForwardIterator __first, _ForwardIterator __last,
+                 unsigned __workers = 0)
+{
+    typedef shsharded_map<_Key, _Tp, _Shards, _Hash, _Compare> Map_t;
+    typedef BulkLoad_t<typename Map_t::value_type, _ForwardIterator> Load_t;
+    Load_t __load(__first, __last, __workers, std::less<typename
+                  Map_t::value_type>(), static_cast<unsigned>(_Shards));
+    __load.map = &__dst;
+    run_bulk_workers(__load.workers, Load_t::template insert<Map_t>, &__load);
+}
+
+}
+
+#endif /* SHALLOCATOR_SHBULK_H */
@@ -0,0 +1,585 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory deque with tunable chunk size.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCHUNKED_DEQUE_H
+#define SHALLOCATOR_SHCHUNKED_DEQUE_H
+
+#include <new>
+#include <cstring>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory deque with chunks of _ChunkBytes bytes.
+ *
+ * Unlike %shdeque (libstdc++ uses 512 byte chunks for all types), chunk
+ * size is template parameter; chunks are cache line aligned blocks from
+ * Allocator_t, so scans and pushes touch whole lines of elements only and
+ * big chunks keep first-fit heap from scattering elements. Chunk emptied
+ * by pop is freed at once. Interface is subset of std::deque, iterators
+ * are invalidated by every push, pop, insert and erase.
+ */
+template <typename _Tp, std::size_t _ChunkBytes = 16 * SHALLOCATOR_CACHE_LINE>
+class shchunked_deque {
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// pointer
+    typedef _Tp *pointer;
+    /// const pointer
+    typedef const _Tp *const_pointer;
+    /// size type
+    typedef std::size_t size_type;
+    /// difference type
+    typedef std::ptrdiff_t difference_type;
+
+    /// count of elements in one chunk
+    static const size_type chunk_size
+        = (sizeof(_Tp) < _ChunkBytes)? _ChunkBytes / sizeof(_Tp): 1;
+
+    /**
+     * @short Random access iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::random_access_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): cur(0), first(0), node(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : cur(__other.cur), first(__other.first), node(__other.node) {}
+
+        Iterator_t &operator=(const Iterator_t<_Tp> &__other) {
+            cur = __other.cur;
+            first = __other.first;
+            node = __other.node;
+            return *this;
+        }
+
+        reference operator*() const { return *cur;}
+
+        pointer operator->() const { return cur;}
+
+        reference operator[](difference_type __n) const {
+            return *(*this + __n);
+        }
+
+        Iterator_t &operator++() {
+            if (++cur == first + chunk_size) set_node(node + 1);
+            return *this;
+        }
+
+        Iterator_t &operator--() {
+            if (cur == first) {
+                set_node(node - 1);
+                cur = first + chunk_size;
+            }
+            --cur;
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator+=(difference_type __n) {
+            difference_type __size = static_cast<difference_type>(chunk_size);
+            difference_type __offset = (cur - first) + __n;
+            if ((__offset >= 0) && (__offset < __size)) {
+                cur += __n;
+            } else {
+                difference_type __nodes = (__offset >= 0)? __offset / __size
+                    : -((-__offset - 1) / __size) - 1;
+                set_node(node + __nodes);
+                cur = first + (__offset - __nodes * __size);
+            }
+            return *this;
+        }
+
+        Iterator_t &operator-=(difference_type __n) { return *this += -__n;}
+
+        Iterator_t operator+(difference_type __n) const {
+            Iterator_t __tmp(*this);
+            return __tmp += __n;
+        }
+
+        Iterator_t operator-(difference_type __n) const {
+            Iterator_t __tmp(*this);
+            return __tmp -= __n;
+        }
+
+        difference_type operator-(const Iterator_t &__other) const {
+            return (node - __other.node)
+                * static_cast<difference_type>(chunk_size)
+                + (cur - first) - (__other.cur - __other.first);
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return (node == __other.node)
+                && (cur - first == __other.cur - __other.first);
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return !(*this == __other);
+        }
+
+        bool operator<(const Iterator_t &__other) const {
+            return (node == __other.node)
+                ? (cur - first < __other.cur - __other.first)
+                : (node < __other.node);
+        }
+
+        bool operator>(const Iterator_t &__other) const {
+            return __other < *this;
+        }
+
+        bool operator<=(const Iterator_t &__other) const {
+            return !(__other < *this);
+        }
+
+        bool operator>=(const Iterator_t &__other) const {
+            return !(*this < __other);
+        }
+
+    private:
+        Iterator_t(_Tp **__node, size_type __index)
+            : cur(*__node + __index), first(*__node), node(__node) {}
+
+        /**
+         * @short Move to chunk (map has null sentinel after last chunk).
+         */
+        void set_node(_Tp **__node) {
+            node = __node;
+            first = *__node;
+            cur = first;
+        }
+
+        friend class shchunked_deque;
+        template <typename> friend class Iterator_t;
+
+        _Tp *cur;       //< current element.
+        _Tp *first;     //< first element of current chunk.
+        _Tp **node;     //< slot of current chunk in map.
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shchunked_deque(): map(0), nodes(0), start(0), elements(0) {}
+
+    /**
+     * @short Create a %shchunked_deque with copies of an exemplar element.
+     * @param __n The number of elements to initially create.
+     * @param __value An element to copy.
+     */
+    explicit
+    shchunked_deque(size_type __n, const _Tp &__value = _Tp())
+        : map(0), nodes(0), start(0), elements(0)
+    {
+        resize(__n, __value);
+    }
+
+    /**
+     * @short Builds a %shchunked_deque from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shchunked_deque(_InputIterator __first, _InputIterator __last)
+        : map(0), nodes(0), start(0), elements(0)
+    {
+        try {
+            append_dispatch(__first, __last,
+                Bool_t<std::numeric_limits<_InputIterator>::is_integer>());
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    /**
+     * @short Copy constructor.
+     */
+    shchunked_deque(const shchunked_deque &__other)
+        : map(0), nodes(0), start(0), elements(0)
+    {
+        try {
+            for (const_iterator __it = __other.begin();
+                 __it != __other.end(); ++__it)
+                push_back(*__it);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    /**
+     * @short Destroy elements and free chunks.
+     */
+    ~shchunked_deque() { release();}
+
+    /**
+     * @short Assignment operator.
+     */
+    shchunked_deque &operator=(const shchunked_deque &__other) {
+        if (this != &__other) {
+            shchunked_deque __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap content with other deque.
+     */
+    void swap(shchunked_deque &__other) {
+        std::swap(map, __other.map);
+        std::swap(nodes, __other.nodes);
+        std::swap(start, __other.start);
+        std::swap(elements, __other.elements);
+    }
+
+    iterator begin() { return at_position(start);}
+    const_iterator begin() const { return at_position(start);}
+    iterator end() { return at_position(start + elements);}
+    const_iterator end() const { return at_position(start + elements);}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    reference operator[](size_type __i) { return *slot(start + __i);}
+
+    const_reference operator[](size_type __i) const {
+        return *slot(start + __i);
+    }
+
+    /**
+     * @short Return element at index.
+     * @exception std::out_of_range if index is out of range.
+     */
+    reference at(size_type __i) {
+        check_index(__i);
+        return (*this)[__i];
+    }
+
+    /**
+     * @short Return element at index.
+     * @exception std::out_of_range if index is out of range.
+     */
+    const_reference at(size_type __i) const {
+        check_index(__i);
+        return (*this)[__i];
+    }
+
+    reference front() { return *slot(start);}
+    const_reference front() const { return *slot(start);}
+    reference back() { return *slot(start + elements - 1);}
+    const_reference back() const { return *slot(start + elements - 1);}
+
+    /**
+     * @short Append element.
+     */
+    void push_back(const _Tp &__value) {
+        if (start + elements == nodes * chunk_size) grow_map(false);
+        construct_at(start + elements, __value);
+        ++elements;
+    }
+
+    /**
+     * @short Prepend element.
+     */
+    void push_front(const _Tp &__value) {
+        if (!start) grow_map(true);
+        construct_at(start - 1, __value);
+        --start;
+        ++elements;
+    }
+
+    /**
+     * @short Remove last element.
+     */
+    void pop_back() {
+        size_type __pos = start + --elements;
+        slot(__pos)->~_Tp();
+        if (!elements) reset();
+        else if (!(__pos % chunk_size)) free_chunk(__pos / chunk_size);
+    }
+
+    /**
+     * @short Remove first element.
+     */
+    void pop_front() {
+        slot(start)->~_Tp();
+        ++start;
+        if (!--elements) reset();
+        else if (!(start % chunk_size)) free_chunk(start / chunk_size - 1);
+    }
+
+    /**
+     * @short Insert element before position (elements behind it are
+     * shifted).
+     * @return iterator to inserted element.
+     */
+    iterator insert(iterator __pos, const _Tp &__value) {
+        size_type __index = static_cast<size_type>(__pos - begin());
+        if (__index == elements) {
+            push_back(__value);
+        } else {
+            _Tp __copy(__value);
+            push_back(back());
+            iterator __at = begin() + static_cast<difference_type>(__index);
+            std::copy_backward(__at, end() - 2, end() - 1);
+            *__at = __copy;
+        }
+        return begin() + static_cast<difference_type>(__index);
+    }
+
+    /**
+     * @short Erase element at position.
+     * @return iterator to next element.
+     */
+    iterator erase(iterator __pos) { return erase(__pos, __pos + 1);}
+
+    /**
+     * @short Erase range of elements (elements behind it are shifted).
+     * @return iterator to element after erased ones.
+     */
+    iterator erase(iterator __first, iterator __last) {
+        size_type __index = static_cast<size_type>(__first - begin());
+        size_type __n = static_cast<size_type>(__last - __first);
+        std::copy(__last, end(), __first);
+        for (; __n; --__n) pop_back();
+        return begin() + static_cast<difference_type>(__index);
+    }
+
+    /**
+     * @short Change count of elements.
+     * @param __n new count.
+     * @param __value value of added elements.
+     */
+    void resize(size_type __n, const _Tp &__value = _Tp()) {
+        while (elements > __n) pop_back();
+        while (elements < __n) push_back(__value);
+    }
+
+    /**
+     * @short Erase all elements (map is kept).
+     */
+    void clear() {
+        while (elements) pop_back();
+    }
+
+private:
+    template <bool> struct Bool_t {};
+
+    template <typename _Integer>
+    void append_dispatch(_Integer __n, _Integer __value, Bool_t<true>) {
+        resize(static_cast<size_type>(__n), static_cast<_Tp>(__value));
+    }
+
+    template <typename _InputIterator>
+    void append_dispatch(_InputIterator __first, _InputIterator __last,
+                         Bool_t<false>)
+    {
+        for (; __first != __last; ++__first) push_back(*__first);
+    }
+
+    typedef Allocator_t<_Tp> ChunkAllocator_t;
+    typedef Allocator_t<_Tp *> MapAllocator_t;
+
+    /**
+     * @short Return element slot at position (counted from first element
+     * of chunk map[0]).
+     */
+    _Tp *slot(size_type __pos) const {
+        return map[__pos / chunk_size] + __pos % chunk_size;
+    }
+
+    iterator at_position(size_type __pos) const {
+        if (!map) return iterator();
+        return iterator(map + __pos / chunk_size, __pos % chunk_size);
+    }
+
+    void check_index(size_type __i) const {
+        if (__i >= elements)
+            throw std::out_of_range("shchunked_deque: index out of range");
+    }
+
+    /**
+     * @short Construct element at position, allocate its chunk if needed.
+     */
+    void construct_at(size_type __pos, const _Tp &__value) {
+        _Tp *&__chunk = map[__pos / chunk_size];
+        bool __fresh = !__chunk;
+        if (__fresh)
+            __chunk = ChunkAllocator_t().allocate_aligned(chunk_size);
+        try {
+            new ((void *)(__chunk + __pos % chunk_size)) _Tp(__value);
+        } catch (...) {
+            if (__fresh) free_chunk(__pos / chunk_size);
+            throw;
+        }
+    }
+
+    void free_chunk(size_type __node) {
+        ChunkAllocator_t().deallocate_aligned(map[__node], chunk_size);
+        map[__node] = 0;
+    }
+
+    /**
+     * @short Free chunk of empty deque, next pushes start in the middle
+     * of map.
+     */
+    void reset() {
+        if (map[start / chunk_size]) free_chunk(start / chunk_size);
+        start = nodes / 2 * chunk_size;
+    }
+
+    /**
+     * @short Make room for one chunk before or after used chunks, by
+     * centering chunks in map or by bigger map.
+     */
+    void grow_map(bool __front) {
+        size_type __first = start / chunk_size;
+        size_type __used = elements
+            ? (start + elements + chunk_size - 1) / chunk_size - __first: 0;
+        size_type __needed = __used + 1;
+
+        _Tp **__map = map;
+        size_type __nodes = nodes;
+        if (2 * __needed > nodes) {
+            __nodes = std::max<size_type>(8, 2 * __needed);
+            // one more slot for null sentinel read by iterators
+            __map = MapAllocator_t().allocate(__nodes + 1);
+            std::fill(__map, __map + __nodes + 1, static_cast<_Tp *>(0));
+        }
+        size_type __new_first = (__nodes - __needed) / 2 + (__front? 1: 0);
+        if (__used)
+            std::memmove(__map + __new_first, map + __first,
+                         __used * sizeof(_Tp *));
+        if (__map == map) {
+            // clear slots left behind by shifted chunks
+            for (size_type __i = __first; __i < __first + __used; ++__i)
+                if ((__i < __new_first) || (__i >= __new_first + __used))
+                    __map[__i] = 0;
+        } else if (map) {
+            MapAllocator_t().deallocate(map, nodes + 1);
+        }
+        map = __map;
+        nodes = __nodes;
+        start = __new_first * chunk_size + start % chunk_size;
+    }
+
+    /**
+     * @short Destroy elements, free chunks and map.
+     */
+    void release() {
+        clear();
+        if (map) MapAllocator_t().deallocate(map, nodes + 1);
+        map = 0;
+        nodes = 0;
+        start = 0;
+    }
+
+    _Tp **map;          //< chunks, null for unused slots.
+    size_type nodes;    //< count of slots in map (without sentinel).
+    size_type start;    //< position of first element.
+    size_type elements; //< count of elements.
+};
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator==(const shchunked_deque<_Tp, _ChunkBytes> &__x,
+                       const shchunked_deque<_Tp, _ChunkBytes> &__y)
+{
+    return (__x.size() == __y.size())
+        && std::equal(__x.begin(), __x.end(), __y.begin());
+}
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator!=(const shchunked_deque<_Tp, _ChunkBytes> &__x,
+                       const shchunked_deque<_Tp, _ChunkBytes> &__y)
+{
+    return !(__x == __y);
+}
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator<(const shchunked_deque<_Tp, _ChunkBytes> &__x,
+                      const shchunked_deque<_Tp, _ChunkBytes> &__y)
+{
+    return std::lexicographical_compare(__x.begin(), __x.end(),
+                                        __y.begin(), __y.end());
+}
+
+}
+
+#endif /* SHALLOCATOR_SHCHUNKED_DEQUE_H */
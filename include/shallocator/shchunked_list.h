@@ -0,0 +1,624 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory unrolled list.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCHUNKED_LIST_H
+#define SHALLOCATOR_SHCHUNKED_LIST_H
+
+#include <new>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory unrolled list.
+ *
+ * List of chunks of _ChunkBytes bytes (cache line aligned blocks from
+ * Allocator_t), each chunk keeps contiguous run of elements; %shlist
+ * allocates one node per element instead. Pushes at both ends allocate
+ * only when end chunk is full, insert into full chunk splits it, erase
+ * shifts elements in chunk and merges chunk with next one when both are
+ * less than half full. All iterators are invalidated by insert and erase,
+ * iterators to other chunks stay valid by push and pop.
+ */
+template <typename _Tp, std::size_t _ChunkBytes = 4 * SHALLOCATOR_CACHE_LINE>
+class shchunked_list {
+    /**
+     * @short Links and run of elements of chunk (alone for list head).
+     */
+    struct Header_t {
+        Header_t *prev;     //< previous chunk.
+        Header_t *next;     //< next chunk.
+        unsigned first;     //< slot of first element.
+        unsigned count;     //< count of elements.
+    };
+
+    /// offset of elements in chunk
+    static const std::size_t data_offset
+        = (sizeof(Header_t) + __alignof__(_Tp) - 1)
+        / __alignof__(_Tp) * __alignof__(_Tp);
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// pointer
+    typedef _Tp *pointer;
+    /// const pointer
+    typedef const _Tp *const_pointer;
+    /// size type
+    typedef std::size_t size_type;
+    /// difference type
+    typedef std::ptrdiff_t difference_type;
+
+    /// count of element slots in one chunk
+    static const unsigned chunk_size
+        = (_ChunkBytes >= data_offset + 2 * sizeof(_Tp))
+        ? static_cast<unsigned>((_ChunkBytes - data_offset) / sizeof(_Tp))
+        : 2;
+
+private:
+    /**
+     * @short Chunk of elements.
+     */
+    struct Chunk_t: public Header_t {
+        _Tp *data() { return reinterpret_cast<_Tp *>(storage);}
+
+        char storage[chunk_size * sizeof(_Tp)]
+            __attribute__((aligned(__alignof__(_Tp))));
+    };
+
+    typedef Allocator_t<Chunk_t> ChunkAllocator_t;
+
+    static _Tp *slot(Header_t *__chunk, unsigned __index) {
+        return static_cast<Chunk_t *>(__chunk)->data() + __index;
+    }
+
+public:
+    /**
+     * @short Bidirectional iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): chunk(0), index(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : chunk(__other.chunk), index(__other.index) {}
+
+        Iterator_t &operator=(const Iterator_t<_Tp> &__other) {
+            chunk = __other.chunk;
+            index = __other.index;
+            return *this;
+        }
+
+        reference operator*() const { return *slot(chunk, index);}
+
+        pointer operator->() const { return slot(chunk, index);}
+
+        Iterator_t &operator++() {
+            if (++index == chunk->first + chunk->count) {
+                chunk = chunk->next;
+                index = chunk->first;
+            }
+            return *this;
+        }
+
+        Iterator_t &operator--() {
+            if (index == chunk->first) {
+                chunk = chunk->prev;
+                index = chunk->first + chunk->count;
+            }
+            --index;
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return (chunk == __other.chunk) && (index == __other.index);
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return !(*this == __other);
+        }
+
+    private:
+        Iterator_t(Header_t *__chunk, unsigned __index)
+            : chunk(__chunk), index(__index) {}
+
+        friend class shchunked_list;
+        template <typename> friend class Iterator_t;
+
+        Header_t *chunk;    //< current chunk (list head for end).
+        unsigned index;     //< slot of element in chunk.
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shchunked_list(): elements(0) { init();}
+
+    /**
+     * @short Create a %shchunked_list with copies of an exemplar element.
+     * @param __n The number of elements to initially create.
+     * @param __value An element to copy.
+     */
+    explicit
+    shchunked_list(size_type __n, const _Tp &__value = _Tp()): elements(0) {
+        init();
+        try {
+            resize(__n, __value);
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @short Builds a %shchunked_list from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shchunked_list(_InputIterator __first, _InputIterator __last)
+        : elements(0)
+    {
+        init();
+        try {
+            append_dispatch(__first, __last,
+                Bool_t<std::numeric_limits<_InputIterator>::is_integer>());
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @short Copy constructor.
+     */
+    shchunked_list(const shchunked_list &__other): elements(0) {
+        init();
+        try {
+            for (const_iterator __it = __other.begin();
+                 __it != __other.end(); ++__it)
+                push_back(*__it);
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @short Destroy elements and free chunks.
+     */
+    ~shchunked_list() { clear();}
+
+    /**
+     * @short Assignment operator.
+     */
+    shchunked_list &operator=(const shchunked_list &__other) {
+        if (this != &__other) {
+            shchunked_list __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap content with other list.
+     */
+    void swap(shchunked_list &__other) {
+        std::swap(head.prev, __other.head.prev);
+        std::swap(head.next, __other.head.next);
+        std::swap(elements, __other.elements);
+        relink();
+        __other.relink();
+    }
+
+    iterator begin() { return iterator(head.next, head.next->first);}
+    const_iterator begin() const {
+        return const_iterator(head.next, head.next->first);
+    }
+    iterator end() { return iterator(&head, 0);}
+    const_iterator end() const {
+        return const_iterator(const_cast<Header_t *>(&head), 0);
+    }
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    reference front() { return *slot(head.next, head.next->first);}
+    const_reference front() const {
+        return *slot(head.next, head.next->first);
+    }
+    reference back() {
+        return *slot(head.prev, head.prev->first + head.prev->count - 1);
+    }
+    const_reference back() const {
+        return *slot(head.prev, head.prev->first + head.prev->count - 1);
+    }
+
+    /**
+     * @short Append element.
+     */
+    void push_back(const _Tp &__value) {
+        Header_t *__chunk = head.prev;
+        if ((__chunk == &head)
+            || (__chunk->first + __chunk->count == chunk_size)) {
+            __chunk = new_chunk(&head, 0);
+            construct_fresh(__chunk, 0, __value);
+        } else {
+            new ((void *)slot(__chunk, __chunk->first + __chunk->count))
+                _Tp(__value);
+        }
+        ++__chunk->count;
+        ++elements;
+    }
+
+    /**
+     * @short Prepend element.
+     */
+    void push_front(const _Tp &__value) {
+        Header_t *__chunk = head.next;
+        if ((__chunk == &head) || !__chunk->first) {
+            __chunk = new_chunk(head.next, chunk_size);
+            construct_fresh(__chunk, chunk_size - 1, __value);
+        } else {
+            new ((void *)slot(__chunk, __chunk->first - 1)) _Tp(__value);
+        }
+        --__chunk->first;
+        ++__chunk->count;
+        ++elements;
+    }
+
+    /**
+     * @short Remove last element.
+     */
+    void pop_back() {
+        Header_t *__chunk = head.prev;
+        slot(__chunk, __chunk->first + --__chunk->count)->~_Tp();
+        if (!__chunk->count) free_chunk(__chunk);
+        --elements;
+    }
+
+    /**
+     * @short Remove first element.
+     */
+    void pop_front() {
+        Header_t *__chunk = head.next;
+        slot(__chunk, __chunk->first++)->~_Tp();
+        if (!--__chunk->count) free_chunk(__chunk);
+        --elements;
+    }
+
+    /**
+     * @short Insert element before position.
+     * @return iterator to inserted element.
+     */
+    iterator insert(iterator __pos, const _Tp &__value) {
+        if (__pos.chunk == &head) {
+            push_back(__value);
+            return iterator(head.prev, head.prev->first + head.prev->count - 1);
+        }
+        if ((__pos.index == __pos.chunk->first) && __pos.chunk->first) {
+            // room before first element of chunk
+            Header_t *__chunk = __pos.chunk;
+            new ((void *)slot(__chunk, __chunk->first - 1)) _Tp(__value);
+            --__chunk->first;
+            ++__chunk->count;
+            ++elements;
+            return iterator(__chunk, __chunk->first);
+        }
+
+        _Tp __copy(__value);
+        Header_t *__chunk = __pos.chunk;
+        unsigned __k = __pos.index - __chunk->first;
+        if (__chunk->count == chunk_size) {
+            Header_t *__upper = split(__chunk);
+            if (__k > __chunk->count) {
+                __k -= __chunk->count;
+                __chunk = __upper;
+            }
+        }
+        if (__chunk->first + __chunk->count == chunk_size) compact(__chunk);
+
+        // shift tail of run by one slot
+        _Tp *__data = slot(__chunk, __chunk->first);
+        unsigned __n = __chunk->count;
+        new ((void *)(__data + __n)) _Tp((__k == __n)? __copy: __data[__n - 1]);
+        ++__chunk->count;
+        ++elements;
+        if (__k != __n) {
+            std::copy_backward(__data + __k, __data + __n - 1, __data + __n);
+            __data[__k] = __copy;
+        }
+        return iterator(__chunk, __chunk->first + __k);
+    }
+
+    /**
+     * @short Erase element at position.
+     * @return iterator to next element.
+     */
+    iterator erase(iterator __pos) {
+        Header_t *__chunk = __pos.chunk;
+        unsigned __k = __pos.index - __chunk->first;
+        _Tp *__data = slot(__chunk, __chunk->first);
+        if (!__k) {
+            // first element, just move start of run
+            __data->~_Tp();
+            ++__chunk->first;
+        } else {
+            std::copy(__data + __k + 1, __data + __chunk->count,
+                      __data + __k);
+            __data[__chunk->count - 1].~_Tp();
+        }
+        --__chunk->count;
+        --elements;
+
+        if (!__chunk->count) {
+            Header_t *__next = __chunk->next;
+            free_chunk(__chunk);
+            return iterator(__next, __next->first);
+        }
+        Header_t *__next = __chunk->next;
+        if ((__next != &head)
+            && (2 * (__chunk->count + __next->count) <= chunk_size))
+            merge(__chunk);
+        if (__k == __chunk->count)
+            return iterator(__chunk->next, __chunk->next->first);
+        return iterator(__chunk, __chunk->first + __k);
+    }
+
+    /**
+     * @short Erase range of elements.
+     * @return iterator to element after erased ones.
+     */
+    iterator erase(iterator __first, iterator __last) {
+        // erase may move elements of next chunk, so count them first
+        for (difference_type __n = std::distance(__first, __last); __n; --__n)
+            __first = erase(__first);
+        return __first;
+    }
+
+    /**
+     * @short Change count of elements.
+     * @param __n new count.
+     * @param __value value of added elements.
+     */
+    void resize(size_type __n, const _Tp &__value = _Tp()) {
+        while (elements > __n) pop_back();
+        while (elements < __n) push_back(__value);
+    }
+
+    /**
+     * @short Erase all elements.
+     */
+    void clear() {
+        while (head.next != &head) {
+            Header_t *__chunk = head.next;
+            _Tp *__data = slot(__chunk, __chunk->first);
+            for (unsigned __i = 0; __i < __chunk->count; ++__i)
+                __data[__i].~_Tp();
+            free_chunk(__chunk);
+        }
+        elements = 0;
+    }
+
+private:
+    template <bool> struct Bool_t {};
+
+    template <typename _Integer>
+    void append_dispatch(_Integer __n, _Integer __value, Bool_t<true>) {
+        resize(static_cast<size_type>(__n), static_cast<_Tp>(__value));
+    }
+
+    template <typename _InputIterator>
+    void append_dispatch(_InputIterator __first, _InputIterator __last,
+                         Bool_t<false>)
+    {
+        for (; __first != __last; ++__first) push_back(*__first);
+    }
+
+    void init() {
+        head.prev = head.next = &head;
+        head.first = head.count = 0;
+    }
+
+    /**
+     * @short Point neighbours of head back to head (after swap).
+     */
+    void relink() {
+        if (!elements) {
+            init();
+        } else {
+            head.next->prev = &head;
+            head.prev->next = &head;
+        }
+    }
+
+    /**
+     * @short Allocate empty chunk and link it before chunk.
+     */
+    Header_t *new_chunk(Header_t *__before, unsigned __first) {
+        Header_t *__chunk = ChunkAllocator_t().allocate_aligned(1);
+        __chunk->first = __first;
+        __chunk->count = 0;
+        __chunk->next = __before;
+        __chunk->prev = __before->prev;
+        __before->prev->next = __chunk;
+        __before->prev = __chunk;
+        return __chunk;
+    }
+
+    /**
+     * @short Construct element in chunk just allocated by new_chunk(),
+     * free chunk on exception.
+     */
+    void construct_fresh(Header_t *__chunk, unsigned __index,
+                         const _Tp &__value)
+    {
+        try {
+            new ((void *)slot(__chunk, __index)) _Tp(__value);
+        } catch (...) {
+            free_chunk(__chunk);
+            throw;
+        }
+    }
+
+    void free_chunk(Header_t *__chunk) {
+        __chunk->prev->next = __chunk->next;
+        __chunk->next->prev = __chunk->prev;
+        ChunkAllocator_t().deallocate_aligned(static_cast<Chunk_t *>(__chunk),
+                                              1);
+    }
+
+    /**
+     * @short Move elements between slots (source slots are destroyed).
+     */
+    static void relocate(_Tp *__src, unsigned __n, _Tp *__dst) {
+        for (unsigned __i = 0; __i < __n; ++__i) {
+            new ((void *)(__dst + __i)) _Tp(__src[__i]);
+            __src[__i].~_Tp();
+        }
+    }
+
+    /**
+     * @short Move run of elements to the start of chunk.
+     */
+    static void compact(Header_t *__chunk) {
+        if (!__chunk->first) return;
+        _Tp *__data = slot(__chunk, 0);
+        for (unsigned __i = 0; __i < __chunk->count; ++__i) {
+            new ((void *)(__data + __i)) _Tp(__data[__chunk->first + __i]);
+            __data[__chunk->first + __i].~_Tp();
+        }
+        __chunk->first = 0;
+    }
+
+    /**
+     * @short Move upper half of full chunk to new chunk after it.
+     * @return new chunk.
+     */
+    Header_t *split(Header_t *__chunk) {
+        Header_t *__upper = new_chunk(__chunk->next, 0);
+        unsigned __half = __chunk->count / 2;
+        relocate(slot(__chunk, __chunk->first + __half),
+                 __chunk->count - __half, slot(__upper, 0));
+        __upper->count = __chunk->count - __half;
+        __chunk->count = __half;
+        return __upper;
+    }
+
+    /**
+     * @short Move elements of next chunk to chunk and free next chunk.
+     */
+    void merge(Header_t *__chunk) {
+        Header_t *__next = __chunk->next;
+        if (__chunk->first + __chunk->count + __next->count > chunk_size)
+            compact(__chunk);
+        relocate(slot(__next, __next->first), __next->count,
+                 slot(__chunk, __chunk->first + __chunk->count));
+        __chunk->count += __next->count;
+        free_chunk(__next);
+    }
+
+    Header_t head;          //< list head (end of list).
+    size_type elements;     //< count of elements.
+};
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator==(const shchunked_list<_Tp, _ChunkBytes> &__x,
+                       const shchunked_list<_Tp, _ChunkBytes> &__y)
+{
+    return (__x.size() == __y.size())
+        && std::equal(__x.begin(), __x.end(), __y.begin());
+}
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator!=(const shchunked_list<_Tp, _ChunkBytes> &__x,
+                       const shchunked_list<_Tp, _ChunkBytes> &__y)
+{
+    return !(__x == __y);
+}
+
+template <typename _Tp, std::size_t _ChunkBytes>
+inline bool operator<(const shchunked_list<_Tp, _ChunkBytes> &__x,
+                      const shchunked_list<_Tp, _ChunkBytes> &__y)
+{
+    return std::lexicographical_compare(__x.begin(), __x.end(),
+                                        __y.begin(), __y.end());
+}
+
+}
+
+#endif /* SHALLOCATOR_SHCHUNKED_LIST_H */
@@ -0,0 +1,930 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory columnar (structure of arrays) container.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCOLUMNS_H
+#define SHALLOCATOR_SHCOLUMNS_H
+
+#include <stdint.h>
+#include <new>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shbitset.h>
+#include <shallocator/shsimd.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Scan kernels over arrays of arithmetic type (integers of 1, 2, 4
+ * or 8 bytes, float, double).
+ */
+struct ColumnKernels_t {
+    /// comparison of filter (element op value)
+    enum Op_t { LESS, LESS_EQUAL, EQUAL, NOT_EQUAL, GREATER_EQUAL, GREATER };
+
+    /**
+     * @short Accumulator of sum: 64 bit integer of the same signedness or
+     * double.
+     */
+    template <typename _Tp, bool = std::numeric_limits<_Tp>::is_integer,
+              bool = std::numeric_limits<_Tp>::is_signed>
+    struct Sum_t { typedef double type;};
+
+    template <typename _Tp>
+    struct Sum_t<_Tp, true, true> { typedef int64_t type;};
+
+    template <typename _Tp>
+    struct Sum_t<_Tp, true, false> { typedef uint64_t type;};
+
+    /**
+     * @short Sum n elements (integers modulo 2^64, floating point sum is
+     * reassociated).
+     */
+    template <typename _Tp>
+    static typename Sum_t<_Tp>::type sum(const _Tp *__a, std::size_t __n) {
+        Check_t<_Tp>();
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return sum_avx2(__a, __n);
+#endif
+        return sum_body(__a, __n);
+    }
+
+    /**
+     * @short Find the least and the greatest of n > 0 elements (result is
+     * unspecified if there is NaN).
+     */
+    template <typename _Tp>
+    static void min_max(const _Tp *__a, std::size_t __n,
+                        _Tp &__min, _Tp &__max)
+    {
+        Check_t<_Tp>();
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return min_max_avx2(__a, __n, __min, __max);
+#endif
+        min_max_body<16>(__a, __n, __min, __max);
+    }
+
+    /**
+     * @short Set bit i of mask iff (a[i] op value) for n elements; all
+     * (n + 63) / 64 words of mask are written.
+     */
+    template <typename _Tp>
+    static void filter(Op_t __op, const _Tp *__a, std::size_t __n,
+                       const _Tp &__value, uint64_t *__mask)
+    {
+        Check_t<_Tp>();
+        switch (__op) {
+        case LESS: filter<LESS>(__a, __n, __value, __mask); return;
+        case LESS_EQUAL: filter<LESS_EQUAL>(__a, __n, __value, __mask); return;
+        case EQUAL: filter<EQUAL>(__a, __n, __value, __mask); return;
+        case NOT_EQUAL: filter<NOT_EQUAL>(__a, __n, __value, __mask); return;
+        case GREATER_EQUAL:
+            filter<GREATER_EQUAL>(__a, __n, __value, __mask);
+            return;
+        case GREATER: filter<GREATER>(__a, __n, __value, __mask); return;
+        }
+    }
+
+private:
+// r = a op b, works for elements and vectors of elements; vector operands
+// are not passed to template function because it would drop their
+// alignment.
+#define SHALLOCATOR_COLUMNS_CMP(_Op, __r, __a, __b)     \
+    switch (_Op) {                                      \
+    case LESS: (__r) = (__a) < (__b); break;            \
+    case LESS_EQUAL: (__r) = (__a) <= (__b); break;     \
+    case EQUAL: (__r) = (__a) == (__b); break;          \
+    case NOT_EQUAL: (__r) = (__a) != (__b); break;      \
+    case GREATER_EQUAL: (__r) = (__a) >= (__b); break;  \
+    default: (__r) = (__a) > (__b); break;              \
+    }
+
+    /**
+     * @short Refuse types that vector extensions can't hold.
+     */
+    template <typename _Tp>
+    struct Check_t {
+        typedef char TypeCheck_t[(std::numeric_limits<_Tp>::is_specialized
+                                  && ((sizeof(_Tp) == 1) || (sizeof(_Tp) == 2)
+                                      || (sizeof(_Tp) == 4)
+                                      || (sizeof(_Tp) == 8)))? 1: -1];
+    };
+
+    /**
+     * @short Four elements per step widened to accumulator, two
+     * independent sums. Inlined to both generic and AVX2 variant.
+     */
+    template <typename _Tp>
+    __attribute__((always_inline))
+    static inline typename Sum_t<_Tp>::type
+    sum_body(const _Tp *__a, std::size_t __n) {
+        typedef typename Sum_t<_Tp>::type _Acc;
+        typedef _Tp vt_t __attribute__((vector_size(4 * sizeof(_Tp)),
+                                        aligned(sizeof(_Tp))));
+        typedef _Acc va_t __attribute__((vector_size(4 * sizeof(_Acc))));
+        va_t __s0 = {0, 0, 0, 0};
+        va_t __s1 = __s0;
+        std::size_t __i = 0;
+        for (; __i + 8 <= __n; __i += 8) {
+            __s0 += __builtin_convertvector(
+                    *reinterpret_cast<const vt_t *>(__a + __i), va_t);
+            __s1 += __builtin_convertvector(
+                    *reinterpret_cast<const vt_t *>(__a + __i + 4), va_t);
+        }
+        __s0 += __s1;
+        _Acc __sum = (__s0[0] + __s0[1]) + (__s0[2] + __s0[3]);
+        for (; __i < __n; ++__i) __sum += static_cast<_Acc>(__a[__i]);
+        return __sum;
+    }
+
+    /**
+     * @short Lane-wise min and max over vectors of _Bytes bytes (16 is
+     * SSE2 baseline of x86_64, other platforms get scalar code from
+     * vector extensions).
+     */
+    template <std::size_t _Bytes, typename _Tp>
+    __attribute__((always_inline))
+    static inline void min_max_body(const _Tp *__a, std::size_t __n,
+                                    _Tp &__min, _Tp &__max)
+    {
+        typedef _Tp v_t __attribute__((vector_size(_Bytes),
+                                       aligned(sizeof(_Tp))));
+        const std::size_t __lanes = _Bytes / sizeof(_Tp);
+        __min = __max = __a[0];
+        std::size_t __i = 0;
+        if (__n >= 2 * __lanes) {
+            v_t __lo = *reinterpret_cast<const v_t *>(__a);
+            v_t __hi = __lo;
+            for (__i = __lanes; __i + __lanes <= __n; __i += __lanes) {
+                v_t __x = *reinterpret_cast<const v_t *>(__a + __i);
+                __lo = (__x < __lo)? __x: __lo;
+                __hi = (__hi < __x)? __x: __hi;
+            }
+            for (std::size_t __j = 0; __j < __lanes; ++__j) {
+                if (__lo[__j] < __min) __min = __lo[__j];
+                if (__max < __hi[__j]) __max = __hi[__j];
+            }
+        }
+        for (; __i < __n; ++__i) {
+            if (__a[__i] < __min) __min = __a[__i];
+            if (__max < __a[__i]) __max = __a[__i];
+        }
+    }
+
+    template <int _Op, typename _Tp>
+    static void filter(const _Tp *__a, std::size_t __n, const _Tp &__value,
+                       uint64_t *__mask)
+    {
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return filter_avx2<_Op>(__a, __n, __value, __mask);
+#endif
+        filter_generic<_Op>(__a, __n, __value, __mask);
+    }
+
+    /**
+     * @short Branch free scalar filter, one mask word per 64 elements.
+     */
+    template <int _Op, typename _Tp>
+    static void filter_generic(const _Tp *__a, std::size_t __n,
+                               const _Tp &__value, uint64_t *__mask)
+    {
+        for (std::size_t __i = 0; __i < __n; __i += 64) {
+            std::size_t __m = std::min<std::size_t>(64, __n - __i);
+            uint64_t __word = 0;
+            for (std::size_t __j = 0; __j < __m; ++__j) {
+                bool __hit;
+                SHALLOCATOR_COLUMNS_CMP(_Op, __hit, __a[__i + __j], __value);
+                __word |= uint64_t(__hit) << __j;
+            }
+            *__mask++ = __word;
+        }
+    }
+
+#ifdef SHALLOCATOR_X86_SIMD
+    template <typename _Tp>
+    __attribute__((target("avx2")))
+    static typename Sum_t<_Tp>::type sum_avx2(const _Tp *__a,
+                                              std::size_t __n)
+    {
+        return sum_body(__a, __n);
+    }
+
+    template <typename _Tp>
+    __attribute__((target("avx2")))
+    static void min_max_avx2(const _Tp *__a, std::size_t __n,
+                             _Tp &__min, _Tp &__max)
+    {
+        min_max_body<32>(__a, __n, __min, __max);
+    }
+
+    /**
+     * @short Compare 32 bytes at once, sign bits of lane masks are packed
+     * to mask word by movemask.
+     */
+    template <int _Op, typename _Tp>
+    __attribute__((target("avx2")))
+    static void filter_avx2(const _Tp *__a, std::size_t __n,
+                            const _Tp &__value, uint64_t *__mask)
+    {
+        typedef _Tp v_t __attribute__((vector_size(32), aligned(sizeof(_Tp))));
+        typedef char vb_t __attribute__((vector_size(32)));
+        typedef float vf_t __attribute__((vector_size(32)));
+        typedef double vd_t __attribute__((vector_size(32)));
+        const std::size_t __lanes = 32 / sizeof(_Tp);
+
+        std::size_t __i = 0;
+        for (; __i + 64 <= __n; __i += 64) {
+            uint64_t __word = 0;
+            for (std::size_t __j = 0; __j < 64; __j += __lanes) {
+                v_t __x = *reinterpret_cast<const v_t *>(__a + __i + __j);
+                __typeof__(__x < __x) __hit;
+                SHALLOCATOR_COLUMNS_CMP(_Op, __hit, __x, __value);
+                // casts between vectors of the same size keep bits
+                uint32_t __bits;
+                switch (sizeof(_Tp)) {
+                case 8:
+                    __bits = static_cast<uint32_t>(
+                            __builtin_ia32_movmskpd256(
+                                (vd_t)__hit));
+                    break;
+                case 4:
+                    __bits = static_cast<uint32_t>(
+                            __builtin_ia32_movmskps256(
+                                (vf_t)__hit));
+                    break;
+                case 2:
+                    __bits = static_cast<uint32_t>(
+                            __builtin_ia32_pmovmskb256(
+                                (vb_t)__hit));
+                    __bits = even_bits(__bits);
+                    break;
+                default:
+                    __bits = static_cast<uint32_t>(
+                            __builtin_ia32_pmovmskb256(
+                                (vb_t)__hit));
+                    break;
+                }
+                __word |= uint64_t(__bits) << __j;
+            }
+            *__mask++ = __word;
+        }
+        filter_generic<_Op>(__a + __i, __n - __i, __value, __mask);
+    }
+
+    /**
+     * @short Pack even bits of word to its lower half.
+     */
+    static uint32_t even_bits(uint32_t __x) {
+        __x &= 0x55555555u;
+        __x = (__x | (__x >> 1)) & 0x33333333u;
+        __x = (__x | (__x >> 2)) & 0x0f0f0f0fu;
+        __x = (__x | (__x >> 4)) & 0x00ff00ffu;
+        return (__x | (__x >> 8)) & 0x0000ffffu;
+    }
+#endif
+
+#undef SHALLOCATOR_COLUMNS_CMP
+};
+
+/**
+ * @short Placeholder of unused column of %shcolumns.
+ */
+struct NoColumn_t {};
+
+/**
+ * @short Terminator of column list of %shcolumns.
+ */
+struct ColumnsEnd_t {
+    static const std::size_t count = 0;
+
+    void relocate(std::size_t, std::size_t, std::size_t) {}
+    void construct(std::size_t, const void *const *) {}
+    void construct(std::size_t, const ColumnsEnd_t &, std::size_t) {}
+    void destroy(std::size_t, std::size_t) {}
+    void deallocate(std::size_t) {}
+    void move(std::size_t, std::size_t, std::size_t) {}
+    void swap(ColumnsEnd_t &) {}
+};
+
+/**
+ * @short Column of type _Tp followed by the other columns. All columns
+ * have the same count of elements and the same capacity, kept by
+ * %shcolumns; every operation works on all columns and leaves them
+ * unchanged if it throws.
+ */
+template <typename _Tp, typename _Next>
+struct ColumnsNode_t {
+    typedef _Tp value_type;
+    typedef _Next next_type;
+
+    static const std::size_t count = 1 + _Next::count;
+
+    ColumnsNode_t(): data(0) {}
+
+    /**
+     * @short Move n elements of all columns to new arrays of given
+     * capacity.
+     */
+    void relocate(std::size_t __n, std::size_t __old, std::size_t __cap) {
+        _Tp *__fresh = Allocator_t<_Tp>().allocate(__cap);
+        try {
+            std::uninitialized_copy(data, data + __n, __fresh);
+        } catch (...) {
+            Allocator_t<_Tp>().deallocate(__fresh, __cap);
+            throw;
+        }
+        try {
+            next.relocate(__n, __old, __cap);
+        } catch (...) {
+            destroy_range(__fresh, __fresh + __n);
+            Allocator_t<_Tp>().deallocate(__fresh, __cap);
+            throw;
+        }
+        destroy_range(data, data + __n);
+        if (data) Allocator_t<_Tp>().deallocate(data, __old);
+        data = __fresh;
+    }
+
+    /**
+     * @short Construct row i from array of pointers to fields.
+     */
+    void construct(std::size_t __i, const void *const *__values) {
+        ::new (static_cast<void *>(data + __i))
+            _Tp(*static_cast<const _Tp *>(__values[0]));
+        try {
+            next.construct(__i, __values + 1);
+        } catch (...) {
+            data[__i].~_Tp();
+            throw;
+        }
+    }
+
+    /**
+     * @short Construct row i as copy of row j of other columns.
+     */
+    void construct(std::size_t __i, const ColumnsNode_t &__other,
+                   std::size_t __j)
+    {
+        ::new (static_cast<void *>(data + __i)) _Tp(__other.data[__j]);
+        try {
+            next.construct(__i, __other.next, __j);
+        } catch (...) {
+            data[__i].~_Tp();
+            throw;
+        }
+    }
+
+    /**
+     * @short Destroy rows [first, last).
+     */
+    void destroy(std::size_t __first, std::size_t __last) {
+        destroy_range(data + __first, data + __last);
+        next.destroy(__first, __last);
+    }
+
+    /**
+     * @short Free arrays of given capacity.
+     */
+    void deallocate(std::size_t __cap) {
+        if (data) Allocator_t<_Tp>().deallocate(data, __cap);
+        data = 0;
+        next.deallocate(__cap);
+    }
+
+    /**
+     * @short Assign rows [from, n) to rows starting at to (to < from).
+     */
+    void move(std::size_t __to, std::size_t __from, std::size_t __n) {
+        std::copy(data + __from, data + __n, data + __to);
+        next.move(__to, __from, __n);
+    }
+
+    void swap(ColumnsNode_t &__other) {
+        std::swap(data, __other.data);
+        next.swap(__other.next);
+    }
+
+    static void destroy_range(_Tp *__first, _Tp *__last) {
+        for (; __first != __last; ++__first) __first->~_Tp();
+    }
+
+    _Tp *data;      //< elements of column.
+    _Next next;     //< next columns.
+};
+
+/**
+ * @short Build column list from template arguments of %shcolumns.
+ */
+template <typename _T0, typename _T1, typename _T2, typename _T3,
+          typename _T4, typename _T5, typename _T6, typename _T7>
+struct ColumnsList_t {
+    typedef ColumnsNode_t<_T0, typename ColumnsList_t<_T1, _T2, _T3, _T4,
+            _T5, _T6, _T7, NoColumn_t>::type> type;
+};
+
+template <typename _T1, typename _T2, typename _T3, typename _T4,
+          typename _T5, typename _T6, typename _T7>
+struct ColumnsList_t<NoColumn_t, _T1, _T2, _T3, _T4, _T5, _T6, _T7> {
+    typedef ColumnsEnd_t type;
+};
+
+/**
+ * @short Find column I in column list.
+ */
+template <std::size_t _I, typename _Node>
+struct ColumnAt_t {
+    typedef ColumnAt_t<_I - 1, typename _Node::next_type> Next_t;
+    typedef typename Next_t::type type;
+
+    static type *get(const _Node &__node) { return Next_t::get(__node.next);}
+};
+
+template <typename _Node>
+struct ColumnAt_t<0, _Node> {
+    typedef typename _Node::value_type type;
+
+    static type *get(const _Node &__node) { return __node.data;}
+};
+
+/**
+ * @short Shared memory table stored by columns (structure of arrays).
+ *
+ * Each field (up to eight of them) lives in its own contiguous array
+ * allocated by Allocator_t, so scan of one field reads only that field
+ * from memory. Arithmetic columns have vectorized kernels: sum(),
+ * min(), max() and filter() that combine with shdynamic_bitset
+ * operations for predicates over more columns.
+ *
+ * Rows are reachable by proxy objects (operator[], begin(), end()) whose
+ * get<I>() returns reference to field of row, similar to tuple of
+ * references. Proxies and iterators are invalidated as pointers into
+ * std::vector are.
+ */
+template <typename _T0, typename _T1 = NoColumn_t, typename _T2 = NoColumn_t,
+          typename _T3 = NoColumn_t, typename _T4 = NoColumn_t,
+          typename _T5 = NoColumn_t, typename _T6 = NoColumn_t,
+          typename _T7 = NoColumn_t>
+class shcolumns {
+    typedef typename ColumnsList_t<_T0, _T1, _T2, _T3, _T4, _T5, _T6, _T7>
+        ::type Columns_t;
+
+    /**
+     * @short Add const to field type of const table.
+     */
+    template <typename _Table, typename _Tp>
+    struct Const_t { typedef _Tp type;};
+
+    template <typename _Tp>
+    struct Const_t<const shcolumns, _Tp> { typedef const _Tp type;};
+
+public:
+    /// size type
+    typedef std::size_t size_type;
+    /// difference type
+    typedef std::ptrdiff_t difference_type;
+
+    /// count of columns
+    static const size_type columns = Columns_t::count;
+
+    /**
+     * @short Type of column I.
+     */
+    template <size_type _I>
+    struct column_type {
+        typedef typename ColumnAt_t<_I, Columns_t>::type type;
+    };
+
+    /**
+     * @short Proxy of one row.
+     */
+    template <typename _Table>
+    class Row_t {
+    public:
+        /**
+         * @short Conversion from non const row.
+         */
+        Row_t(const Row_t<shcolumns> &__other)
+            : table(__other.table), row(__other.row) {}
+
+        /**
+         * @short Return field I of row.
+         */
+        template <size_type _I>
+        typename Const_t<_Table, typename column_type<_I>::type>::type &
+        get() const {
+            return table->template column<_I>()[row];
+        }
+
+        /**
+         * @short Return index of row.
+         */
+        size_type index() const { return row;}
+
+    private:
+        Row_t(_Table *__table, size_type __row): table(__table), row(__row) {}
+
+        friend class shcolumns;
+        template <typename> friend class Row_t;
+        template <typename> friend class Iterator_t;
+
+        _Table *table;  //< owning table.
+        size_type row;  //< index of row.
+    };
+
+    /// row proxy
+    typedef Row_t<shcolumns> reference;
+    /// const row proxy
+    typedef Row_t<const shcolumns> const_reference;
+
+    /**
+     * @short Iterator over rows with random access arithmetic,
+     * dereference gives proxy.
+     */
+    template <typename _Table>
+    class Iterator_t {
+    public:
+        /// iterator category (reference is proxy, so algorithms that
+        /// swap or move values through it don't work)
+        typedef std::random_access_iterator_tag iterator_category;
+        /// value type
+        typedef Row_t<_Table> value_type;
+        /// reference type
+        typedef Row_t<_Table> reference;
+        /// pointer type
+        typedef void pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): table(0), row(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<shcolumns> &__other)
+            : table(__other.table), row(__other.row) {}
+
+        reference operator*() const { return reference(table, row);}
+
+        reference operator[](difference_type __n) const {
+            return reference(table, row + __n);
+        }
+
+        Iterator_t &operator++() { ++row; return *this;}
+        Iterator_t &operator--() { --row; return *this;}
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++row;
+            return __tmp;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --row;
+            return __tmp;
+        }
+
+        Iterator_t &operator+=(difference_type __n) {
+            row += __n;
+            return *this;
+        }
+
+        Iterator_t &operator-=(difference_type __n) {
+            row -= __n;
+            return *this;
+        }
+
+        Iterator_t operator+(difference_type __n) const {
+            return Iterator_t(table, row + __n);
+        }
+
+        Iterator_t operator-(difference_type __n) const {
+            return Iterator_t(table, row - __n);
+        }
+
+        difference_type operator-(const Iterator_t &__other) const {
+            return difference_type(row) - difference_type(__other.row);
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return row == __other.row;
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return row != __other.row;
+        }
+
+        bool operator<(const Iterator_t &__other) const {
+            return row < __other.row;
+        }
+
+        bool operator>(const Iterator_t &__other) const {
+            return row > __other.row;
+        }
+
+        bool operator<=(const Iterator_t &__other) const {
+            return row <= __other.row;
+        }
+
+        bool operator>=(const Iterator_t &__other) const {
+            return row >= __other.row;
+        }
+
+        friend Iterator_t operator+(difference_type __n,
+                                    const Iterator_t &__it)
+        {
+            return __it + __n;
+        }
+
+    private:
+        Iterator_t(_Table *__table, size_type __row)
+            : table(__table), row(__row) {}
+
+        friend class shcolumns;
+        template <typename> friend class Iterator_t;
+
+        _Table *table;  //< owning table.
+        size_type row;  //< index of row.
+    };
+
+    /// iterator
+    typedef Iterator_t<shcolumns> iterator;
+    /// const iterator
+    typedef Iterator_t<const shcolumns> const_iterator;
+
+    /**
+     * @short Default constructor creates no rows.
+     */
+    shcolumns(): rows(0), space(0) {}
+
+    /**
+     * @short Copy constructor.
+     */
+    shcolumns(const shcolumns &__other): rows(0), space(0) {
+        reserve(__other.rows);
+        for (; rows < __other.rows; ++rows)
+            try {
+                data.construct(rows, __other.data, rows);
+            } catch (...) {
+                clear();
+                data.deallocate(space);
+                throw;
+            }
+    }
+
+    /**
+     * @short Destroy rows and free columns.
+     */
+    ~shcolumns() {
+        clear();
+        data.deallocate(space);
+    }
+
+    /**
+     * @short Assignment operator.
+     */
+    shcolumns &operator=(const shcolumns &__other) {
+        if (this != &__other) {
+            shcolumns __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap content with other table.
+     */
+    void swap(shcolumns &__other) {
+        data.swap(__other.data);
+        std::swap(rows, __other.rows);
+        std::swap(space, __other.space);
+    }
+
+    iterator begin() { return iterator(this, 0);}
+    const_iterator begin() const { return const_iterator(this, 0);}
+    iterator end() { return iterator(this, rows);}
+    const_iterator end() const { return const_iterator(this, rows);}
+
+    /**
+     * @short Return proxy of row i.
+     */
+    reference operator[](size_type __i) { return reference(this, __i);}
+
+    /**
+     * @short Return proxy of row i.
+     */
+    const_reference operator[](size_type __i) const {
+        return const_reference(this, __i);
+    }
+
+    /**
+     * @short Return proxy of last row.
+     */
+    reference back() { return reference(this, rows - 1);}
+
+    /**
+     * @short Return contiguous array of column I (size() elements).
+     */
+    template <size_type _I>
+    typename column_type<_I>::type *column() {
+        return ColumnAt_t<_I, Columns_t>::get(data);
+    }
+
+    /**
+     * @short Return contiguous array of column I (size() elements).
+     */
+    template <size_type _I>
+    const typename column_type<_I>::type *column() const {
+        return ColumnAt_t<_I, Columns_t>::get(data);
+    }
+
+    /**
+     * @short Return count of rows.
+     */
+    size_type size() const { return rows;}
+
+    /**
+     * @short Return true if there is no row.
+     */
+    bool empty() const { return !rows;}
+
+    /**
+     * @short Return count of rows that fit without reallocation.
+     */
+    size_type capacity() const { return space;}
+
+    /**
+     * @short Make room for at least n rows.
+     */
+    void reserve(size_type __n) {
+        if (__n <= space) return;
+        data.relocate(rows, space, __n);
+        space = __n;
+    }
+
+    /**
+     * @short Append row, omitted fields are value-initialized. Fields
+     * must not refer into this table (columns may be reallocated).
+     */
+    void push_back(const _T0 &__v0, const _T1 &__v1 = _T1(),
+                   const _T2 &__v2 = _T2(), const _T3 &__v3 = _T3(),
+                   const _T4 &__v4 = _T4(), const _T5 &__v5 = _T5(),
+                   const _T6 &__v6 = _T6(), const _T7 &__v7 = _T7())
+    {
+        const void *__values[] = {&__v0, &__v1, &__v2, &__v3,
+                                  &__v4, &__v5, &__v6, &__v7};
+        if (rows == space) reserve(space? 2 * space: 16);
+        data.construct(rows, __values);
+        ++rows;
+    }
+
+    /**
+     * @short Remove last row.
+     */
+    void pop_back() {
+        --rows;
+        data.destroy(rows, rows + 1);
+    }
+
+    /**
+     * @short Remove row at position.
+     */
+    void erase(size_type __i) { erase(__i, __i + 1);}
+
+    /**
+     * @short Remove rows [first, last), following rows are shifted.
+     */
+    void erase(size_type __first, size_type __last) {
+        if (__first == __last) return;
+        data.move(__first, __last, rows);
+        size_type __rows = rows - (__last - __first);
+        data.destroy(__rows, rows);
+        rows = __rows;
+    }
+
+    /**
+     * @short Change count of rows, added fields are value-initialized.
+     */
+    void resize(size_type __n) {
+        if (__n < rows) return erase(__n, rows);
+        reserve(__n);
+        while (rows < __n) push_back(_T0());
+    }
+
+    /**
+     * @short Remove all rows (capacity is kept).
+     */
+    void clear() {
+        data.destroy(0, rows);
+        rows = 0;
+    }
+
+    /**
+     * @short Return sum of column I (integers modulo 2^64 as int64_t or
+     * uint64_t, floating point columns as double).
+     */
+    template <size_type _I>
+    typename ColumnKernels_t::Sum_t<typename column_type<_I>::type>::type
+    sum() const {
+        return ColumnKernels_t::sum(column<_I>(), rows);
+    }
+
+    /**
+     * @short Return sum of column I over rows [first, last).
+     */
+    template <size_type _I>
+    typename ColumnKernels_t::Sum_t<typename column_type<_I>::type>::type
+    sum(size_type __first, size_type __last) const {
+        return ColumnKernels_t::sum(column<_I>() + __first, __last - __first);
+    }
+
+    /**
+     * @short Return the least and the greatest value of column I.
+     * @exception std::out_of_range if there is no row.
+     */
+    template <size_type _I>
+    std::pair<typename column_type<_I>::type, typename column_type<_I>::type>
+    min_max() const {
+        return min_max<_I>(0, rows);
+    }
+
+    /**
+     * @short Return the least and the greatest value of column I over
+     * rows [first, last).
+     * @exception std::out_of_range if range is empty.
+     */
+    template <size_type _I>
+    std::pair<typename column_type<_I>::type, typename column_type<_I>::type>
+    min_max(size_type __first, size_type __last) const {
+        if (__first >= __last)
+            throw std::out_of_range("shcolumns: min/max of empty range");
+        std::pair<typename column_type<_I>::type,
+                  typename column_type<_I>::type> __res;
+        ColumnKernels_t::min_max(column<_I>() + __first, __last - __first,
+                                 __res.first, __res.second);
+        return __res;
+    }
+
+    /**
+     * @short Return the least value of column I.
+     * @exception std::out_of_range if there is no row.
+     */
+    template <size_type _I>
+    typename column_type<_I>::type min() const {
+        return min_max<_I>().first;
+    }
+
+    /**
+     * @short Return the greatest value of column I.
+     * @exception std::out_of_range if there is no row.
+     */
+    template <size_type _I>
+    typename column_type<_I>::type max() const {
+        return min_max<_I>().second;
+    }
+
+    /**
+     * @short Select rows whose field I satisfies (field op value).
+     * @param __op comparison.
+     * @param __value compared value.
+     * @param __mask resized to size(), bit i is set iff row i matches.
+     */
+    template <size_type _I>
+    void filter(ColumnKernels_t::Op_t __op,
+                const typename column_type<_I>::type &__value,
+                shdynamic_bitset &__mask) const
+    {
+        __mask.resize(rows);
+        ColumnKernels_t::filter(__op, column<_I>(), rows, __value,
+                                __mask.data());
+    }
+
+private:
+    Columns_t data;     //< columns.
+    size_type rows;     //< count of rows.
+    size_type space;    //< capacity of columns.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHCOLUMNS_H */
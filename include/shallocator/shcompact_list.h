@@ -0,0 +1,376 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory list with 32-bit offset links.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCOMPACT_LIST_H
+#define SHALLOCATOR_SHCOMPACT_LIST_H
+
+#include <iterator>
+#include <algorithm>
+#include <list>
+#include <shallocator/shalloc.h>
+#include <shallocator/shoffset.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory doubly linked list whose nodes link each other by
+ * 32-bit offsets (see shoffset.h). Node carries 8 bytes of links instead
+ * of 16 bytes of std::list node. Interface is subset of std::list.
+ *
+ * Offset base must be set (set_offset_base()) after MM_create() and before
+ * fork; nodes must lie within 16GB from it.
+ */
+template <typename _Tp>
+class shcompact_list {
+    /**
+     * @short Links of node.
+     */
+    struct Links_t {
+        uint32_t next;  //< offset of next node.
+        uint32_t prev;  //< offset of previous node.
+    };
+
+    /**
+     * @short Node with value.
+     */
+    struct Node_t: public Links_t {
+        explicit Node_t(const _Tp &__value): value(__value) {}
+        _Tp value;      //< stored value.
+    };
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Bidirectional iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): node(0), list(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : node(__other.node), list(__other.list) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            node = __other.node;
+            list = __other.list;
+            return *this;
+        }
+
+        reference operator*() const { return node->value;}
+
+        pointer operator->() const { return &node->value;}
+
+        Iterator_t &operator++() {
+            node = from_offset<Node_t>(node->next);
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator--() {
+            node = node? from_offset<Node_t>(node->prev): list->tail;
+            return *this;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return node == __other.node;
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return node != __other.node;
+        }
+
+    private:
+        Iterator_t(Node_t *__node, const shcompact_list *__list)
+            : node(__node), list(__list) {}
+
+        friend class shcompact_list;
+        template <typename> friend class Iterator_t;
+
+        Node_t *node;                   //< current node, 0 for end().
+        const shcompact_list *list;     //< owning list (for --end()).
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shcompact_list(): head(0), tail(0), elements(0) {}
+
+    /**
+     * @short Create list with n copies of value.
+     * @param __n count of elements.
+     * @param __value value.
+     */
+    explicit
+    shcompact_list(size_type __n, const _Tp &__value = _Tp())
+        : head(0), tail(0), elements(0)
+    {
+        try {
+            while (__n--) push_back(__value);
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @short Construct %shcompact_list from std list.
+     * @param __other other list.
+     */
+    template <typename _otherTp, typename _otherAllocT>
+    shcompact_list(const std::list<_otherTp, _otherAllocT> &__other)
+        : head(0), tail(0), elements(0)
+    {
+        assign(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Builds a %shcompact_list from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shcompact_list(_InputIterator __first, _InputIterator __last)
+        : head(0), tail(0), elements(0)
+    {
+        assign(__first, __last);
+    }
+
+    /**
+     * @short Copy constructor.
+     * @param __other source list.
+     */
+    shcompact_list(const shcompact_list &__other)
+        : head(0), tail(0), elements(0)
+    {
+        assign(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Destructor frees all nodes.
+     */
+    ~shcompact_list() { clear();}
+
+    /**
+     * @short Assignment operator.
+     * @param __other source list.
+     */
+    shcompact_list &operator=(const shcompact_list &__other) {
+        if (this != &__other) {
+            shcompact_list __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Replace content by range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    void assign(_InputIterator __first, _InputIterator __last) {
+        clear();
+        try {
+            for (; __first != __last; ++__first)
+                push_back(*__first);
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+
+    /**
+     * @short Swap content with other list.
+     * @param __other other list.
+     */
+    void swap(shcompact_list &__other) {
+        std::swap(head, __other.head);
+        std::swap(tail, __other.tail);
+        std::swap(elements, __other.elements);
+    }
+
+    iterator begin() { return iterator(head, this);}
+    const_iterator begin() const { return const_iterator(head, this);}
+    iterator end() { return iterator(0, this);}
+    const_iterator end() const { return const_iterator(0, this);}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    reference front() { return head->value;}
+    const_reference front() const { return head->value;}
+    reference back() { return tail->value;}
+    const_reference back() const { return tail->value;}
+
+    void push_front(const _Tp &__value) { insert(begin(), __value);}
+    void push_back(const _Tp &__value) { insert(end(), __value);}
+    void pop_front() { erase(begin());}
+    void pop_back() { erase(iterator(tail, this));}
+
+    /**
+     * @short Insert value before position.
+     * @param __pos position.
+     * @param __value value.
+     * @return iterator to new element.
+     */
+    iterator insert(const_iterator __pos, const _Tp &__value) {
+        void *__ptr = offset_allocate(sizeof(Node_t));
+        Node_t *__node;
+        try {
+            __node = new (__ptr) Node_t(__value);
+        } catch (...) {
+            shfree(__ptr);
+            throw;
+        }
+
+        Node_t *__next = __pos.node;
+        Node_t *__prev = __next? from_offset<Node_t>(__next->prev): tail;
+        __node->next = to_offset(__next);
+        __node->prev = to_offset(__prev);
+        if (__prev) __prev->next = to_offset(__node);
+        else head = __node;
+        if (__next) __next->prev = to_offset(__node);
+        else tail = __node;
+        ++elements;
+        return iterator(__node, this);
+    }
+
+    /**
+     * @short Erase element at position.
+     * @param __pos valid dereferenceable iterator.
+     * @return iterator to next element.
+     */
+    iterator erase(const_iterator __pos) {
+        Node_t *__node = __pos.node;
+        Node_t *__next = from_offset<Node_t>(__node->next);
+        Node_t *__prev = from_offset<Node_t>(__node->prev);
+        if (__prev) __prev->next = __node->next;
+        else head = __next;
+        if (__next) __next->prev = __node->prev;
+        else tail = __prev;
+        __node->~Node_t();
+        shfree(__node);
+        --elements;
+        return iterator(__next, this);
+    }
+
+    /**
+     * @short Erase all elements.
+     */
+    void clear() {
+        while (head) {
+            Node_t *__next = from_offset<Node_t>(head->next);
+            head->~Node_t();
+            shfree(head);
+            head = __next;
+        }
+        tail = 0;
+        elements = 0;
+    }
+
+    /**
+     * @short Erase all elements equal to value.
+     * @param __value value.
+     */
+    void remove(const _Tp &__value) {
+        for (iterator __it = begin(); __it != end();)
+            if (*__it == __value) __it = erase(__it);
+            else ++__it;
+    }
+
+    /**
+     * @short Reverse order of elements.
+     */
+    void reverse() {
+        for (Node_t *__node = head; __node;) {
+            Node_t *__next = from_offset<Node_t>(__node->next);
+            std::swap(__node->next, __node->prev);
+            __node = __next;
+        }
+        std::swap(head, tail);
+    }
+
+private:
+    Node_t *head;           //< first node.
+    Node_t *tail;           //< last node.
+    size_type elements;     //< count of elements.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHCOMPACT_LIST_H */
+
@@ -0,0 +1,123 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory map with 32-bit offset links.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCOMPACT_MAP_H
+#define SHALLOCATOR_SHCOMPACT_MAP_H
+
+#include <map>
+#include <stdexcept>
+#include <shallocator/shcompact_tree.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory map whose nodes link each other by 32-bit offsets
+ * (see shoffset.h). Node carries 12 bytes of links instead of 32 bytes of
+ * std::map node. Interface is subset of std::map.
+ *
+ * Offset base must be set (set_offset_base()) after MM_create() and before
+ * fork; nodes must lie within 16GB from it.
+ */
+template <typename _Key, typename _Tp, typename _Compare = std::less<_Key> >
+class shcompact_map
+    : public CompactTree_t<_Key, std::pair<const _Key, _Tp>,
+                           CompactSelect1st_t<std::pair<const _Key, _Tp> >,
+                           _Compare, true>
+{
+public:
+    /// parent typedef
+    typedef CompactTree_t<_Key, std::pair<const _Key, _Tp>,
+                          CompactSelect1st_t<std::pair<const _Key, _Tp> >,
+                          _Compare, true> __parent;
+    /// mapped type
+    typedef _Tp mapped_type;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    explicit
+    shcompact_map(const _Compare &__comp = _Compare()): __parent(__comp) {}
+
+    /**
+     * @short Construct %shcompact_map from std map.
+     * @param __other other map.
+     */
+    template <typename _otherKey, typename _otherTp,
+              typename _otherCompare, typename _otherAllocT>
+    shcompact_map(const std::map<_otherKey, _otherTp, _otherCompare,
+                                 _otherAllocT> &__other)
+    {
+        this->insert(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Builds a %shcompact_map from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shcompact_map(_InputIterator __first, _InputIterator __last,
+                  const _Compare &__comp = _Compare())
+        : __parent(__comp)
+    {
+        this->insert(__first, __last);
+    }
+
+    /**
+     * @short Return value of key, insert default value if it is missing.
+     * @param __key key.
+     * @return reference to value.
+     */
+    _Tp &operator[](const _Key &__key) {
+        typename __parent::iterator __it = this->lower_bound(__key);
+        if ((__it == this->end()) || this->comp(__key, __it->first))
+            __it = this->insert(std::make_pair(__key, _Tp())).first;
+        return __it->second;
+    }
+
+    /**
+     * @short Return value of key.
+     * @param __key key.
+     * @return reference to value (throws out_of_range if key is missing).
+     */
+    _Tp &at(const _Key &__key) {
+        typename __parent::iterator __it = this->find(__key);
+        if (__it == this->end())
+            throw std::out_of_range("shcompact_map::at");
+        return __it->second;
+    }
+
+    /**
+     * @short Return value of key.
+     * @param __key key.
+     * @return reference to value (throws out_of_range if key is missing).
+     */
+    const _Tp &at(const _Key &__key) const {
+        typename __parent::const_iterator __it = this->find(__key);
+        if (__it == this->end())
+            throw std::out_of_range("shcompact_map::at");
+        return __it->second;
+    }
+};
+
+}
+
+#endif /* SHALLOCATOR_SHCOMPACT_MAP_H */
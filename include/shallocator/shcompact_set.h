@@ -0,0 +1,82 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory set with 32-bit offset links.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCOMPACT_SET_H
+#define SHALLOCATOR_SHCOMPACT_SET_H
+
+#include <set>
+#include <shallocator/shcompact_tree.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory set whose nodes link each other by 32-bit offsets
+ * (see shoffset.h). Node carries 12 bytes of links instead of 32 bytes of
+ * std::set node. Interface is subset of std::set.
+ *
+ * Offset base must be set (set_offset_base()) after MM_create() and before
+ * fork; nodes must lie within 16GB from it.
+ */
+template <typename _Key, typename _Compare = std::less<_Key> >
+class shcompact_set
+    : public CompactTree_t<_Key, _Key, CompactIdentity_t<_Key>,
+                           _Compare, false>
+{
+public:
+    /// parent typedef
+    typedef CompactTree_t<_Key, _Key, CompactIdentity_t<_Key>,
+                          _Compare, false> __parent;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    explicit
+    shcompact_set(const _Compare &__comp = _Compare()): __parent(__comp) {}
+
+    /**
+     * @short Construct %shcompact_set from std set.
+     * @param __other other set.
+     */
+    template <typename _otherKey, typename _otherCompare,
+              typename _otherAllocT>
+    shcompact_set(const std::set<_otherKey, _otherCompare,
+                                 _otherAllocT> &__other)
+    {
+        this->insert(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Builds a %shcompact_set from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shcompact_set(_InputIterator __first, _InputIterator __last,
+                  const _Compare &__comp = _Compare())
+        : __parent(__comp)
+    {
+        this->insert(__first, __last);
+    }
+};
+
+}
+
+#endif /* SHALLOCATOR_SHCOMPACT_SET_H */
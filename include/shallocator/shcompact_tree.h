@@ -0,0 +1,539 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Red-black tree with 32-bit offset links.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHCOMPACT_TREE_H
+#define SHALLOCATOR_SHCOMPACT_TREE_H
+
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <shallocator/shalloc.h>
+#include <shallocator/shoffset.h>
+#include <shallocator/shrbtree_algo.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Links of compact tree node, 12 bytes instead of 32 bytes of
+ * std::map node. Color is the highest bit of parent offset.
+ */
+struct CompactTreeLinks_t {
+    uint32_t left;      //< offset of left child.
+    uint32_t right;     //< offset of right child.
+    uint32_t parent;    //< offset of parent | RED.
+};
+
+/**
+ * @short Node traits for RBTreeAlgo_t.
+ */
+struct CompactTreeTraits_t {
+    /// node pointer
+    typedef CompactTreeLinks_t *node_ptr;
+
+    /// color bit in parent offset
+    static const uint32_t RED = 0x80000000;
+
+    static node_ptr left(node_ptr __x) {
+        return from_offset<CompactTreeLinks_t>(__x->left);
+    }
+
+    static node_ptr right(node_ptr __x) {
+        return from_offset<CompactTreeLinks_t>(__x->right);
+    }
+
+    static node_ptr parent(node_ptr __x) {
+        return from_offset<CompactTreeLinks_t>(__x->parent & ~RED);
+    }
+
+    static void set_left(node_ptr __x, node_ptr __l) {
+        __x->left = to_offset(__l);
+    }
+
+    static void set_right(node_ptr __x, node_ptr __r) {
+        __x->right = to_offset(__r);
+    }
+
+    static void set_parent(node_ptr __x, node_ptr __p) {
+        __x->parent = (__x->parent & RED) | to_offset(__p);
+    }
+
+    static bool is_red(node_ptr __x) { return __x->parent & RED;}
+
+    static void set_red(node_ptr __x, bool __red) {
+        __x->parent = (__x->parent & ~RED) | (__red? RED: 0);
+    }
+};
+
+/**
+ * @short Key of value for sets.
+ */
+template <typename _Tp>
+struct CompactIdentity_t {
+    const _Tp &operator()(const _Tp &__value) const { return __value;}
+};
+
+/**
+ * @short Key of value for maps.
+ */
+template <typename _Pair>
+struct CompactSelect1st_t {
+    const typename _Pair::first_type &operator()(const _Pair &__value) const {
+        return __value.first;
+    }
+};
+
+/**
+ * @short Unique key red-black tree whose nodes link each other by 32-bit
+ * offsets from SHOffsetBase (see shoffset.h). Base of shcompact_map and
+ * shcompact_set.
+ *
+ * Tree object itself keeps raw pointers (root and bounds), so it can live
+ * in shared memory or on stack; nodes are allocated by offset_allocate().
+ * Iterators hold node and tree pointer (for --end()).
+ */
+template <typename _Key, typename _Value, typename _KeyOfValue,
+          typename _Compare, bool _Mutable>
+class CompactTree_t {
+protected:
+    /// links
+    typedef CompactTreeLinks_t Links_t;
+    /// algorithms
+    typedef RBTreeAlgo_t<CompactTreeTraits_t> Algo_t;
+
+    /**
+     * @short Node with value.
+     */
+    struct Node_t: public Links_t {
+        explicit Node_t(const _Value &__value): value(__value) {}
+        _Value value;   //< stored value.
+    };
+
+    /**
+     * @short Select const type for immutable iterators.
+     */
+    template <bool, typename _Tp> struct Const_t { typedef const _Tp type;};
+    template <typename _Tp> struct Const_t<true, _Tp> { typedef _Tp type;};
+
+public:
+    /// key type
+    typedef _Key key_type;
+    /// value type
+    typedef _Value value_type;
+    /// size type
+    typedef std::size_t size_type;
+    /// key comparator
+    typedef _Compare key_compare;
+
+    /**
+     * @short Bidirectional iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef _Value value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): node(0), tree(0) {}
+
+        /**
+         * @short Conversion from mutable iterator (const iterator doesn't
+         * convert to mutable one).
+         */
+        Iterator_t(const Iterator_t<typename Const_t<_Mutable, _Value>::type>
+                   &__other)
+            : node(__other.node), tree(__other.tree) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            node = __other.node;
+            tree = __other.tree;
+            return *this;
+        }
+
+        reference operator*() const {
+            return static_cast<Node_t *>(node)->value;
+        }
+
+        pointer operator->() const { return &**this;}
+
+        Iterator_t &operator++() {
+            node = Algo_t::next(node);
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator--() {
+            node = node? Algo_t::prev(node): tree->rightmost;
+            return *this;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        template <typename _Other>
+        bool operator==(const Iterator_t<_Other> &__other) const {
+            return node == __other.node;
+        }
+
+        template <typename _Other>
+        bool operator!=(const Iterator_t<_Other> &__other) const {
+            return node != __other.node;
+        }
+
+    private:
+        Iterator_t(Links_t *__node, const CompactTree_t *__tree)
+            : node(__node), tree(__tree) {}
+
+        friend class CompactTree_t;
+        template <typename> friend class Iterator_t;
+
+        Links_t *node;              //< current node, 0 for end().
+        const CompactTree_t *tree;  //< owning tree (for --end()).
+    };
+
+    /// iterator
+    typedef Iterator_t<typename Const_t<_Mutable, _Value>::type> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Value> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp A comparison functor.
+     */
+    explicit
+    CompactTree_t(const _Compare &__comp = _Compare())
+        : root(0), leftmost(0), rightmost(0), elements(0), comp(__comp) {}
+
+    /**
+     * @short Copy constructor, copies tree structure.
+     * @param __other source tree.
+     */
+    CompactTree_t(const CompactTree_t &__other)
+        : root(0), leftmost(0), rightmost(0), elements(0), comp(__other.comp)
+    {
+        if (!__other.root) return;
+        root = clone(__other.root, 0);
+        leftmost = Algo_t::minimum(root);
+        rightmost = Algo_t::maximum(root);
+        elements = __other.elements;
+    }
+
+    /**
+     * @short Destructor frees all nodes.
+     */
+    ~CompactTree_t() { clear();}
+
+    /**
+     * @short Assignment operator.
+     * @param __other source tree.
+     */
+    CompactTree_t &operator=(const CompactTree_t &__other) {
+        if (this != &__other) {
+            CompactTree_t __tmp(__other);
+            swap(__tmp);
+        }
+        return *this;
+    }
+
+    /**
+     * @short Swap content with other tree.
+     * @param __other other tree.
+     */
+    void swap(CompactTree_t &__other) {
+        std::swap(root, __other.root);
+        std::swap(leftmost, __other.leftmost);
+        std::swap(rightmost, __other.rightmost);
+        std::swap(elements, __other.elements);
+        std::swap(comp, __other.comp);
+    }
+
+    iterator begin() { return iterator(leftmost, this);}
+    const_iterator begin() const { return const_iterator(leftmost, this);}
+    iterator end() { return iterator(0, this);}
+    const_iterator end() const { return const_iterator(0, this);}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    /**
+     * @short Return key comparator.
+     */
+    key_compare key_comp() const { return comp;}
+
+    /**
+     * @short Find element with key.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    iterator find(const _Key &__key) {
+        Links_t *__x = bound(__key, false);
+        return iterator((__x && !comp(__key, key(__x)))? __x: 0, this);
+    }
+
+    /**
+     * @short Find element with key.
+     * @param __key key.
+     * @return iterator to element or end().
+     */
+    const_iterator find(const _Key &__key) const {
+        Links_t *__x = bound(__key, false);
+        return const_iterator((__x && !comp(__key, key(__x)))? __x: 0, this);
+    }
+
+    /**
+     * @short Return 1 if key is present 0 otherwise.
+     */
+    size_type count(const _Key &__key) const {
+        return find(__key) != end();
+    }
+
+    iterator lower_bound(const _Key &__key) {
+        return iterator(bound(__key, false), this);
+    }
+
+    const_iterator lower_bound(const _Key &__key) const {
+        return const_iterator(bound(__key, false), this);
+    }
+
+    iterator upper_bound(const _Key &__key) {
+        return iterator(bound(__key, true), this);
+    }
+
+    const_iterator upper_bound(const _Key &__key) const {
+        return const_iterator(bound(__key, true), this);
+    }
+
+    std::pair<iterator, iterator> equal_range(const _Key &__key) {
+        return std::make_pair(lower_bound(__key), upper_bound(__key));
+    }
+
+    std::pair<const_iterator, const_iterator>
+    equal_range(const _Key &__key) const {
+        return std::make_pair(lower_bound(__key), upper_bound(__key));
+    }
+
+    /**
+     * @short Insert value if its key is not present.
+     * @param __value value.
+     * @return iterator to element with key and true if it was inserted.
+     */
+    std::pair<iterator, bool> insert(const _Value &__value) {
+        const _Key &__key = _KeyOfValue()(__value);
+        Links_t *__y = 0;
+        Links_t *__x = root;
+        bool __less = true;
+        while (__x) {
+            __y = __x;
+            __less = comp(__key, key(__x));
+            __x = __less? CompactTreeTraits_t::left(__x)
+                        : CompactTreeTraits_t::right(__x);
+        }
+
+        // previous node must be less than key
+        Links_t *__j = __y;
+        if (__less) {
+            if (__y == leftmost)
+                return std::make_pair(insert_node(__y, true, __value), true);
+            __j = Algo_t::prev(__y);
+        }
+        if (comp(key(__j), __key))
+            return std::make_pair(insert_node(__y, __less, __value), true);
+        return std::make_pair(iterator(__j, this), false);
+    }
+
+    /**
+     * @short Insert values from range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    void insert(_InputIterator __first, _InputIterator __last) {
+        for (; __first != __last; ++__first)
+            insert(*__first);
+    }
+
+    /**
+     * @short Erase element at iterator.
+     * @param __it valid dereferenceable iterator.
+     */
+    void erase(const_iterator __it) {
+        Links_t *__z = __it.node;
+        if (__z == leftmost) leftmost = Algo_t::next(__z);
+        if (__z == rightmost) rightmost = Algo_t::prev(__z);
+        Algo_t::erase(__z, root);
+        delete_node(__z);
+        --elements;
+    }
+
+    /**
+     * @short Erase element with key.
+     * @param __key key.
+     * @return count of erased elements.
+     */
+    size_type erase(const _Key &__key) {
+        const_iterator __it = find(__key);
+        if (__it == end()) return 0;
+        erase(__it);
+        return 1;
+    }
+
+    /**
+     * @short Erase all elements.
+     */
+    void clear() {
+        if (root) delete_tree(root);
+        root = leftmost = rightmost = 0;
+        elements = 0;
+    }
+
+protected:
+    /**
+     * @short Return key of node.
+     */
+    static const _Key &key(const Links_t *__x) {
+        return _KeyOfValue()(static_cast<const Node_t *>(__x)->value);
+    }
+
+    /**
+     * @short Return first node not less (upper: greater) than key.
+     */
+    Links_t *bound(const _Key &__key, bool __upper) const {
+        Links_t *__y = 0;
+        Links_t *__x = root;
+        while (__x) {
+            if (__upper? comp(__key, key(__x)): !comp(key(__x), __key)) {
+                __y = __x;
+                __x = CompactTreeTraits_t::left(__x);
+            } else __x = CompactTreeTraits_t::right(__x);
+        }
+        return __y;
+    }
+
+    /**
+     * @short Allocate node and link it to the tree.
+     */
+    iterator insert_node(Links_t *__parent, bool __left, const _Value &__value) {
+        Node_t *__z = new_node(__value);
+        Algo_t::insert(__z, __parent, __left, root);
+        if (!__parent) leftmost = rightmost = __z;
+        else if (__left && (__parent == leftmost)) leftmost = __z;
+        else if (!__left && (__parent == rightmost)) rightmost = __z;
+        ++elements;
+        return iterator(__z, this);
+    }
+
+    /**
+     * @short Copy subtree.
+     */
+    static Links_t *clone(const Links_t *__x, Links_t *__parent) {
+        Node_t *__z = new_node(static_cast<const Node_t *>(__x)->value);
+        __z->parent = (__x->parent & CompactTreeTraits_t::RED)
+                    | to_offset(__parent);
+        __z->left = __z->right = 0;
+        try {
+            Links_t *__l = CompactTreeTraits_t::left(const_cast<Links_t *>(__x));
+            Links_t *__r = CompactTreeTraits_t::right(const_cast<Links_t *>(__x));
+            if (__l) __z->left = to_offset(clone(__l, __z));
+            if (__r) __z->right = to_offset(clone(__r, __z));
+        } catch (...) {
+            delete_tree(__z);
+            throw;
+        }
+        return __z;
+    }
+
+    /**
+     * @short Allocate and construct node.
+     */
+    static Node_t *new_node(const _Value &__value) {
+        void *__ptr = offset_allocate(sizeof(Node_t));
+        try {
+            return new (__ptr) Node_t(__value);
+        } catch (...) {
+            shfree(__ptr);
+            throw;
+        }
+    }
+
+    /**
+     * @short Destroy and deallocate node.
+     */
+    static void delete_node(Links_t *__x) {
+        static_cast<Node_t *>(__x)->~Node_t();
+        shfree(__x);
+    }
+
+    /**
+     * @short Release whole subtree.
+     */
+    static void delete_tree(Links_t *__x) {
+        while (__x) {
+            if (Links_t *__r = CompactTreeTraits_t::right(__x))
+                delete_tree(__r);
+            Links_t *__l = CompactTreeTraits_t::left(__x);
+            delete_node(__x);
+            __x = __l;
+        }
+    }
+
+    Links_t *root;          //< root node.
+    Links_t *leftmost;      //< first node.
+    Links_t *rightmost;     //< last node.
+    size_type elements;     //< count of elements.
+    _Compare comp;          //< key comparator.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHCOMPACT_TREE_H */
+
@@ -0,0 +1,129 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Hash functions for shared memory containers.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHHASH_H
+#define SHALLOCATOR_SHHASH_H
+
+#include <string>
+#include <cstring>
+#include <functional>
+#include <stdint.h>
+#include <shallocator/shstring.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Mix bits of integer value (murmur3 finalizer).
+ * @param __h value.
+ * @return well distributed hash.
+ */
+inline uint64_t hash_mix(uint64_t __h) {
+    __h ^= __h >> 33;
+    __h *= 0xff51afd7ed558ccdULL;
+    __h ^= __h >> 33;
+    __h *= 0xc4ceb9fe1a85ec53ULL;
+    __h ^= __h >> 33;
+    return __h;
+}
+
+/**
+ * @short Hash memory block (FNV-1a).
+ * @param __data pointer to data.
+ * @param __size size of data in bytes.
+ * @return hash of data.
+ */
+inline uint64_t hash_bytes(const void *__data, std::size_t __size) {
+    const unsigned char *__p = static_cast<const unsigned char *>(__data);
+    uint64_t __h = 0xcbf29ce484222325ULL;
+    for (std::size_t __i = 0; __i < __size; ++__i) {
+        __h ^= __p[__i];
+        __h *= 0x100000001b3ULL;
+    }
+    return hash_mix(__h);
+}
+
+/**
+ * @short Hash functor used by shared memory hashed containers.
+ *
+ * std::hash is identity for integers, that is not enough for choosing shard
+ * or bucket by low bits, so result is always mixed. Without C++11 there is
+ * no std::hash and keys have to be convertible to integer (integers, enums);
+ * specialize shhash for other keys.
+ */
+template <typename _Key>
+struct shhash {
+    std::size_t operator()(const _Key &__key) const {
+#if __cplusplus >= 201103L
+        return static_cast<std::size_t>(
+                hash_mix(static_cast<uint64_t>(std::hash<_Key>()(__key))));
+#else
+        return static_cast<std::size_t>(
+                hash_mix(static_cast<uint64_t>(__key)));
+#endif
+    }
+};
+
+/**
+ * @short Hash functor for pointers (hashes address).
+ */
+template <typename _Tp>
+struct shhash<_Tp *> {
+    std::size_t operator()(_Tp *__key) const {
+        return static_cast<std::size_t>(
+                hash_mix(reinterpret_cast<uintptr_t>(__key)));
+    }
+};
+
+/**
+ * @short Hash functor for strings, works with any allocator (shstring too).
+ */
+template <typename _CharT, typename _Traits, typename _Alloc>
+struct shhash<std::basic_string<_CharT, _Traits, _Alloc> > {
+    std::size_t operator()(const std::basic_string<_CharT, _Traits, _Alloc>
+                           &__key) const
+    {
+        return static_cast<std::size_t>(
+                hash_bytes(__key.data(), __key.size() * sizeof(_CharT)));
+    }
+};
+
+/**
+ * @short Hash functor for shared memory strings.
+ */
+template <typename _CharT, typename _Traits>
+struct shhash<shbasic_string<_CharT, _Traits> > {
+    std::size_t operator()(const shbasic_string<_CharT, _Traits> &__key) const {
+        return static_cast<std::size_t>(
+                hash_bytes(__key.data(), __key.size() * sizeof(_CharT)));
+    }
+};
+
+/**
+ * @short Hash functor for C strings.
+ */
+template <>
+struct shhash<const char *> {
+    std::size_t operator()(const char *__key) const {
+        return static_cast<std::size_t>(hash_bytes(__key, std::strlen(__key)));
+    }
+};
+
+}
+
+#endif /* SHALLOCATOR_SHHASH_H */
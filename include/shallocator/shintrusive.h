@@ -0,0 +1,114 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Hooks of intrusive shared memory containers.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHINTRUSIVE_H
+#define SHALLOCATOR_SHINTRUSIVE_H
+
+#include <cstddef>
+
+namespace SHAllocator {
+
+/**
+ * @short Return pointer stored in field as distance from the field itself.
+ *
+ * Self-relative links don't depend on the address the segment is mapped
+ * at, so they stay valid in every process as long as both ends live in
+ * the same segment. Zero is null pointer (no link points to itself).
+ */
+inline void *self_get(const std::ptrdiff_t &__field) {
+    return __field? const_cast<char *>(reinterpret_cast<const char *>(&__field))
+                    + __field
+                  : 0;
+}
+
+/**
+ * @short Store pointer to field as distance from the field itself.
+ */
+inline void self_set(std::ptrdiff_t &__field, const void *__ptr) {
+    __field = __ptr? static_cast<const char *>(__ptr)
+                     - reinterpret_cast<char *>(&__field)
+                   : 0;
+}
+
+/**
+ * @short Hook of shintrusive_list, embed it in your object.
+ *
+ * Copy of object gets unlinked hook, so objects stay copyable.
+ */
+struct ListHook_t {
+    ListHook_t(): next(0), prev(0) {}
+    ListHook_t(const ListHook_t &): next(0), prev(0) {}
+    ListHook_t &operator=(const ListHook_t &) { return *this;}
+
+    std::ptrdiff_t next;    //< next hook.
+    std::ptrdiff_t prev;    //< previous hook.
+};
+
+/**
+ * @short Hook of shintrusive_set, embed it in your object. Color is the
+ * lowest bit of parent link (hooks are aligned).
+ */
+struct TreeHook_t {
+    TreeHook_t(): left(0), right(0), parent(0) {}
+    TreeHook_t(const TreeHook_t &): left(0), right(0), parent(0) {}
+    TreeHook_t &operator=(const TreeHook_t &) { return *this;}
+
+    std::ptrdiff_t left;    //< left child.
+    std::ptrdiff_t right;   //< right child.
+    std::ptrdiff_t parent;  //< parent | red.
+};
+
+/**
+ * @short Hook of shintrusive_hash, embed it in your object. Hash value is
+ * cached, so rehash and lookups don't call hash functor or comparator
+ * needlessly.
+ */
+struct HashHook_t {
+    HashHook_t(): next(0), hash(0) {}
+    HashHook_t(const HashHook_t &): next(0), hash(0) {}
+    HashHook_t &operator=(const HashHook_t &) { return *this;}
+
+    std::ptrdiff_t next;    //< next hook in bucket.
+    std::size_t hash;       //< hash of object.
+};
+
+/**
+ * @short Conversion between object and its member hook.
+ */
+template <typename _Tp, typename _Hook, _Hook _Tp::*_Member>
+struct MemberHook_t {
+    static _Hook *to_hook(_Tp &__value) { return &(__value.*_Member);}
+
+    static _Tp *to_value(_Hook *__hook) {
+        return reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__hook)
+                                       - offset());
+    }
+
+    static std::ptrdiff_t offset() {
+        // distance of member in any object, nothing is dereferenced
+        _Tp *__probe = reinterpret_cast<_Tp *>(0x1000);
+        return reinterpret_cast<char *>(&(__probe->*_Member))
+             - reinterpret_cast<char *>(__probe);
+    }
+};
+
+}
+
+#endif /* SHALLOCATOR_SHINTRUSIVE_H */
+
@@ -0,0 +1,389 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Intrusive shared memory hash table.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHINTRUSIVE_HASH_H
+#define SHALLOCATOR_SHINTRUSIVE_HASH_H
+
+#include <iterator>
+#include <functional>
+#include <utility>
+#include <shallocator/shalloc.h>
+#include <shallocator/shhash.h>
+#include <shallocator/shintrusive.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Hash table of objects that carry the chain links themselves
+ * (HashHook_t member given by _Hook). Only the bucket array is allocated
+ * (by Allocator_t); table doesn't own its objects: they must outlive
+ * their membership and are released by clear_and_dispose() or by the
+ * caller. Objects equal by _Equal are rejected by insert().
+ *
+ * Bucket count is power of two and doubles when count of objects exceeds
+ * it, so _Hash must mix all bits (shhash does). All links are
+ * self-relative (see self_get()), so table, buckets and objects can be
+ * mapped at different addresses in different processes as long as they
+ * share the segment. Table itself can't be copied.
+ */
+template <typename _Tp, HashHook_t _Tp::*_Hook,
+          typename _Hash = shhash<_Tp>,
+          typename _Equal = std::equal_to<_Tp> >
+class shintrusive_hash {
+    typedef MemberHook_t<_Tp, HashHook_t, _Hook> Member_t;
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// hasher
+    typedef _Hash hasher;
+    /// key equality
+    typedef _Equal key_equal;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Forward iterator (bucket order).
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::forward_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): hook(0), table(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : hook(__other.hook), table(__other.table) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            hook = __other.hook;
+            table = __other.table;
+            return *this;
+        }
+
+        reference operator*() const { return *Member_t::to_value(hook);}
+
+        pointer operator->() const { return Member_t::to_value(hook);}
+
+        Iterator_t &operator++() {
+            HashHook_t *__next = static_cast<HashHook_t *>(
+                    self_get(hook->next));
+            hook = __next? __next: table->first_from(table->index(hook->hash)
+                                                     + 1);
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return hook == __other.hook;
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return hook != __other.hook;
+        }
+
+    private:
+        Iterator_t(HashHook_t *__hook, const shintrusive_hash *__table)
+            : hook(__hook), table(__table) {}
+
+        friend class shintrusive_hash;
+        template <typename> friend class Iterator_t;
+
+        HashHook_t *hook;               //< current hook, 0 for end().
+        const shintrusive_hash *table;  //< owning table.
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+
+    /**
+     * @short Create empty table.
+     * @param __buckets initial count of buckets (rounded up to power of 2).
+     * @param __hash A hash functor.
+     * @param __equal An equality functor.
+     */
+    explicit shintrusive_hash(size_type __buckets = 16,
+                              const _Hash &__hash = _Hash(),
+                              const _Equal &__equal = _Equal())
+        : table(0), buckets(0), elements(0), hash(__hash), equal(__equal)
+    {
+        rehash(__buckets);
+    }
+
+    /**
+     * @short Unlink all objects (they are not destroyed) and free buckets.
+     */
+    ~shintrusive_hash() {
+        clear();
+        Allocator_t<std::ptrdiff_t>().deallocate(bucket(0), buckets);
+    }
+
+    iterator begin() { return iterator(first_from(0), this);}
+    const_iterator begin() const { return const_iterator(first_from(0), this);}
+    iterator end() { return iterator(0, this);}
+    const_iterator end() const { return const_iterator(0, this);}
+
+    /**
+     * @short Return count of objects.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no object.
+     */
+    bool empty() const { return !elements;}
+
+    /**
+     * @short Return count of buckets.
+     */
+    size_type bucket_count() const { return buckets;}
+
+    /**
+     * @short Return iterator to object linked in this table.
+     * @param __value object.
+     */
+    iterator iterator_to(_Tp &__value) {
+        return iterator(Member_t::to_hook(__value), this);
+    }
+
+    /**
+     * @short Link object unless equal one is already linked. May grow
+     * bucket array (and throw std::bad_alloc before linking).
+     * @param __value object not linked in this table.
+     * @return iterator to linked object and true if __value was linked.
+     */
+    std::pair<iterator, bool> insert(_Tp &__value) {
+        std::size_t __hash = hash(__value);
+        iterator __it = find(__value, __hash, equal);
+        if (__it != end()) return std::make_pair(__it, false);
+        if (elements >= buckets) rehash(buckets * 2);
+
+        HashHook_t *__hook = Member_t::to_hook(__value);
+        __hook->hash = __hash;
+        link(__hook);
+        ++elements;
+        return std::make_pair(iterator(__hook, this), true);
+    }
+
+    /**
+     * @short Find object equal to key.
+     * @param __key key.
+     * @return iterator to found object or end().
+     */
+    iterator find(const _Tp &__key) const {
+        return find(__key, hash(__key), equal);
+    }
+
+    /**
+     * @short Find object by key of other type.
+     * @param __key key.
+     * @param __hash hash of key, same as _Hash gives for equal object.
+     * @param __equal comparator accepting (key, object).
+     * @return iterator to found object or end().
+     */
+    template <typename _Key, typename _KeyEqual>
+    iterator find(const _Key &__key, std::size_t __hash,
+                  _KeyEqual __equal) const
+    {
+        HashHook_t *__hook = static_cast<HashHook_t *>(
+                self_get(*bucket(index(__hash))));
+        for (; __hook; __hook = static_cast<HashHook_t *>(
+                    self_get(__hook->next)))
+            if ((__hook->hash == __hash)
+                && __equal(__key, *Member_t::to_value(__hook)))
+                return iterator(__hook, this);
+        return iterator(0, this);
+    }
+
+    /**
+     * @short Return count of objects equal to key (0 or 1).
+     */
+    size_type count(const _Tp &__key) const { return find(__key).hook != 0;}
+
+    /**
+     * @short Unlink object at position.
+     * @param __pos valid dereferenceable iterator.
+     * @return iterator to next object.
+     */
+    iterator erase(const_iterator __pos) {
+        iterator __next(__pos.hook, this);
+        ++__next;
+        unlink(__pos.hook);
+        --elements;
+        return __next;
+    }
+
+    /**
+     * @short Unlink object linked in this table.
+     * @param __value object.
+     */
+    void erase(_Tp &__value) { erase(iterator_to(__value));}
+
+    /**
+     * @short Unlink object equal to key.
+     * @param __key key.
+     * @return count of unlinked objects.
+     */
+    size_type erase_key(const _Tp &__key) {
+        iterator __it = find(__key);
+        if (__it == end()) return 0;
+        erase(__it);
+        return 1;
+    }
+
+    /**
+     * @short Relink objects to new bucket array.
+     * @param __count requested count of buckets (rounded up to power of 2,
+     * not below count of objects).
+     */
+    void rehash(size_type __count) {
+        size_type __buckets = 1;
+        while ((__buckets < __count) || (__buckets < elements))
+            __buckets <<= 1;
+        if (__buckets == buckets) return;
+
+        std::ptrdiff_t *__table = Allocator_t<std::ptrdiff_t>()
+            .allocate(__buckets);
+        for (size_type __i = 0; __i < __buckets; ++__i) __table[__i] = 0;
+
+        // relink chains from old array
+        std::ptrdiff_t *__old = bucket(0);
+        size_type __old_buckets = buckets;
+        self_set(table, __table);
+        buckets = __buckets;
+        for (size_type __i = 0; __i < __old_buckets; ++__i) {
+            HashHook_t *__hook = static_cast<HashHook_t *>(
+                    self_get(__old[__i]));
+            while (__hook) {
+                HashHook_t *__next = static_cast<HashHook_t *>(
+                        self_get(__hook->next));
+                link(__hook);
+                __hook = __next;
+            }
+        }
+        if (__old)
+            Allocator_t<std::ptrdiff_t>().deallocate(__old, __old_buckets);
+    }
+
+    /**
+     * @short Unlink all objects.
+     */
+    void clear() { clear_and_dispose(Ignore_t());}
+
+    /**
+     * @short Unlink all objects and pass them to disposer (e.g. to
+     * destroy them).
+     * @param __disposer functor called with pointer to object.
+     */
+    template <typename _Disposer>
+    void clear_and_dispose(_Disposer __disposer) {
+        for (size_type __i = 0; __i < buckets; ++__i) {
+            HashHook_t *__hook = static_cast<HashHook_t *>(
+                    self_get(*bucket(__i)));
+            *bucket(__i) = 0;
+            while (__hook) {
+                HashHook_t *__next = static_cast<HashHook_t *>(
+                        self_get(__hook->next));
+                __hook->next = 0;
+                __disposer(Member_t::to_value(__hook));
+                __hook = __next;
+            }
+        }
+        elements = 0;
+    }
+
+private:
+    shintrusive_hash(const shintrusive_hash &);
+    shintrusive_hash &operator=(const shintrusive_hash &);
+
+    /**
+     * @short Disposer doing nothing.
+     */
+    struct Ignore_t {
+        void operator()(_Tp *) const {}
+    };
+
+    std::ptrdiff_t *bucket(size_type __i) const {
+        return static_cast<std::ptrdiff_t *>(self_get(table)) + __i;
+    }
+
+    size_type index(std::size_t __hash) const {
+        return __hash & (buckets - 1);
+    }
+
+    /**
+     * @short Return first hook of first nonempty bucket from index.
+     */
+    HashHook_t *first_from(size_type __i) const {
+        for (; __i < buckets; ++__i)
+            if (HashHook_t *__hook = static_cast<HashHook_t *>(
+                        self_get(*bucket(__i))))
+                return __hook;
+        return 0;
+    }
+
+    void link(HashHook_t *__hook) {
+        std::ptrdiff_t *__head = bucket(index(__hook->hash));
+        self_set(__hook->next, self_get(*__head));
+        self_set(*__head, __hook);
+    }
+
+    void unlink(HashHook_t *__hook) {
+        std::ptrdiff_t *__link = bucket(index(__hook->hash));
+        for (HashHook_t *__x; (__x = static_cast<HashHook_t *>(
+                        self_get(*__link))) != __hook;)
+            __link = &__x->next;
+        self_set(*__link, self_get(__hook->next));
+        __hook->next = 0;
+    }
+
+    std::ptrdiff_t table;   //< bucket array.
+    size_type buckets;      //< count of buckets.
+    size_type elements;     //< count of objects.
+    _Hash hash;             //< hash functor.
+    _Equal equal;           //< equality functor.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHINTRUSIVE_HASH_H */
+
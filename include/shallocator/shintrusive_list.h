@@ -0,0 +1,292 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Intrusive shared memory list.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHINTRUSIVE_LIST_H
+#define SHALLOCATOR_SHINTRUSIVE_LIST_H
+
+#include <iterator>
+#include <shallocator/shintrusive.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Doubly linked list of objects that carry the links themselves
+ * (ListHook_t member given by _Hook). List doesn't allocate and doesn't
+ * own its objects: they must outlive their membership and are released
+ * by clear_and_dispose() or by the caller. One object can be in as many
+ * lists as it has hooks.
+ *
+ * All links are self-relative (see self_get()), so list and objects can
+ * be mapped at different addresses in different processes. List itself
+ * must live in the same segment as its objects and can't be copied.
+ *
+ * Example:
+ *
+ *   struct Job_t { int id; ListHook_t queue, owner;};
+ *   shintrusive_list<Job_t, &Job_t::queue> *queue = ...;
+ *   queue->push_back(*new (SHAlloc) Job_t());
+ */
+template <typename _Tp, ListHook_t _Tp::*_Hook>
+class shintrusive_list {
+    typedef MemberHook_t<_Tp, ListHook_t, _Hook> Member_t;
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Bidirectional iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): hook(0), list(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : hook(__other.hook), list(__other.list) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            hook = __other.hook;
+            list = __other.list;
+            return *this;
+        }
+
+        reference operator*() const { return *Member_t::to_value(hook);}
+
+        pointer operator->() const { return Member_t::to_value(hook);}
+
+        Iterator_t &operator++() {
+            hook = static_cast<ListHook_t *>(self_get(hook->next));
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator--() {
+            hook = hook? static_cast<ListHook_t *>(self_get(hook->prev))
+                       : list->last();
+            return *this;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return hook == __other.hook;
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return hook != __other.hook;
+        }
+
+    private:
+        Iterator_t(ListHook_t *__hook, const shintrusive_list *__list)
+            : hook(__hook), list(__list) {}
+
+        friend class shintrusive_list;
+        template <typename> friend class Iterator_t;
+
+        ListHook_t *hook;               //< current hook, 0 for end().
+        const shintrusive_list *list;   //< owning list (for --end()).
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Create empty list.
+     */
+    shintrusive_list(): head(0), tail(0), elements(0) {}
+
+    /**
+     * @short Unlink all objects (they are not destroyed).
+     */
+    ~shintrusive_list() { clear();}
+
+    iterator begin() { return iterator(first(), this);}
+    const_iterator begin() const { return const_iterator(first(), this);}
+    iterator end() { return iterator(0, this);}
+    const_iterator end() const { return const_iterator(0, this);}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of objects.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no object.
+     */
+    bool empty() const { return !elements;}
+
+    reference front() { return *Member_t::to_value(first());}
+    const_reference front() const { return *Member_t::to_value(first());}
+    reference back() { return *Member_t::to_value(last());}
+    const_reference back() const { return *Member_t::to_value(last());}
+
+    void push_front(_Tp &__value) { insert(begin(), __value);}
+    void push_back(_Tp &__value) { insert(end(), __value);}
+    void pop_front() { erase(begin());}
+    void pop_back() { erase(iterator(last(), this));}
+
+    /**
+     * @short Return iterator to object linked in this list.
+     * @param __value object.
+     */
+    iterator iterator_to(_Tp &__value) {
+        return iterator(Member_t::to_hook(__value), this);
+    }
+
+    /**
+     * @short Link object before position.
+     * @param __pos position.
+     * @param __value object not linked in this list.
+     * @return iterator to object.
+     */
+    iterator insert(const_iterator __pos, _Tp &__value) {
+        ListHook_t *__hook = Member_t::to_hook(__value);
+        ListHook_t *__next = __pos.hook;
+        ListHook_t *__prev = __next? static_cast<ListHook_t *>(
+                                             self_get(__next->prev))
+                                   : last();
+        self_set(__hook->next, __next);
+        self_set(__hook->prev, __prev);
+        if (__prev) self_set(__prev->next, __hook);
+        else self_set(head, __hook);
+        if (__next) self_set(__next->prev, __hook);
+        else self_set(tail, __hook);
+        ++elements;
+        return iterator(__hook, this);
+    }
+
+    /**
+     * @short Unlink object at position.
+     * @param __pos valid dereferenceable iterator.
+     * @return iterator to next object.
+     */
+    iterator erase(const_iterator __pos) {
+        ListHook_t *__hook = __pos.hook;
+        ListHook_t *__next = static_cast<ListHook_t *>(self_get(__hook->next));
+        ListHook_t *__prev = static_cast<ListHook_t *>(self_get(__hook->prev));
+        if (__prev) self_set(__prev->next, __next);
+        else self_set(head, __next);
+        if (__next) self_set(__next->prev, __prev);
+        else self_set(tail, __prev);
+        __hook->next = __hook->prev = 0;
+        --elements;
+        return iterator(__next, this);
+    }
+
+    /**
+     * @short Unlink object linked in this list.
+     * @param __value object.
+     */
+    void erase(_Tp &__value) { erase(iterator_to(__value));}
+
+    /**
+     * @short Unlink all objects.
+     */
+    void clear() {
+        clear_and_dispose(Ignore_t());
+    }
+
+    /**
+     * @short Unlink all objects and pass them to disposer (e.g. to
+     * destroy them).
+     * @param __disposer functor called with pointer to object.
+     */
+    template <typename _Disposer>
+    void clear_and_dispose(_Disposer __disposer) {
+        while (ListHook_t *__hook = first()) {
+            self_set(head, self_get(__hook->next));
+            __hook->next = __hook->prev = 0;
+            --elements;
+            __disposer(Member_t::to_value(__hook));
+        }
+        tail = 0;
+    }
+
+private:
+    shintrusive_list(const shintrusive_list &);
+    shintrusive_list &operator=(const shintrusive_list &);
+
+    /**
+     * @short Disposer doing nothing.
+     */
+    struct Ignore_t {
+        void operator()(_Tp *) const {}
+    };
+
+    ListHook_t *first() const {
+        return static_cast<ListHook_t *>(self_get(head));
+    }
+
+    ListHook_t *last() const {
+        return static_cast<ListHook_t *>(self_get(tail));
+    }
+
+    std::ptrdiff_t head;    //< first hook.
+    std::ptrdiff_t tail;    //< last hook.
+    size_type elements;     //< count of objects.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHINTRUSIVE_LIST_H */
+
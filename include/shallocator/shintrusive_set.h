@@ -0,0 +1,455 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Intrusive shared memory red-black tree set.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHINTRUSIVE_SET_H
+#define SHALLOCATOR_SHINTRUSIVE_SET_H
+
+#include <iterator>
+#include <functional>
+#include <utility>
+#include <shallocator/shintrusive.h>
+#include <shallocator/shrbtree_algo.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Node traits for RBTreeAlgo_t over self-relative TreeHook_t.
+ */
+struct IntrusiveTreeTraits_t {
+    /// node pointer
+    typedef TreeHook_t *node_ptr;
+
+    /// color bit in parent link
+    static const std::ptrdiff_t RED = 1;
+
+    static node_ptr left(node_ptr __x) {
+        return static_cast<node_ptr>(self_get(__x->left));
+    }
+
+    static node_ptr right(node_ptr __x) {
+        return static_cast<node_ptr>(self_get(__x->right));
+    }
+
+    static node_ptr parent(node_ptr __x) {
+        std::ptrdiff_t __link = __x->parent & ~RED;
+        return __link? reinterpret_cast<node_ptr>(
+                           reinterpret_cast<char *>(&__x->parent) + __link)
+                     : 0;
+    }
+
+    static void set_left(node_ptr __x, node_ptr __l) {
+        self_set(__x->left, __l);
+    }
+
+    static void set_right(node_ptr __x, node_ptr __r) {
+        self_set(__x->right, __r);
+    }
+
+    static void set_parent(node_ptr __x, node_ptr __p) {
+        std::ptrdiff_t __red = __x->parent & RED;
+        self_set(__x->parent, __p);
+        __x->parent |= __red;
+    }
+
+    static bool is_red(node_ptr __x) { return __x->parent & RED;}
+
+    static void set_red(node_ptr __x, bool __red) {
+        __x->parent = (__x->parent & ~RED) | (__red? RED: 0);
+    }
+};
+
+/**
+ * @short Ordered set of objects that carry the tree links themselves
+ * (TreeHook_t member given by _Hook). Set doesn't allocate and doesn't
+ * own its objects: they must outlive their membership and are released
+ * by clear_and_dispose() or by the caller. Objects equal by _Compare are
+ * rejected by insert(). Don't change ordering key of linked object.
+ *
+ * All links are self-relative (see self_get()), so set and objects can be
+ * mapped at different addresses in different processes. Set itself must
+ * live in the same segment as its objects and can't be copied.
+ */
+template <typename _Tp, TreeHook_t _Tp::*_Hook,
+          typename _Compare = std::less<_Tp> >
+class shintrusive_set {
+    typedef MemberHook_t<_Tp, TreeHook_t, _Hook> Member_t;
+    typedef IntrusiveTreeTraits_t Traits_t;
+    typedef RBTreeAlgo_t<Traits_t> Algo_t;
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// key type
+    typedef _Tp key_type;
+    /// comparator
+    typedef _Compare key_compare;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Bidirectional iterator.
+     */
+    template <typename _Ref>
+    class Iterator_t {
+    public:
+        /// iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /// value type
+        typedef _Tp value_type;
+        /// reference type
+        typedef _Ref &reference;
+        /// pointer type
+        typedef _Ref *pointer;
+        /// difference type
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator_t(): hook(0), tree(0) {}
+
+        /**
+         * @short Conversion from non const iterator.
+         */
+        Iterator_t(const Iterator_t<_Tp> &__other)
+            : hook(__other.hook), tree(__other.tree) {}
+
+        Iterator_t &operator=(const Iterator_t &__other) {
+            hook = __other.hook;
+            tree = __other.tree;
+            return *this;
+        }
+
+        reference operator*() const { return *Member_t::to_value(hook);}
+
+        pointer operator->() const { return Member_t::to_value(hook);}
+
+        Iterator_t &operator++() {
+            hook = Algo_t::next(hook);
+            return *this;
+        }
+
+        Iterator_t operator++(int) {
+            Iterator_t __tmp(*this);
+            ++*this;
+            return __tmp;
+        }
+
+        Iterator_t &operator--() {
+            hook = hook? Algo_t::prev(hook): Algo_t::maximum(tree->root());
+            return *this;
+        }
+
+        Iterator_t operator--(int) {
+            Iterator_t __tmp(*this);
+            --*this;
+            return __tmp;
+        }
+
+        bool operator==(const Iterator_t &__other) const {
+            return hook == __other.hook;
+        }
+
+        bool operator!=(const Iterator_t &__other) const {
+            return hook != __other.hook;
+        }
+
+    private:
+        Iterator_t(TreeHook_t *__hook, const shintrusive_set *__tree)
+            : hook(__hook), tree(__tree) {}
+
+        friend class shintrusive_set;
+        template <typename> friend class Iterator_t;
+
+        TreeHook_t *hook;               //< current hook, 0 for end().
+        const shintrusive_set *tree;    //< owning set (for --end()).
+    };
+
+    /// iterator
+    typedef Iterator_t<_Tp> iterator;
+    /// const iterator
+    typedef Iterator_t<const _Tp> const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * @short Create empty set.
+     * @param __comp A comparison functor.
+     */
+    explicit shintrusive_set(const _Compare &__comp = _Compare())
+        : top(0), elements(0), comp(__comp)
+    {}
+
+    /**
+     * @short Unlink all objects (they are not destroyed).
+     */
+    ~shintrusive_set() { clear();}
+
+    iterator begin() { return iterator(leftmost(), this);}
+    const_iterator begin() const { return const_iterator(leftmost(), this);}
+    iterator end() { return iterator(0, this);}
+    const_iterator end() const { return const_iterator(0, this);}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of objects.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return true if there is no object.
+     */
+    bool empty() const { return !elements;}
+
+    /**
+     * @short Return comparator.
+     */
+    key_compare key_comp() const { return comp;}
+
+    /**
+     * @short Return iterator to object linked in this set.
+     * @param __value object.
+     */
+    iterator iterator_to(_Tp &__value) {
+        return iterator(Member_t::to_hook(__value), this);
+    }
+
+    /**
+     * @short Link object unless equal one is already linked.
+     * @param __value object not linked in this set.
+     * @return iterator to linked object and true if __value was linked.
+     */
+    std::pair<iterator, bool> insert(_Tp &__value) {
+        TreeHook_t *__x = root();
+        TreeHook_t *__parent = 0;
+        bool __less = true;
+        while (__x) {
+            __parent = __x;
+            __less = comp(__value, *Member_t::to_value(__x));
+            __x = __less? Traits_t::left(__x): Traits_t::right(__x);
+        }
+
+        // predecessor of the place is the only candidate for equality
+        TreeHook_t *__pred = (__less && __parent)? Algo_t::prev(__parent)
+                                                 : __parent;
+        if (__pred && !comp(*Member_t::to_value(__pred), __value))
+            return std::make_pair(iterator(__pred, this), false);
+
+        TreeHook_t *__hook = Member_t::to_hook(__value);
+        TreeHook_t *__top = root();
+        Algo_t::insert(__hook, __parent, __less, __top);
+        self_set(top, __top);
+        ++elements;
+        return std::make_pair(iterator(__hook, this), true);
+    }
+
+    /**
+     * @short Unlink object at position.
+     * @param __pos valid dereferenceable iterator.
+     * @return iterator to next object.
+     */
+    iterator erase(const_iterator __pos) {
+        TreeHook_t *__next = Algo_t::next(__pos.hook);
+        TreeHook_t *__top = root();
+        Algo_t::erase(__pos.hook, __top);
+        self_set(top, __top);
+        --elements;
+        return iterator(__next, this);
+    }
+
+    /**
+     * @short Unlink object linked in this set.
+     * @param __value object.
+     */
+    void erase(_Tp &__value) { erase(iterator_to(__value));}
+
+    /**
+     * @short Find object equal to key.
+     * @param __key key.
+     * @return iterator to found object or end().
+     */
+    iterator find(const _Tp &__key) { return find(__key, comp);}
+    const_iterator find(const _Tp &__key) const { return find(__key, comp);}
+
+    /**
+     * @short Find object by key of other type.
+     * @param __key key.
+     * @param __comp comparator accepting (object, key) and (key, object).
+     * @return iterator to found object or end().
+     */
+    template <typename _Key, typename _KeyCompare>
+    iterator find(const _Key &__key, _KeyCompare __comp) {
+        return iterator(find_hook(__key, __comp), this);
+    }
+
+    template <typename _Key, typename _KeyCompare>
+    const_iterator find(const _Key &__key, _KeyCompare __comp) const {
+        return const_iterator(find_hook(__key, __comp), this);
+    }
+
+    /**
+     * @short Return count of objects equal to key (0 or 1).
+     */
+    size_type count(const _Tp &__key) const {
+        return find_hook(__key, comp) != 0;
+    }
+
+    /**
+     * @short Return first object not less than key.
+     */
+    iterator lower_bound(const _Tp &__key) {
+        return lower_bound(__key, comp);
+    }
+
+    const_iterator lower_bound(const _Tp &__key) const {
+        return lower_bound(__key, comp);
+    }
+
+    /**
+     * @short Return first object not less than key of other type.
+     * @param __key key.
+     * @param __comp comparator accepting (object, key).
+     */
+    template <typename _Key, typename _KeyCompare>
+    iterator lower_bound(const _Key &__key, _KeyCompare __comp) {
+        return iterator(lower_bound_hook(__key, __comp), this);
+    }
+
+    template <typename _Key, typename _KeyCompare>
+    const_iterator lower_bound(const _Key &__key, _KeyCompare __comp) const {
+        return const_iterator(lower_bound_hook(__key, __comp), this);
+    }
+
+    /**
+     * @short Return first object greater than key.
+     */
+    iterator upper_bound(const _Tp &__key) {
+        return iterator(upper_bound_hook(__key), this);
+    }
+
+    const_iterator upper_bound(const _Tp &__key) const {
+        return const_iterator(upper_bound_hook(__key), this);
+    }
+
+    /**
+     * @short Unlink all objects.
+     */
+    void clear() { clear_and_dispose(Ignore_t());}
+
+    /**
+     * @short Unlink all objects and pass them to disposer (e.g. to
+     * destroy them). Objects are visited in post-order, so disposer may
+     * free them.
+     * @param __disposer functor called with pointer to object.
+     */
+    template <typename _Disposer>
+    void clear_and_dispose(_Disposer __disposer) {
+        TreeHook_t *__x = root();
+        while (__x) {
+            if (TreeHook_t *__l = Traits_t::left(__x)) {
+                __x = __l;
+                continue;
+            }
+            if (TreeHook_t *__r = Traits_t::right(__x)) {
+                __x = __r;
+                continue;
+            }
+            TreeHook_t *__p = Traits_t::parent(__x);
+            if (__p) {
+                if (Traits_t::left(__p) == __x) Traits_t::set_left(__p, 0);
+                else Traits_t::set_right(__p, 0);
+            }
+            __x->parent = 0;
+            __disposer(Member_t::to_value(__x));
+            __x = __p;
+        }
+        top = 0;
+        elements = 0;
+    }
+
+private:
+    shintrusive_set(const shintrusive_set &);
+    shintrusive_set &operator=(const shintrusive_set &);
+
+    /**
+     * @short Disposer doing nothing.
+     */
+    struct Ignore_t {
+        void operator()(_Tp *) const {}
+    };
+
+    TreeHook_t *root() const {
+        return static_cast<TreeHook_t *>(self_get(top));
+    }
+
+    TreeHook_t *leftmost() const {
+        TreeHook_t *__root = root();
+        return __root? Algo_t::minimum(__root): 0;
+    }
+
+    template <typename _Key, typename _KeyCompare>
+    TreeHook_t *lower_bound_hook(const _Key &__key, _KeyCompare __comp) const {
+        TreeHook_t *__x = root();
+        TreeHook_t *__bound = 0;
+        while (__x) {
+            if (!__comp(*Member_t::to_value(__x), __key)) {
+                __bound = __x;
+                __x = Traits_t::left(__x);
+            } else __x = Traits_t::right(__x);
+        }
+        return __bound;
+    }
+
+    TreeHook_t *upper_bound_hook(const _Tp &__key) const {
+        TreeHook_t *__x = root();
+        TreeHook_t *__bound = 0;
+        while (__x) {
+            if (comp(__key, *Member_t::to_value(__x))) {
+                __bound = __x;
+                __x = Traits_t::left(__x);
+            } else __x = Traits_t::right(__x);
+        }
+        return __bound;
+    }
+
+    template <typename _Key, typename _KeyCompare>
+    TreeHook_t *find_hook(const _Key &__key, _KeyCompare __comp) const {
+        TreeHook_t *__x = lower_bound_hook(__key, __comp);
+        return (!__x || __comp(__key, *Member_t::to_value(__x)))? 0: __x;
+    }
+
+    std::ptrdiff_t top;     //< root hook.
+    size_type elements;     //< count of objects.
+    _Compare comp;          //< comparator.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHINTRUSIVE_SET_H */
+
@@ -0,0 +1,74 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Large allocation area.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHLARGE_H
+#define SHALLOCATOR_SHLARGE_H
+
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Statistics of large allocation area.
+ */
+struct LargeAreaStats_t {
+    std::size_t capacity;   //< size of area usable for blocks.
+    std::size_t used;       //< bytes held by live blocks.
+    std::size_t blocks;     //< count of live blocks.
+    std::size_t granule;    //< allocation unit.
+};
+
+/**
+ * @short Create large allocation area.
+ *
+ * Blocks of threshold size and bigger don't go to libmm heap but to
+ * separate shared mapping where they are placed on granule boundaries.
+ * When such block is freed its pages are returned to the OS
+ * (MADV_REMOVE), so big short living buffers don't fragment the libmm
+ * heap nor hold memory after free. Blocks that don't fit to the area go
+ * to libmm as before.
+ *
+ * Mapping is only reserved (MAP_NORESERVE), pages are backed on first
+ * touch. Call it once before fork, together with MM_create(), children
+ * inherit the mapping at the same address.
+ *
+ * @param size size of area (rounded up to granule).
+ * @param threshold min size of block placed in area.
+ * @param granule allocation unit, multiple of page size.
+ * @exception std::runtime_error if area can't be created.
+ */
+void create_large_area(std::size_t size,
+                       std::size_t threshold = 1024 * 1024,
+                       std::size_t granule = 64 * 1024);
+
+/**
+ * @short Unmap large allocation area. All blocks in it become invalid.
+ * Call it in the process that created area, after children exited.
+ */
+void destroy_large_area();
+
+/**
+ * @short Return statistics of large allocation area.
+ * @return statistics (zeros if there is no area).
+ */
+LargeAreaStats_t large_area_stats();
+
+}
+
+#endif /* SHALLOCATOR_SHLARGE_H */
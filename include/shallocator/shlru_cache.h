@@ -0,0 +1,656 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Bounded shared memory cache with CLOCK eviction.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHLRU_CACHE_H
+#define SHALLOCATOR_SHLRU_CACHE_H
+
+#include <new>
+#include <cstring>
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+#include <shallocator/shmutex.h>
+#include <shallocator/shhash.h>
+#include <shallocator/shper_process.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Default charge of cache entry: its static size.
+ */
+template <typename _Key, typename _Tp>
+struct shlru_charge {
+    std::size_t operator()(const _Key &, const _Tp &) const {
+        return sizeof(_Key) + sizeof(_Tp);
+    }
+};
+
+/**
+ * @short Bounded shared memory cache.
+ *
+ * Entries are spread over _Segments independent segments. Each segment
+ * has fixed array of slots and open addressing index allocated when cache
+ * is created, so put() never allocates nodes and old entries are evicted
+ * by CLOCK (second chance) algorithm instead of running out of pool.
+ *
+ * Lookups of trivially copyable keys and values (integers, PODs) take no
+ * lock: entry is copied optimistically and validated by version of the
+ * segment (seqlock) that is odd while writer holds the segment; lookup
+ * that meets writer falls back to read lock of the segment. Other types
+ * (e.g. %shstring) are always copied under read lock. Entry is marked as
+ * recently used by relaxed atomic store that is skipped when mark is
+ * already set, so recency is approximate (CLOCK bit of entry that has
+ * just been replaced may be set). Hits and misses are counted in per
+ * process slots, so lookup of marked entry writes no shared cache line.
+ *
+ * Capacity is given as count of entries and optionally as sum of entry
+ * charges (_Charge functor, e.g. string lengths).
+ */
+template <typename _Key, typename _Tp, std::size_t _Segments = 16,
+          typename _Hash = shhash<_Key>,
+          typename _Charge = shlru_charge<_Key, _Tp> >
+class shlru_cache {
+public:
+    /// type of key
+    typedef _Key key_type;
+    /// type of value
+    typedef _Tp mapped_type;
+    /// type of size
+    typedef std::size_t size_type;
+
+    /**
+     * @short Cache statistics.
+     */
+    struct Stats_t {
+        uint64_t hits;          //< successful lookups.
+        uint64_t misses;        //< unsuccessful lookups.
+        uint64_t inserts;       //< inserted entries.
+        uint64_t evictions;     //< evicted entries.
+    };
+
+    /**
+     * @short Create empty cache.
+     * @param __max_entries max count of entries.
+     * @param __max_charge max sum of entries charges, 0 means unlimited.
+     * @param __hash A hash functor.
+     * @param __charge A charge functor.
+     */
+    explicit
+    shlru_cache(size_type __max_entries, size_type __max_charge = 0,
+                const _Hash &__hash = _Hash(),
+                const _Charge &__charge = _Charge())
+        : hash(__hash), charge(__charge),
+          max_charge((__max_charge + _Segments - 1) / _Segments)
+    {
+        size_type __capacity = (__max_entries + _Segments - 1) / _Segments;
+        if (!__capacity) __capacity = 1;
+        size_type __i = 0;
+        try {
+            for (; __i < _Segments; ++__i)
+                segments[__i].init(__capacity);
+        } catch (...) {
+            while (__i) segments[--__i].release();
+            throw;
+        }
+    }
+
+    /**
+     * @short Free all entries.
+     */
+    ~shlru_cache() {
+        for (size_type __i = 0; __i < _Segments; ++__i)
+            segments[__i].release();
+    }
+
+    /**
+     * @short Copy value of key out of cache and mark it as used.
+     * @param __key key.
+     * @param __value found value will be assigned here.
+     * @return true if key has been found.
+     */
+    template <typename _Out>
+    bool get(const _Key &__key, _Out &__value) const {
+        size_type __h = hash(__key);
+        const Segment_t &__seg = segment(__h);
+        size_type __slot;
+        if (optimistic) {
+            _Tp __copy = _Tp();
+            if (__seg.peek(__key, __h, &__copy, __slot)) {
+                count(__seg, __slot);
+                if (__slot == npos) return false;
+                __seg.mark(__slot);
+                __value = __copy;
+                return true;
+            }
+        }
+
+        SharedLock_t<SeqLock_t> __lock(__seg.lock);
+        __slot = __seg.lookup(__key, __h);
+        count(__seg, __slot);
+        if (__slot == npos) return false;
+        __seg.mark(__slot);
+        __value = __seg.slots[__slot].value;
+        return true;
+    }
+
+    /**
+     * @short Return true if key is cached, don't mark it as used.
+     * @param __key key.
+     * @return true if key has been found.
+     */
+    bool contains(const _Key &__key) const {
+        size_type __h = hash(__key);
+        const Segment_t &__seg = segment(__h);
+        size_type __slot;
+        if (optimistic && __seg.peek(__key, __h, 0, __slot))
+            return __slot != npos;
+        SharedLock_t<SeqLock_t> __lock(__seg.lock);
+        return __seg.lookup(__key, __h) != npos;
+    }
+
+    /**
+     * @short Insert or replace value of key, evict entries if needed.
+     * @param __key key.
+     * @param __value value.
+     */
+    void put(const _Key &__key, const _Tp &__value) {
+        size_type __h = hash(__key);
+        Segment_t &__seg = segment(__h);
+        ScopedLock_t<SeqLock_t> __lock(__seg.lock);
+        size_type __charge = charge(__key, __value);
+
+        size_type __slot = __seg.lookup(__key, __h);
+        if (__slot != npos) {
+            // replace value, evict other entries when pool is full
+            Slot_t &__s = __seg.slots[__slot];
+            for (;;) {
+                try {
+                    __s.value = __value;
+                    break;
+                } catch (const std::bad_alloc &) {
+                    if (!__seg.evict_one(__slot)) throw;
+                }
+            }
+            __seg.charge = __seg.charge - __s.charge + __charge;
+            __s.charge = __charge;
+            __s.referenced = 1;
+        } else {
+            if (__seg.used == __seg.capacity) __seg.evict_one(npos);
+            __slot = __seg.free_slot();
+            Slot_t &__s = __seg.slots[__slot];
+            for (;;) {
+                try {
+                    __s.key = __key;
+                    __s.value = __value;
+                    break;
+                } catch (const std::bad_alloc &) {
+                    __s.key = _Key();
+                    __s.value = _Tp();
+                    if (!__seg.evict_one(__slot)) throw;
+                }
+            }
+            __s.hash = __h;
+            __s.charge = __charge;
+            __s.referenced = 0;
+            __s.used = true;
+            __seg.link(__slot);
+            __seg.charge += __charge;
+            ++__seg.used;
+            __atomic_fetch_add(&__seg.stats.inserts, 1, __ATOMIC_RELAXED);
+        }
+
+        // charge limit
+        if (max_charge)
+            while ((__seg.charge > max_charge) && __seg.evict_one(__slot));
+    }
+
+    /**
+     * @short Remove key from cache.
+     * @param __key key.
+     * @return true if key has been found.
+     */
+    bool erase(const _Key &__key) {
+        size_type __h = hash(__key);
+        Segment_t &__seg = segment(__h);
+        ScopedLock_t<SeqLock_t> __lock(__seg.lock);
+        size_type __slot = __seg.lookup(__key, __h);
+        if (__slot == npos) return false;
+        __seg.remove(__slot);
+        return true;
+    }
+
+    /**
+     * @short Remove all entries.
+     */
+    void clear() {
+        for (size_type __i = 0; __i < _Segments; ++__i) {
+            Segment_t &__seg = segments[__i];
+            ScopedLock_t<SeqLock_t> __lock(__seg.lock);
+            for (size_type __s = 0; __s < __seg.capacity; ++__s)
+                if (__seg.slots[__s].used) __seg.remove(__s);
+        }
+    }
+
+    /**
+     * @short Evict entries by CLOCK algorithm, e.g. from memory pressure
+     * callback (see shpressure.h). Segments locked by anybody else (or by
+     * put() that triggered the callback) are skipped.
+     * @param __count max count of evicted entries.
+     * @return count of evicted entries.
+     */
+    size_type shrink(size_type __count) {
+        size_type __evicted = 0;
+        for (bool __progress = true; __progress && (__evicted < __count);) {
+            __progress = false;
+            for (size_type __i = 0; __i < _Segments; ++__i) {
+                if (__evicted == __count) break;
+                Segment_t &__seg = segments[__i];
+                if (!__seg.lock.try_lock()) continue;
+                if (__seg.evict_one(npos)) {
+                    ++__evicted;
+                    __progress = true;
+                }
+                __seg.lock.unlock();
+            }
+        }
+        return __evicted;
+    }
+
+    /**
+     * @short Return count of entries (segments are locked one by one).
+     */
+    size_type size() const {
+        size_type __size = 0;
+        for (size_type __i = 0; __i < _Segments; ++__i) {
+            SharedLock_t<SeqLock_t> __lock(segments[__i].lock);
+            __size += segments[__i].used;
+        }
+        return __size;
+    }
+
+    /**
+     * @short Return sum of charges of entries.
+     */
+    size_type charged() const {
+        size_type __charge = 0;
+        for (size_type __i = 0; __i < _Segments; ++__i) {
+            SharedLock_t<SeqLock_t> __lock(segments[__i].lock);
+            __charge += segments[__i].charge;
+        }
+        return __charge;
+    }
+
+    /**
+     * @short Return max count of entries.
+     */
+    size_type capacity() const { return segments[0].capacity * _Segments;}
+
+    /**
+     * @short Return statistics summed over segments.
+     */
+    Stats_t stats() const {
+        Stats_t __stats = lookups.for_each(Summer_t()).stats;
+        for (size_type __i = 0; __i < _Segments; ++__i) {
+            const Stats_t &__s = segments[__i].stats;
+            __stats.hits += __atomic_load_n(&__s.hits, __ATOMIC_RELAXED);
+            __stats.misses += __atomic_load_n(&__s.misses, __ATOMIC_RELAXED);
+            __stats.inserts += __atomic_load_n(&__s.inserts, __ATOMIC_RELAXED);
+            __stats.evictions
+                += __atomic_load_n(&__s.evictions, __ATOMIC_RELAXED);
+        }
+        return __stats;
+    }
+
+private:
+    shlru_cache(const shlru_cache &);
+    shlru_cache &operator=(const shlru_cache &);
+
+    /// invalid slot
+    static const size_type npos = ~size_type(0);
+
+    /// entries can be copied without lock
+    static const bool optimistic = __is_trivially_copyable(_Key)
+        && __is_trivially_copyable(_Tp);
+
+    /**
+     * @short Read/write lock of segment with version (seqlock). Version is
+     * odd while segment is locked for writing, lock-free readers validate
+     * what they have read by it.
+     */
+    class SeqLock_t {
+    public:
+        SeqLock_t(): version(0) {}
+
+        void lock() {
+            rwlock.lock();
+            begin_write();
+        }
+
+        bool try_lock() {
+            if (!rwlock.try_lock()) return false;
+            begin_write();
+            return true;
+        }
+
+        void unlock() {
+            __atomic_store_n(&version, version + 1, __ATOMIC_RELEASE);
+            rwlock.unlock();
+        }
+
+        void lock_shared() { rwlock.lock_shared();}
+
+        void unlock_shared() { rwlock.unlock_shared();}
+
+        /**
+         * @short Return version before lock-free read.
+         */
+        uint32_t read_begin() const {
+            return __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+        }
+
+        /**
+         * @short Return true if data read since read_begin() may be torn.
+         */
+        bool read_retry(uint32_t __version) const {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            return (__version & 1)
+                || (__atomic_load_n(&version, __ATOMIC_RELAXED) != __version);
+        }
+
+    private:
+        SeqLock_t(const SeqLock_t &);
+        SeqLock_t &operator=(const SeqLock_t &);
+
+        void begin_write() {
+            __atomic_store_n(&version, version + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+        }
+
+        RWLock_t rwlock;    //< lock of writers and locked readers.
+        uint32_t version;   //< odd while writer holds the lock.
+    };
+
+    /**
+     * @short Lookup counters of one process.
+     */
+    struct Lookups_t {
+        Lookups_t(): hits(0), misses(0) {}
+
+        uint64_t hits;      //< successful lookups.
+        uint64_t misses;    //< unsuccessful lookups.
+    };
+
+    /**
+     * @short Sums lookup counters of processes.
+     */
+    struct Summer_t {
+        Summer_t() {
+            Stats_t __zero = {0, 0, 0, 0};
+            stats = __zero;
+        }
+
+        void operator()(pid_t, const Lookups_t &__lookups) {
+            stats.hits += __atomic_load_n(&__lookups.hits, __ATOMIC_RELAXED);
+            stats.misses
+                += __atomic_load_n(&__lookups.misses, __ATOMIC_RELAXED);
+        }
+
+        Stats_t stats;      //< sums.
+    };
+
+    /**
+     * @short Cache entry.
+     */
+    struct Slot_t {
+        Slot_t()
+            : key(), value(), hash(0), charge(0), referenced(0), used(false)
+        {}
+
+        _Key key;                   //< key.
+        _Tp value;                  //< value.
+        size_type hash;             //< hash of key.
+        size_type charge;           //< charge of entry.
+        unsigned char referenced;   //< CLOCK reference bit.
+        bool used;                  //< slot holds entry.
+    };
+
+    /**
+     * @short Independently locked part of cache.
+     */
+    struct Segment_t {
+        /**
+         * @short Allocate slots and index.
+         */
+        void init(size_type __capacity) {
+            slots = 0;
+            index = 0;
+            capacity = __capacity;
+            for (mask = 1; mask < 2 * capacity; mask <<= 1);
+            Allocator_t<Slot_t> __salloc;
+            Allocator_t<uint32_t> __ialloc;
+            index = __ialloc.allocate(mask);
+            for (size_type __i = 0; __i < mask; ++__i) index[__i] = 0;
+            --mask;
+            try {
+                slots = __salloc.allocate(capacity);
+                for (size_type __i = 0; __i < capacity; ++__i)
+                    __salloc.construct(slots + __i, Slot_t());
+            } catch (...) {
+                if (slots) __salloc.deallocate(slots, capacity);
+                __ialloc.deallocate(index, mask + 1);
+                slots = 0;
+                index = 0;
+                throw;
+            }
+            used = 0;
+            hand = 0;
+            charge = 0;
+            Stats_t __zero = {0, 0, 0, 0};
+            stats = __zero;
+        }
+
+        /**
+         * @short Free slots and index.
+         */
+        void release() {
+            if (!slots) return;
+            Allocator_t<Slot_t> __salloc;
+            for (size_type __i = 0; __i < capacity; ++__i)
+                __salloc.destroy(slots + __i);
+            __salloc.deallocate(slots, capacity);
+            Allocator_t<uint32_t>().deallocate(index, mask + 1);
+            slots = 0;
+        }
+
+        /**
+         * @short Find slot of key.
+         */
+        size_type lookup(const _Key &__key, size_type __h) const {
+            for (size_type __i = __h & mask; index[__i]; __i = (__i + 1) & mask) {
+                const Slot_t &__s = slots[index[__i] - 1];
+                if ((__s.hash == __h) && (__s.key == __key))
+                    return index[__i] - 1;
+            }
+            return npos;
+        }
+
+        /**
+         * @short Find slot of key and copy its value without lock.
+         * @param __value copy of value (if not 0).
+         * @param __slot slot of key or npos.
+         * @return false if segment has been modified meanwhile.
+         */
+        bool peek(const _Key &__key, size_type __h, _Tp *__value,
+                  size_type &__slot) const
+        {
+            uint32_t __version = lock.read_begin();
+            __slot = npos;
+            for (size_type __n = 0, __i = __h & mask; __n <= mask;
+                    ++__n, __i = (__i + 1) & mask)
+            {
+                uint32_t __e = __atomic_load_n(&index[__i], __ATOMIC_RELAXED);
+                if (!__e || (__e > capacity)) break;
+                const Slot_t &__s = slots[__e - 1];
+                if ((__s.hash != __h) || !(__s.key == __key)) continue;
+                if (__value)
+                    std::memcpy(static_cast<void *>(__value),
+                                static_cast<const void *>(&__s.value),
+                                sizeof(_Tp));
+                __slot = __e - 1;
+                break;
+            }
+            return !lock.read_retry(__version);
+        }
+
+        /**
+         * @short Mark entry as recently used.
+         */
+        void mark(size_type __slot) const {
+            unsigned char &__ref = slots[__slot].referenced;
+            if (!__atomic_load_n(&__ref, __ATOMIC_RELAXED))
+                __atomic_store_n(&__ref, 1, __ATOMIC_RELAXED);
+        }
+
+        /**
+         * @short Add used slot to index.
+         */
+        void link(size_type __slot) {
+            size_type __i = slots[__slot].hash & mask;
+            while (index[__i]) __i = (__i + 1) & mask;
+            index[__i] = static_cast<uint32_t>(__slot + 1);
+        }
+
+        /**
+         * @short Remove slot from index (backward shift deletion).
+         */
+        void unlink(size_type __slot) {
+            size_type __i = slots[__slot].hash & mask;
+            while (index[__i] != __slot + 1) __i = (__i + 1) & mask;
+            for (size_type __j = (__i + 1) & mask; index[__j];
+                    __j = (__j + 1) & mask)
+            {
+                size_type __home = slots[index[__j] - 1].hash & mask;
+                // move entry j to hole i if its home is not in (i, j]
+                if (((__j - __home) & mask) >= ((__j - __i) & mask)) {
+                    index[__i] = index[__j];
+                    __i = __j;
+                }
+            }
+            index[__i] = 0;
+        }
+
+        /**
+         * @short Remove entry and free memory held by it.
+         */
+        void remove(size_type __slot) {
+            Slot_t &__s = slots[__slot];
+            unlink(__slot);
+            __s.key = _Key();
+            __s.value = _Tp();
+            __s.used = false;
+            __s.referenced = 0;
+            charge -= __s.charge;
+            __s.charge = 0;
+            --used;
+        }
+
+        /**
+         * @short Return some unused slot (there must be one).
+         */
+        size_type free_slot() {
+            while (slots[hand].used) hand = (hand + 1) % capacity;
+            return hand;
+        }
+
+        /**
+         * @short Evict one entry by CLOCK algorithm.
+         * @param __keep slot that must not be evicted.
+         * @return false if there is nothing to evict.
+         */
+        bool evict_one(size_type __keep) {
+            if (!used || ((used == 1) && (__keep != npos)
+                        && slots[__keep].used))
+                return false;
+            for (;;) {
+                Slot_t &__s = slots[hand];
+                if (__s.used && (hand != __keep)) {
+                    if (!__atomic_load_n(&__s.referenced, __ATOMIC_RELAXED))
+                        break;
+                    __s.referenced = 0;
+                }
+                hand = (hand + 1) % capacity;
+            }
+            remove(hand);
+            __atomic_fetch_add(&stats.evictions, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+
+        mutable SeqLock_t lock;             //< segment lock.
+        Slot_t *slots;                      //< entries.
+        uint32_t *index;                    //< hash index (slot + 1).
+        size_type capacity;                 //< count of slots.
+        size_type mask;                     //< index size - 1.
+        size_type used;                     //< count of used slots.
+        size_type hand;                     //< CLOCK hand.
+        size_type charge;                   //< sum of entry charges.
+        mutable Stats_t stats;              //< counters.
+        char __pad[SHALLOCATOR_CACHE_LINE]; //< keep next segment apart.
+    };
+
+    /**
+     * @short Count lookup in slot of this process (in segment if process
+     * has no slot).
+     */
+    void count(const Segment_t &__seg, size_type __slot) const {
+        bool __hit = (__slot != npos);
+        if (Lookups_t *__lookups = lookups.try_local()) {
+            uint64_t &__c = __hit? __lookups->hits: __lookups->misses;
+            __atomic_store_n(&__c, __atomic_load_n(&__c, __ATOMIC_RELAXED) + 1,
+                             __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(__hit? &__seg.stats.hits: &__seg.stats.misses,
+                               1, __ATOMIC_RELAXED);
+        }
+    }
+
+    /**
+     * @short Return segment for hash, high bits are used because low bits
+     * choose position in segment index.
+     */
+    Segment_t &segment(size_type __h) {
+        return segments[(__h >> (sizeof(size_type) * 4)) % _Segments];
+    }
+
+    /**
+     * @short Return segment for hash.
+     */
+    const Segment_t &segment(size_type __h) const {
+        return segments[(__h >> (sizeof(size_type) * 4)) % _Segments];
+    }
+
+    _Hash hash;                             //< hash functor.
+    _Charge charge;                         //< charge functor.
+    size_type max_charge;                   //< max charge of segment.
+    char __pad[SHALLOCATOR_CACHE_LINE];     //< keep first segment apart.
+    Segment_t segments[_Segments];          //< segments.
+    mutable shper_process<Lookups_t> lookups;   //< lookup counters.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHLRU_CACHE_H */
@@ -0,0 +1,179 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory pool in memfd passed between processes.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHMEMFD_H
+#define SHALLOCATOR_SHMEMFD_H
+
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Flags of attach_memfd_pool().
+ */
+enum MemfdFlags_t {
+    MEMFD_READ_ONLY = 1,    //< map pool read only, don't allocate from it.
+    MEMFD_ANY_ADDRESS = 2,  //< map anywhere if creator's address is taken.
+    MEMFD_FROZEN = 4        //< map read only, refuse pool that isn't frozen.
+};
+
+/**
+ * @short Statistics of memfd pool.
+ */
+struct MemfdPoolStats_t {
+    std::size_t capacity;   //< size of pool usable for blocks.
+    std::size_t used;       //< bytes held by live blocks (with headers).
+    std::size_t reserved;   //< bytes ever carved from pool (with headers).
+    std::size_t blocks;     //< count of live blocks.
+    std::size_t ignored_frees;  //< frees of read only or frozen pool
+                                //  blocks ignored by this process.
+};
+
+/**
+ * @short Create shared memory pool in anonymous memfd.
+ *
+ * Unlike libmm pool, memfd pool can be joined by processes that were not
+ * forked from its creator: pass memfd_pool_fd() over unix socket
+ * (send_pool_fd()) and call attach_memfd_pool() in the receiver. Pool is
+ * mapped at the same address in all processes if possible, so objects
+ * with raw pointers (all sh* containers) are valid everywhere; give the
+ * base address explicitly to agree on address free in all processes.
+ *
+ * While the process has a writable memfd pool, shmalloc() takes blocks
+ * from it instead of libmm (blocks of large allocation area excepted);
+ * blocks that don't fit into full pool and all blocks of read only or
+ * frozen pool are allocated from libmm (so libmm pool should exist if
+ * memfd pool may fill up). Libmm blocks are still freed to libmm, frees
+ * of blocks of read only or frozen pool are ignored (and counted, see
+ * memfd_pool_stats()). Pool has simple size class allocator: freed
+ * blocks are reused by blocks of the same class and are never coalesced.
+ * Its bookkeeping is kept by offsets, so allocation works even in pool
+ * mapped at other address.
+ *
+ * @param size size of pool.
+ * @param base address to map pool at (0 lets the kernel choose).
+ * @param name name of memfd (visible in /proc/pid/fd).
+ * @exception std::runtime_error if pool can't be created or process
+ * already has one.
+ */
+void create_memfd_pool(std::size_t size, const void *base = 0,
+                       const char *name = "shallocator");
+
+/**
+ * @short Attach memfd pool received from other process.
+ * @param fd memfd of pool (pool takes the ownership).
+ * @param flags MemfdFlags_t.
+ * @return address the pool is mapped at.
+ * @exception std::runtime_error if fd isn't pool, can't be mapped at
+ * creator's address (without MEMFD_ANY_ADDRESS) or process already has
+ * pool.
+ */
+void *attach_memfd_pool(int fd, int flags = 0);
+
+/**
+ * @short Unmap pool and close its fd. Data stay alive while other
+ * process has the pool mapped.
+ */
+void detach_memfd_pool();
+
+/**
+ * @short Return fd of pool of this process or -1.
+ */
+int memfd_pool_fd();
+
+/**
+ * @short Return address of pool of this process or 0.
+ */
+void *memfd_pool_base();
+
+/**
+ * @short Return true if pool is mapped at the address it was created at,
+ * i.e. raw pointers stored in it are valid in this process.
+ */
+bool memfd_pool_at_origin();
+
+/**
+ * @short Store the root object of pool (entry point for attached
+ * processes).
+ * @param root object in pool or 0.
+ */
+void set_memfd_pool_root(const void *root);
+
+/**
+ * @short Return the root object of pool or 0.
+ */
+void *memfd_pool_root();
+
+/**
+ * @short Seal pool against growing, shrinking and against new writable
+ * mappings (F_SEAL_FUTURE_WRITE, Linux 5.1). Existing writable mappings
+ * work as before, processes attaching later can map the pool read only
+ * only, so read-only consumers can't corrupt it.
+ * @exception std::runtime_error if seals can't be applied.
+ */
+void seal_memfd_pool();
+
+/**
+ * @short Make pool immutable.
+ *
+ * Marks pool frozen for all processes (their allocations go to libmm and
+ * frees of pool blocks are ignored from now), seals it against new
+ * writable mappings and remaps it read only in this process, so every
+ * stray write to pool data gets SIGSEGV. Frozen pool can't be thawed.
+ *
+ * Readers attached by attach_memfd_pool(fd, MEMFD_FROZEN) know that data
+ * never change: they can read shmap, shvector... without any lock, they
+ * never call libmm and never allocate from the pool.
+ *
+ * @exception std::runtime_error if there is no pool or it can't be
+ * protected.
+ * @exception std::logic_error if pool is read only or frozen already.
+ */
+void freeze_memfd_pool();
+
+/**
+ * @short Return true if pool of this process is frozen.
+ */
+bool memfd_pool_frozen();
+
+/**
+ * @short Return statistics of memfd pool (zeros if there is none).
+ */
+MemfdPoolStats_t memfd_pool_stats();
+
+/**
+ * @short Send fd over connected unix socket (SCM_RIGHTS).
+ * @param socket unix socket.
+ * @param fd sent fd (stays open in sender).
+ * @exception std::runtime_error if sending fails.
+ */
+void send_pool_fd(int socket, int fd);
+
+/**
+ * @short Receive fd sent by send_pool_fd().
+ * @param socket unix socket.
+ * @return received fd.
+ * @exception std::runtime_error if no fd was received.
+ */
+int receive_pool_fd(int socket);
+
+}
+
+#endif /* SHALLOCATOR_SHMEMFD_H */
+
@@ -15,11 +15,15 @@
  * HISTORY
  *       2007-06-12 (bukovsky)
  *                  Stolen from GNU stdc++ STL.
+ *       2026-10-19 (bukovsky)
+ *                  Added shunique_ptr, shshared_ptr and shweak_ptr.
  */
 
 #ifndef SHALLOCATOR_SHMEMORY_H
 #define SHALLOCATOR_SHMEMORY_H
 
+#include <cstddef>
+#include <utility>
 #include <shallocator/shalloc.h>
 
 namespace SHAllocator {
@@ -271,6 +275,468 @@ namespace SHAllocator {
         { return shauto_ptr<_Tp1>(this->release()); }
   };
 
+#if __cplusplus >= 201103L
+
+  /**
+   *  @brief  A move-only smart pointer owning object in shared memory.
+   *
+   *  Object must be allocated by new (SHAlloc), it is deleted by
+   *  SHAllocator::destroy.  Unlike %shauto_ptr it can be stored in
+   *  containers.
+   */
+  template<typename _Tp>
+    class shunique_ptr
+    {
+    private:
+      _Tp* _M_ptr;
+
+    public:
+      /// The pointed-to type.
+      typedef _Tp element_type;
+
+      /// Construct empty pointer.
+      constexpr shunique_ptr() noexcept : _M_ptr(0) { }
+
+      /// Construct empty pointer.
+      constexpr shunique_ptr(std::nullptr_t) noexcept : _M_ptr(0) { }
+
+      /// Take ownership of object allocated by new (SHAlloc).
+      explicit
+      shunique_ptr(element_type* __p) noexcept : _M_ptr(__p) { }
+
+      /// Move constructor, @a __u gives up ownership.
+      shunique_ptr(shunique_ptr&& __u) noexcept : _M_ptr(__u.release()) { }
+
+      /// Destroy owned object.
+      ~shunique_ptr() { SHAllocator::destroy(_M_ptr); }
+
+      /// Move assignment, previously owned object is destroyed.
+      shunique_ptr&
+      operator=(shunique_ptr&& __u) noexcept
+      {
+        reset(__u.release());
+        return *this;
+      }
+
+      /// Destroy owned object.
+      shunique_ptr&
+      operator=(std::nullptr_t) noexcept
+      {
+        reset();
+        return *this;
+      }
+
+      shunique_ptr(const shunique_ptr&) = delete;
+      shunique_ptr& operator=(const shunique_ptr&) = delete;
+
+      element_type&
+      operator*() const { return *_M_ptr; }
+
+      element_type*
+      operator->() const noexcept { return _M_ptr; }
+
+      /// Return raw pointer, object is still owned.
+      element_type*
+      get() const noexcept { return _M_ptr; }
+
+      explicit
+      operator bool() const noexcept { return _M_ptr != 0; }
+
+      /// Give up ownership and return raw pointer.
+      element_type*
+      release() noexcept
+      {
+        element_type* __tmp = _M_ptr;
+        _M_ptr = 0;
+        return __tmp;
+      }
+
+      /// Destroy owned object and take ownership of @a __p.
+      void
+      reset(element_type* __p = 0) noexcept
+      {
+        element_type* __old = _M_ptr;
+        _M_ptr = __p;
+        if (__old != __p)
+          SHAllocator::destroy(__old);
+      }
+
+      void
+      swap(shunique_ptr& __u) noexcept { std::swap(_M_ptr, __u._M_ptr); }
+    };
+
+  template<typename _Tp>
+    inline bool
+    operator==(const shunique_ptr<_Tp>& __a, const shunique_ptr<_Tp>& __b)
+    { return __a.get() == __b.get(); }
+
+  template<typename _Tp>
+    inline bool
+    operator!=(const shunique_ptr<_Tp>& __a, const shunique_ptr<_Tp>& __b)
+    { return __a.get() != __b.get(); }
+
+  /**
+   *  @brief  Create object in shared memory owned by %shunique_ptr.
+   */
+  template<typename _Tp, typename... _Args>
+    inline shunique_ptr<_Tp>
+    shmake_unique(_Args&&... __args)
+    {
+      return shunique_ptr<_Tp>(
+          new (SHAlloc) _Tp(std::forward<_Args>(__args)...));
+    }
+
+  /**
+   *  Control block of %shshared_ptr.  It lives in shared memory, so
+   *  reference counts are seen by all processes and the last one who
+   *  drops reference frees the object.  Weak count holds one extra
+   *  reference for all shared owners together.
+   */
+  struct shshared_count
+    {
+      int _M_use;       //< count of shshared_ptr owners.
+      int _M_weak;      //< count of shweak_ptr + 1 while _M_use > 0.
+      bool _M_inplace;  //< object is in the same block (shmake_shared).
+
+      explicit
+      shshared_count(bool __inplace)
+      : _M_use(1), _M_weak(1), _M_inplace(__inplace) { }
+
+      void
+      _M_add_ref() noexcept
+      { __atomic_fetch_add(&_M_use, 1, __ATOMIC_RELAXED); }
+
+      void
+      _M_weak_add_ref() noexcept
+      { __atomic_fetch_add(&_M_weak, 1, __ATOMIC_RELAXED); }
+
+      /// Take shared reference if object is still alive.
+      bool
+      _M_add_ref_lock() noexcept
+      {
+        int __count = __atomic_load_n(&_M_use, __ATOMIC_RELAXED);
+        while (__count)
+          if (__atomic_compare_exchange_n(&_M_use, &__count, __count + 1,
+                                          true, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED))
+            return true;
+        return false;
+      }
+
+      /// Drop shared reference, return true if it was the last one.
+      bool
+      _M_release() noexcept
+      { return __atomic_sub_fetch(&_M_use, 1, __ATOMIC_ACQ_REL) == 0; }
+
+      /// Drop weak reference, return true if it was the last one.
+      bool
+      _M_weak_release() noexcept
+      { return __atomic_sub_fetch(&_M_weak, 1, __ATOMIC_ACQ_REL) == 0; }
+
+      long
+      _M_get_use_count() const noexcept
+      { return __atomic_load_n(&_M_use, __ATOMIC_RELAXED); }
+    };
+
+  /**
+   *  Control block with object in one allocation (shmake_shared).
+   */
+  template<typename _Tp>
+    struct shshared_block
+    {
+      shshared_count _M_count;
+      alignas(_Tp) unsigned char _M_storage[sizeof(_Tp)];
+
+      _Tp*
+      _M_ptr() noexcept { return reinterpret_cast<_Tp*>(_M_storage); }
+    };
+
+  template<typename _Tp> class shweak_ptr;
+
+  /**
+   *  @brief  A smart pointer with reference-counted ownership of object
+   *  in shared memory.
+   *
+   *  The control block is allocated in shared memory too and counted by
+   *  atomic operations, so %shshared_ptr can be copied between processes
+   *  (e.g. stored in shared containers) and the process dropping the
+   *  last reference deletes the object, no extra lock is needed.
+   *
+   *  Object is deleted as _Tp, there are no conversions between pointers
+   *  to different types.  Use shmake_shared() to allocate object and
+   *  control block in one block.
+   */
+  template<typename _Tp>
+    class shshared_ptr
+    {
+    public:
+      /// The pointed-to type.
+      typedef _Tp element_type;
+
+      /// Construct empty pointer.
+      constexpr shshared_ptr() noexcept : _M_ptr(0), _M_refcount(0) { }
+
+      /// Construct empty pointer.
+      constexpr shshared_ptr(std::nullptr_t) noexcept
+      : _M_ptr(0), _M_refcount(0) { }
+
+      /**
+       *  @brief  Take ownership of object allocated by new (SHAlloc).
+       *
+       *  If the control block can't be allocated, object is destroyed
+       *  and std::bad_alloc is thrown.
+       */
+      explicit
+      shshared_ptr(element_type* __p)
+      : _M_ptr(__p), _M_refcount(0)
+      {
+        if (!__p)
+          return;
+        try
+          {
+            _M_refcount = new (SHAlloc) shshared_count(false);
+          }
+        catch(...)
+          {
+            SHAllocator::destroy(__p);
+            throw;
+          }
+      }
+
+      shshared_ptr(const shshared_ptr& __r) noexcept
+      : _M_ptr(__r._M_ptr), _M_refcount(__r._M_refcount)
+      {
+        if (_M_refcount)
+          _M_refcount->_M_add_ref();
+      }
+
+      shshared_ptr(shshared_ptr&& __r) noexcept
+      : _M_ptr(__r._M_ptr), _M_refcount(__r._M_refcount)
+      {
+        __r._M_ptr = 0;
+        __r._M_refcount = 0;
+      }
+
+      ~shshared_ptr() { _M_release(); }
+
+      shshared_ptr&
+      operator=(const shshared_ptr& __r) noexcept
+      {
+        shshared_ptr(__r).swap(*this);
+        return *this;
+      }
+
+      shshared_ptr&
+      operator=(shshared_ptr&& __r) noexcept
+      {
+        shshared_ptr(std::move(__r)).swap(*this);
+        return *this;
+      }
+
+      /// Drop reference.
+      void
+      reset() noexcept { shshared_ptr().swap(*this); }
+
+      /// Drop reference and take ownership of @a __p.
+      void
+      reset(element_type* __p) { shshared_ptr(__p).swap(*this); }
+
+      element_type&
+      operator*() const noexcept { return *_M_ptr; }
+
+      element_type*
+      operator->() const noexcept { return _M_ptr; }
+
+      element_type*
+      get() const noexcept { return _M_ptr; }
+
+      explicit
+      operator bool() const noexcept { return _M_ptr != 0; }
+
+      /// Return count of owners (only a hint when more processes share it).
+      long
+      use_count() const noexcept
+      { return _M_refcount? _M_refcount->_M_get_use_count(): 0; }
+
+      bool
+      unique() const noexcept { return use_count() == 1; }
+
+      void
+      swap(shshared_ptr& __other) noexcept
+      {
+        std::swap(_M_ptr, __other._M_ptr);
+        std::swap(_M_refcount, __other._M_refcount);
+      }
+
+    private:
+      template<typename _Tp1> friend class shweak_ptr;
+      template<typename _Tp1, typename... _Args>
+        friend shshared_ptr<_Tp1> shmake_shared(_Args&&...);
+
+      /// Take ownership of existing reference.
+      shshared_ptr(element_type* __p, shshared_count* __c) noexcept
+      : _M_ptr(__p), _M_refcount(__c) { }
+
+      void
+      _M_release() noexcept
+      {
+        if (!_M_refcount || !_M_refcount->_M_release())
+          return;
+
+        // last owner destroys object
+        if (_M_refcount->_M_inplace)
+          _M_ptr->~_Tp();
+        else
+          SHAllocator::destroy(_M_ptr);
+        _M_weak_release(_M_refcount);
+      }
+
+      /// Drop weak reference, free control block if it was the last one.
+      static void
+      _M_weak_release(shshared_count* __c) noexcept
+      {
+        if (!__c->_M_weak_release())
+          return;
+        if (__c->_M_inplace)
+          SHAllocator::shfree_aligned(__c, alignof(shshared_block<_Tp>));
+        else
+          SHAllocator::destroy(__c);
+      }
+
+      element_type*   _M_ptr;
+      shshared_count* _M_refcount;
+    };
+
+  template<typename _Tp>
+    inline bool
+    operator==(const shshared_ptr<_Tp>& __a, const shshared_ptr<_Tp>& __b)
+    { return __a.get() == __b.get(); }
+
+  template<typename _Tp>
+    inline bool
+    operator!=(const shshared_ptr<_Tp>& __a, const shshared_ptr<_Tp>& __b)
+    { return __a.get() != __b.get(); }
+
+  /**
+   *  @brief  Create object and its control block in one shared memory
+   *  allocation.
+   */
+  template<typename _Tp, typename... _Args>
+    inline shshared_ptr<_Tp>
+    shmake_shared(_Args&&... __args)
+    {
+      typedef shshared_block<_Tp> _Block;
+      void* __mem = SHAllocator::shmalloc_aligned(sizeof(_Block),
+                                                  alignof(_Block));
+      if (!__mem)
+        throw std::bad_alloc();
+      _Block* __block = static_cast<_Block*>(__mem);
+      try
+        {
+          ::new (__block->_M_storage) _Tp(std::forward<_Args>(__args)...);
+        }
+      catch(...)
+        {
+          SHAllocator::shfree_aligned(__mem, alignof(_Block));
+          throw;
+        }
+      ::new (&__block->_M_count) shshared_count(true);
+      return shshared_ptr<_Tp>(__block->_M_ptr(), &__block->_M_count);
+    }
+
+  /**
+   *  @brief  A non-owning observer of object owned by %shshared_ptr.
+   */
+  template<typename _Tp>
+    class shweak_ptr
+    {
+    public:
+      /// The pointed-to type.
+      typedef _Tp element_type;
+
+      constexpr shweak_ptr() noexcept : _M_ptr(0), _M_refcount(0) { }
+
+      shweak_ptr(const shshared_ptr<_Tp>& __r) noexcept
+      : _M_ptr(__r._M_ptr), _M_refcount(__r._M_refcount)
+      {
+        if (_M_refcount)
+          _M_refcount->_M_weak_add_ref();
+      }
+
+      shweak_ptr(const shweak_ptr& __r) noexcept
+      : _M_ptr(__r._M_ptr), _M_refcount(__r._M_refcount)
+      {
+        if (_M_refcount)
+          _M_refcount->_M_weak_add_ref();
+      }
+
+      shweak_ptr(shweak_ptr&& __r) noexcept
+      : _M_ptr(__r._M_ptr), _M_refcount(__r._M_refcount)
+      {
+        __r._M_ptr = 0;
+        __r._M_refcount = 0;
+      }
+
+      ~shweak_ptr()
+      {
+        if (_M_refcount)
+          shshared_ptr<_Tp>::_M_weak_release(_M_refcount);
+      }
+
+      shweak_ptr&
+      operator=(const shweak_ptr& __r) noexcept
+      {
+        shweak_ptr(__r).swap(*this);
+        return *this;
+      }
+
+      shweak_ptr&
+      operator=(shweak_ptr&& __r) noexcept
+      {
+        shweak_ptr(std::move(__r)).swap(*this);
+        return *this;
+      }
+
+      shweak_ptr&
+      operator=(const shshared_ptr<_Tp>& __r) noexcept
+      {
+        shweak_ptr(__r).swap(*this);
+        return *this;
+      }
+
+      /// Return owning pointer or empty one if object has been deleted.
+      shshared_ptr<_Tp>
+      lock() const noexcept
+      {
+        if (_M_refcount && _M_refcount->_M_add_ref_lock())
+          return shshared_ptr<_Tp>(_M_ptr, _M_refcount);
+        return shshared_ptr<_Tp>();
+      }
+
+      long
+      use_count() const noexcept
+      { return _M_refcount? _M_refcount->_M_get_use_count(): 0; }
+
+      bool
+      expired() const noexcept { return use_count() == 0; }
+
+      void
+      reset() noexcept { shweak_ptr().swap(*this); }
+
+      void
+      swap(shweak_ptr& __other) noexcept
+      {
+        std::swap(_M_ptr, __other._M_ptr);
+        std::swap(_M_refcount, __other._M_refcount);
+      }
+
+    private:
+      element_type*   _M_ptr;
+      shshared_count* _M_refcount;
+    };
+
+#endif
+
 }
 
 #endif /* SHALLOCATOR_SHMEMORY_H */
@@ -0,0 +1,486 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Lock-free shared metrics registry.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHMETRICS_H
+#define SHALLOCATOR_SHMETRICS_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shmutex.h>
+#include <shallocator/shper_process.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Metric types.
+ */
+enum MetricType_t {
+    METRIC_COUNTER,     //< monotonic counter.
+    METRIC_GAUGE,       //< value that goes up and down.
+    METRIC_HISTOGRAM    //< distribution in fixed buckets.
+};
+
+/// max length of metric name (with terminating zero)
+const unsigned METRIC_NAME_SIZE = 64;
+
+/// max count of histogram buckets (without +Inf bucket)
+const unsigned METRIC_MAX_BUCKETS = 16;
+
+/**
+ * @short Snapshot of one metric (in memory of the reader).
+ */
+struct MetricSample_t {
+    std::string name;               //< metric name.
+    MetricType_t type;              //< metric type.
+    int64_t value;                  //< counter or gauge value.
+    std::vector<double> bounds;     //< upper bounds of buckets.
+    std::vector<uint64_t> counts;   //< observations per bucket (+Inf last).
+    uint64_t count;                 //< count of observations.
+    double sum;                     //< sum of observations.
+};
+
+/**
+ * @short Registry of named counters, gauges and histograms shared by
+ * processes.
+ *
+ * Each process updates counters and histograms in its own cache line
+ * padded shard (see shper_process) by relaxed atomic load/store, there is
+ * no lock and no locked instruction on update path. Reader sums shards
+ * without lock, so snapshot is consistent per value, not across values.
+ * Shards of exited processes keep their values (counters don't go back);
+ * their slots are taken over by new processes (see
+ * shper_process::try_local()). Processes that find no free slot update
+ * common shard by locked instructions instead, so updates never throw.
+ * Gauges live in common shard only, so value of exited process is not
+ * inherited by the next owner of its slot.
+ *
+ * Registration takes lock and is expected at startup; keep handles.
+ * Registry must be created (new (SHAlloc)) before fork.
+ *
+ * @param _Values max count of values (counter and gauge take one,
+ *        histogram takes buckets + 3).
+ * @param _Processes max count of processes updating metrics.
+ */
+template <std::size_t _Values = 512, std::size_t _Processes = 64>
+class shmetrics {
+    /**
+     * @short Values of one process.
+     */
+    struct Shard_t {
+        Shard_t() { std::memset(values, 0, sizeof(values));}
+        uint64_t values[_Values];   //< values.
+    };
+
+    /**
+     * @short Descriptor of metric.
+     */
+    struct Info_t {
+        char name[METRIC_NAME_SIZE];        //< name.
+        MetricType_t type;                  //< type.
+        unsigned first;                     //< index of first value.
+        unsigned buckets;                   //< count of bounds.
+        double bounds[METRIC_MAX_BUCKETS];  //< upper bounds of buckets.
+    };
+
+public:
+    /**
+     * @short Handle of counter.
+     */
+    class Counter_t {
+    public:
+        Counter_t(): metrics(0), index(0) {}
+
+        /**
+         * @short Increment counter.
+         * @param __n increment.
+         */
+        void inc(uint64_t __n = 1) const { metrics->add(index, __n);}
+
+    private:
+        Counter_t(shmetrics *__metrics, unsigned __index)
+            : metrics(__metrics), index(__index) {}
+        friend class shmetrics;
+
+        shmetrics *metrics;     //< registry.
+        unsigned index;         //< value index.
+    };
+
+    /**
+     * @short Handle of gauge. Gauge is one value shared by all processes
+     * updated by locked instructions.
+     */
+    class Gauge_t {
+    public:
+        Gauge_t(): metrics(0), index(0) {}
+
+        /**
+         * @short Set value.
+         * @param __value value.
+         */
+        void set(int64_t __value) const {
+            __atomic_store_n(&metrics->common.values[index],
+                             static_cast<uint64_t>(__value), __ATOMIC_RELAXED);
+        }
+
+        /**
+         * @short Add to value.
+         * @param __n increment (may be negative).
+         */
+        void add(int64_t __n) const {
+            bump(metrics->common.values[index], static_cast<uint64_t>(__n),
+                 true);
+        }
+
+    private:
+        Gauge_t(shmetrics *__metrics, unsigned __index)
+            : metrics(__metrics), index(__index) {}
+        friend class shmetrics;
+
+        shmetrics *metrics;     //< registry.
+        unsigned index;         //< value index.
+    };
+
+    /**
+     * @short Handle of histogram.
+     */
+    class Histogram_t {
+    public:
+        Histogram_t(): metrics(0), index(0) {}
+
+        /**
+         * @short Record one observation.
+         * @param __value observed value (e.g. latency).
+         */
+        void observe(double __value) const {
+            const Info_t &__info = metrics->metrics[index];
+            unsigned __b = 0;
+            while ((__b < __info.buckets) && (__value > __info.bounds[__b]))
+                ++__b;
+            Shard_t *__shard = metrics->shards.try_local();
+            bool __shared = !__shard;
+            if (__shared) __shard = &metrics->common;
+            unsigned __first = __info.first;
+            bump(__shard->values[__first + __b], 1, __shared);
+            bump(__shard->values[__first + __info.buckets + 1], 1, __shared);
+
+            // sum is double stored in value bits
+            uint64_t &__bits = __shard->values[__first + __info.buckets + 2];
+            uint64_t __old = __atomic_load_n(&__bits, __ATOMIC_RELAXED);
+            for (;;) {
+                double __sum;
+                std::memcpy(&__sum, &__old, sizeof(__sum));
+                __sum += __value;
+                uint64_t __new;
+                std::memcpy(&__new, &__sum, sizeof(__sum));
+                if (!__shared) {
+                    __atomic_store_n(&__bits, __new, __ATOMIC_RELAXED);
+                    break;
+                }
+                if (__atomic_compare_exchange_n(&__bits, &__old, __new, false,
+                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                    break;
+            }
+        }
+
+    private:
+        Histogram_t(shmetrics *__metrics, unsigned __index)
+            : metrics(__metrics), index(__index) {}
+        friend class shmetrics;
+
+        shmetrics *metrics;     //< registry.
+        unsigned index;         //< metric index.
+    };
+
+    /**
+     * @short Create empty registry.
+     */
+    shmetrics(): count(0), used(0) {}
+
+    /**
+     * @short Return counter of name, register it if needed.
+     * @param __name name.
+     * @return handle.
+     */
+    Counter_t counter(const char *__name) {
+        return Counter_t(this, metrics[lookup(__name, METRIC_COUNTER, 0, 0)]
+                                   .first);
+    }
+
+    /**
+     * @short Return gauge of name, register it if needed.
+     * @param __name name.
+     * @return handle.
+     */
+    Gauge_t gauge(const char *__name) {
+        return Gauge_t(this, metrics[lookup(__name, METRIC_GAUGE, 0, 0)]
+                                 .first);
+    }
+
+    /**
+     * @short Return histogram of name, register it if needed.
+     * @param __name name.
+     * @param __bounds sorted upper bounds of buckets.
+     * @param __buckets count of bounds.
+     * @return handle.
+     */
+    Histogram_t histogram(const char *__name, const double *__bounds,
+                          unsigned __buckets)
+    {
+        return Histogram_t(this, lookup(__name, METRIC_HISTOGRAM, __bounds,
+                                        __buckets));
+    }
+
+    /**
+     * @short Sum shards of all processes.
+     * @return samples of all metrics.
+     */
+    std::vector<MetricSample_t> snapshot() const {
+        unsigned __count = __atomic_load_n(&count, __ATOMIC_ACQUIRE);
+        unsigned __used = __atomic_load_n(&used, __ATOMIC_ACQUIRE);
+        Summer_t __summer(__used);
+        for (unsigned __i = 0; __i < __count; ++__i)
+            if (metrics[__i].type == METRIC_HISTOGRAM)
+                __summer.real[metrics[__i].first + metrics[__i].buckets + 2]
+                    = true;
+        __summer = shards.for_each(__summer);
+        __summer(0, common);
+
+        std::vector<MetricSample_t> __samples(__count);
+        for (unsigned __i = 0; __i < __count; ++__i) {
+            const Info_t &__info = metrics[__i];
+            MetricSample_t &__sample = __samples[__i];
+            const uint64_t *__v = &__summer.totals[__info.first];
+            __sample.name = __info.name;
+            __sample.type = __info.type;
+            __sample.value = static_cast<int64_t>(__v[0]);
+            __sample.count = 0;
+            __sample.sum = 0;
+            if (__info.type != METRIC_HISTOGRAM) continue;
+            __sample.value = 0;
+            __sample.bounds.assign(__info.bounds,
+                                   __info.bounds + __info.buckets);
+            __sample.counts.assign(__v, __v + __info.buckets + 1);
+            __sample.count = __v[__info.buckets + 1];
+            __sample.sum = __summer.sums[__info.first + __info.buckets + 2];
+        }
+        return __samples;
+    }
+
+    /**
+     * @short Write snapshot in Prometheus text format.
+     * @param __os output stream.
+     */
+    void write_text(std::ostream &__os) const {
+        std::vector<MetricSample_t> __samples = snapshot();
+        for (std::size_t __i = 0; __i < __samples.size(); ++__i) {
+            const MetricSample_t &__s = __samples[__i];
+            switch (__s.type) {
+            case METRIC_COUNTER:
+                __os << "# TYPE " << __s.name << " counter\n"
+                     << __s.name << ' ' << __s.value << '\n';
+                break;
+            case METRIC_GAUGE:
+                __os << "# TYPE " << __s.name << " gauge\n"
+                     << __s.name << ' ' << __s.value << '\n';
+                break;
+            case METRIC_HISTOGRAM:
+                __os << "# TYPE " << __s.name << " histogram\n";
+                uint64_t __cumulative = 0;
+                for (std::size_t __b = 0; __b < __s.counts.size(); ++__b) {
+                    __cumulative += __s.counts[__b];
+                    __os << __s.name << "_bucket{le=\"";
+                    if (__b < __s.bounds.size()) __os << __s.bounds[__b];
+                    else __os << "+Inf";
+                    __os << "\"} " << __cumulative << '\n';
+                }
+                __os << __s.name << "_sum " << __s.sum << '\n'
+                     << __s.name << "_count " << __s.count << '\n';
+                break;
+            }
+        }
+    }
+
+    /**
+     * @short Release shards of processes that don't exist any more (their
+     * values are still counted).
+     * @return count of released shards.
+     */
+    std::size_t reclaim() { return shards.reclaim();}
+
+    /**
+     * @short Publish statistics of shmalloc()/shfree() of this process
+     * (and processes forked later) through this registry: counters
+     * shallocator_allocs, shallocator_frees, shallocator_alloc_failures,
+     * shallocator_alloc_bytes and shallocator_alloc_size histogram.
+     */
+    void publish_allocator_stats() {
+        static const double __bounds[] = {
+            64, 256, 1024, 4096, 16384, 65536, 262144, 1048576
+        };
+        allocs = counter("shallocator_allocs");
+        frees = counter("shallocator_frees");
+        failures = counter("shallocator_alloc_failures");
+        alloc_bytes = counter("shallocator_alloc_bytes");
+        alloc_size = histogram("shallocator_alloc_size", __bounds,
+                               sizeof(__bounds) / sizeof(*__bounds));
+        published = this;
+        SHAllocHook = alloc_hook;
+    }
+
+    /**
+     * @short Stop publishing statistics of allocator in this process.
+     */
+    static void unpublish_allocator_stats() {
+        if (SHAllocHook == alloc_hook) SHAllocHook = 0;
+        published = 0;
+    }
+
+private:
+    shmetrics(const shmetrics &);
+    shmetrics &operator=(const shmetrics &);
+
+    /**
+     * @short Sums values of shards.
+     */
+    struct Summer_t {
+        explicit Summer_t(unsigned __used)
+            : totals(__used), sums(__used), real(__used)
+        {}
+
+        void operator()(pid_t, const Shard_t &__shard) {
+            for (std::size_t __i = 0; __i < totals.size(); ++__i) {
+                uint64_t __v = __atomic_load_n(&__shard.values[__i],
+                                               __ATOMIC_RELAXED);
+                if (real[__i]) {
+                    double __d;
+                    std::memcpy(&__d, &__v, sizeof(__d));
+                    sums[__i] += __d;
+                } else totals[__i] += __v;
+            }
+        }
+
+        std::vector<uint64_t> totals;   //< sums of integer values.
+        std::vector<double> sums;       //< sums of real values.
+        std::vector<bool> real;         //< value holds double bits.
+    };
+
+    /**
+     * @short Increase value by owner of shard (by everybody if shard is
+     * shared).
+     */
+    static void bump(uint64_t &__value, uint64_t __n, bool __shared) {
+        if (__shared)
+            __atomic_fetch_add(&__value, __n, __ATOMIC_RELAXED);
+        else
+            __atomic_store_n(&__value,
+                             __atomic_load_n(&__value, __ATOMIC_RELAXED) + __n,
+                             __ATOMIC_RELAXED);
+    }
+
+    void add(unsigned __index, uint64_t __n) {
+        Shard_t *__shard = shards.try_local();
+        if (__shard) bump(__shard->values[__index], __n, false);
+        else bump(common.values[__index], __n, true);
+    }
+
+    /**
+     * @short Find metric or register new one.
+     * @return index of metric.
+     */
+    unsigned lookup(const char *__name, MetricType_t __type,
+                    const double *__bounds, unsigned __buckets)
+    {
+        if (std::strlen(__name) >= METRIC_NAME_SIZE)
+            throw std::length_error("shmetrics: name is too long");
+        if (__buckets > METRIC_MAX_BUCKETS)
+            throw std::length_error("shmetrics: too many buckets");
+
+        ScopedLock_t<Mutex_t> __lock(mutex);
+        for (unsigned __i = 0; __i < count; ++__i) {
+            if (std::strcmp(metrics[__i].name, __name)) continue;
+            if (metrics[__i].type != __type)
+                throw std::invalid_argument("shmetrics: metric of other type "
+                                            "has the same name");
+            return __i;
+        }
+
+        unsigned __values = (__type == METRIC_HISTOGRAM)? __buckets + 3: 1;
+        if ((count == _Values) || (used + __values > _Values))
+            throw std::length_error("shmetrics: registry is full");
+        Info_t &__info = metrics[count];
+        std::strcpy(__info.name, __name);
+        __info.type = __type;
+        __info.first = used;
+        __info.buckets = __buckets;
+        for (unsigned __b = 0; __b < __buckets; ++__b)
+            __info.bounds[__b] = __bounds[__b];
+        __atomic_store_n(&used, used + __values, __ATOMIC_RELEASE);
+        __atomic_store_n(&count, count + 1, __ATOMIC_RELEASE);
+        return count - 1;
+    }
+
+    /**
+     * @short Allocation hook publishing allocator statistics.
+     */
+    static void alloc_hook(AllocEvent_t __event, void *, std::size_t __size) {
+        shmetrics *__m = published;
+        if (!__m) return;
+        switch (__event) {
+        case ALLOC_EVENT_ALLOC:
+            __m->allocs.inc();
+            __m->alloc_bytes.inc(__size);
+            __m->alloc_size.observe(static_cast<double>(__size));
+            break;
+        case ALLOC_EVENT_FREE:
+            __m->frees.inc();
+            break;
+        case ALLOC_EVENT_FAIL:
+            __m->failures.inc();
+            break;
+        }
+    }
+
+    /// registry published by alloc_hook in this process
+    static shmetrics *published;
+
+    Mutex_t mutex;                          //< registration lock.
+    unsigned count;                         //< count of metrics.
+    unsigned used;                          //< count of used values.
+    Counter_t allocs;                       //< allocator: allocations.
+    Counter_t frees;                        //< allocator: frees.
+    Counter_t failures;                     //< allocator: failed allocs.
+    Counter_t alloc_bytes;                  //< allocator: allocated bytes.
+    Histogram_t alloc_size;                 //< allocator: block sizes.
+    Info_t metrics[_Values];                //< metric descriptors.
+    shper_process<Shard_t, _Processes> shards;  //< values of processes.
+    Shard_t common;                         //< gauges and values of
+                                            //  processes without slot.
+};
+
+template <std::size_t _Values, std::size_t _Processes>
+shmetrics<_Values, _Processes> *shmetrics<_Values, _Processes>::published = 0;
+
+}
+
+#endif /* SHALLOCATOR_SHMETRICS_H */
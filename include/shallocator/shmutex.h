@@ -0,0 +1,192 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Process shared locks.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHMUTEX_H
+#define SHALLOCATOR_SHMUTEX_H
+
+#include <pthread.h>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Mutex usable from all processes sharing the memory segment.
+ *
+ * Object must live in shared memory (allocate it by new (SHAlloc) or embed
+ * it in other shared object) and must be created before fork.
+ */
+class Mutex_t {
+public:
+    /**
+     * @short Create process shared mutex.
+     */
+    Mutex_t() {
+        pthread_mutexattr_t attr;
+        if (pthread_mutexattr_init(&attr))
+            throw std::runtime_error("Mutex_t: can't init mutex attributes");
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        int err = pthread_mutex_init(&mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        if (err)
+            throw std::runtime_error("Mutex_t: can't init mutex");
+    }
+
+    /**
+     * @short Destroy mutex.
+     */
+    ~Mutex_t() { pthread_mutex_destroy(&mutex);}
+
+    /**
+     * @short Lock mutex, wait if it is locked by somebody else.
+     */
+    void lock() { pthread_mutex_lock(&mutex);}
+
+    /**
+     * @short Lock mutex if it is not locked.
+     * @return true if mutex has been locked.
+     */
+    bool try_lock() { return !pthread_mutex_trylock(&mutex);}
+
+    /**
+     * @short Unlock mutex.
+     */
+    void unlock() { pthread_mutex_unlock(&mutex);}
+
+    /**
+     * @short Return native handle (e.g. for condition variables).
+     * @return pthread mutex.
+     */
+    pthread_mutex_t *native() { return &mutex;}
+
+private:
+    Mutex_t(const Mutex_t &);
+    Mutex_t &operator=(const Mutex_t &);
+
+    pthread_mutex_t mutex;  //< pthread mutex.
+};
+
+/**
+ * @short Read/write lock usable from all processes sharing the segment.
+ */
+class RWLock_t {
+public:
+    /**
+     * @short Create process shared read/write lock.
+     */
+    RWLock_t() {
+        pthread_rwlockattr_t attr;
+        if (pthread_rwlockattr_init(&attr))
+            throw std::runtime_error("RWLock_t: can't init lock attributes");
+        pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        int err = pthread_rwlock_init(&rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+        if (err)
+            throw std::runtime_error("RWLock_t: can't init lock");
+    }
+
+    /**
+     * @short Destroy lock.
+     */
+    ~RWLock_t() { pthread_rwlock_destroy(&rwlock);}
+
+    /**
+     * @short Lock for reading, more readers can hold lock at once.
+     */
+    void lock_shared() { pthread_rwlock_rdlock(&rwlock);}
+
+    /**
+     * @short Lock for writing.
+     */
+    void lock() { pthread_rwlock_wrlock(&rwlock);}
+
+    /**
+     * @short Lock for writing if it is not locked.
+     * @return true if lock has been acquired.
+     */
+    bool try_lock() { return !pthread_rwlock_trywrlock(&rwlock);}
+
+    /**
+     * @short Unlock read or write lock.
+     */
+    void unlock() { pthread_rwlock_unlock(&rwlock);}
+
+    /**
+     * @short Unlock read lock.
+     */
+    void unlock_shared() { pthread_rwlock_unlock(&rwlock);}
+
+private:
+    RWLock_t(const RWLock_t &);
+    RWLock_t &operator=(const RWLock_t &);
+
+    pthread_rwlock_t rwlock;    //< pthread read/write lock.
+};
+
+/**
+ * @short Hold exclusive lock while in scope.
+ */
+template <typename _Mutex>
+class ScopedLock_t {
+public:
+    /**
+     * @short Lock mutex.
+     * @param __m mutex.
+     */
+    explicit ScopedLock_t(_Mutex &__m): m(__m) { m.lock();}
+
+    /**
+     * @short Unlock mutex.
+     */
+    ~ScopedLock_t() { m.unlock();}
+
+private:
+    ScopedLock_t(const ScopedLock_t &);
+    ScopedLock_t &operator=(const ScopedLock_t &);
+
+    _Mutex &m;  //< held mutex.
+};
+
+/**
+ * @short Hold shared (read) lock while in scope.
+ */
+template <typename _Mutex>
+class SharedLock_t {
+public:
+    /**
+     * @short Lock mutex for reading.
+     * @param __m mutex.
+     */
+    explicit SharedLock_t(_Mutex &__m): m(__m) { m.lock_shared();}
+
+    /**
+     * @short Unlock mutex.
+     */
+    ~SharedLock_t() { m.unlock_shared();}
+
+private:
+    SharedLock_t(const SharedLock_t &);
+    SharedLock_t &operator=(const SharedLock_t &);
+
+    _Mutex &m;  //< held mutex.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHMUTEX_H */
@@ -0,0 +1,100 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Compressed 32-bit offsets of shared memory blocks.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHOFFSET_H
+#define SHALLOCATOR_SHOFFSET_H
+
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/// offsets count in units of this many bytes (blocks are aligned to it)
+const unsigned OFFSET_SHIFT = 3;
+
+/// max offset, the highest bit is free for flags of the user
+const uint32_t OFFSET_LIMIT = 0x7fffffff;
+
+/**
+ * @short Base of offsets of this process (inherited by fork).
+ */
+extern char *SHOffsetBase;
+
+/**
+ * @short Set base of offsets. Blocks from offset_allocate() must lie in
+ * [base, base + 16GB). Call it after MM_create() and before fork.
+ * @param base base address, 0 means to derive it from address of the pool
+ *        (pool is expected to lie within 8GB from its first block).
+ */
+void set_offset_base(const void *base = 0);
+
+/**
+ * @short Check block that is out of offset range.
+ * @param ptr block from shmalloc().
+ * @return ptr if it has valid offset (block is freed and exception is
+ * thrown otherwise).
+ * @exception std::logic_error if offset base is not set.
+ * @exception std::length_error if block is out of offset range.
+ */
+void *offset_check(void *ptr);
+
+/**
+ * @short Return offset of block (0 for null pointer).
+ * @param ptr block from offset_allocate() or 0.
+ * @return offset.
+ */
+inline uint32_t to_offset(const void *ptr) {
+    return ptr? static_cast<uint32_t>(
+            (static_cast<const char *>(ptr) - SHOffsetBase) >> OFFSET_SHIFT): 0;
+}
+
+/**
+ * @short Return block at offset (null pointer for 0).
+ * @param offset offset from to_offset().
+ * @return pointer to block.
+ */
+template <typename _Tp>
+inline _Tp *from_offset(uint32_t offset) {
+    return offset? reinterpret_cast<_Tp *>(
+            SHOffsetBase + (static_cast<std::size_t>(offset) << OFFSET_SHIFT)): 0;
+}
+
+/**
+ * @short Alloc block addressable by offset. Offset base must be set by
+ * set_offset_base() before.
+ * @param size size of block.
+ * @return pointer to block (throws bad_alloc, length_error or logic_error
+ * if offset base is not set).
+ */
+inline void *offset_allocate(std::size_t size) {
+    void *ptr = shmalloc(size);
+    if (!ptr) throw std::bad_alloc();
+    uintptr_t distance = reinterpret_cast<uintptr_t>(ptr)
+                       - reinterpret_cast<uintptr_t>(SHOffsetBase);
+    if (!SHOffsetBase || !distance
+            || (distance & ((1 << OFFSET_SHIFT) - 1))
+            || (distance > (uintptr_t(OFFSET_LIMIT) << OFFSET_SHIFT)))
+        return offset_check(ptr);
+    return ptr;
+}
+
+}
+
+#endif /* SHALLOCATOR_SHOFFSET_H */
+
@@ -0,0 +1,224 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Padded per-process slots in shared memory.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHPER_PROCESS_H
+#define SHALLOCATOR_SHPER_PROCESS_H
+
+#include <sys/types.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Cached pid of this process, reset in child after fork.
+ */
+extern pid_t SHCurrentPid;
+
+/**
+ * @short Read pid of this process by syscall and cache it.
+ */
+pid_t refresh_current_pid();
+
+/**
+ * @short Return pid of this process (cached).
+ */
+inline pid_t current_pid() {
+    return SHCurrentPid? SHCurrentPid: refresh_current_pid();
+}
+
+/**
+ * @short Array of values, one for each attached process. Every slot sits
+ * on its own cache lines so processes updating their slots don't bounce
+ * lines between cores. Typical use are hot counters summed by reader.
+ *
+ * Process gets its slot on first local() (by hash of pid, probing next
+ * slots); slot is owned until release() or reclaim() after process died.
+ * When all slots are owned, slots of dead processes are reclaimed before
+ * local() gives up.
+ * Object must be cache line aligned (new (SHAlloc) does it under C++17,
+ * use Allocator_t::allocate_aligned() otherwise).
+ */
+template <typename _Tp, std::size_t _Slots = 64>
+class shper_process {
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Create all slots with value.
+     * @param __value initial value of slots.
+     */
+    explicit shper_process(const _Tp &__value = _Tp()) {
+        for (size_type __i = 0; __i < _Slots; ++__i) {
+            slots[__i].owner = 0;
+            slots[__i].value = __value;
+        }
+        initial = __value;
+    }
+
+    /**
+     * @short Return slot of this process, claim it if needed.
+     * @return value of this process.
+     * @exception std::length_error if all slots are owned by living
+     * processes.
+     */
+    _Tp &local() {
+        if (_Tp *__value = try_local()) return *__value;
+        throw std::length_error("shper_process: no free slot");
+    }
+
+    /**
+     * @short Return slot of this process, claim it if needed; never
+     * throws (e.g. for allocation hooks). Process without slot probes
+     * owners of all slots by kill() on every call, so keep count of slots
+     * above count of processes.
+     * @return value of this process or 0 if all slots are owned by living
+     * processes.
+     */
+    _Tp *try_local() {
+        pid_t __pid = current_pid();
+        if (_Tp *__value = claim(__pid)) return __value;
+        return reclaim()? claim(__pid): 0;
+    }
+
+    /**
+     * @short Call function for value of each owned slot (and for values
+     * that have been released, they are kept until reset()).
+     * @param __func function called with (pid, value), pid is 0 for
+     * released slots.
+     * @return function (as std::for_each does).
+     */
+    template <typename _Function>
+    _Function for_each(_Function __func) const {
+        for (size_type __i = 0; __i < _Slots; ++__i)
+            __func(__atomic_load_n(&slots[__i].owner, __ATOMIC_ACQUIRE),
+                   slots[__i].value);
+        return __func;
+    }
+
+    /**
+     * @short Sum values of all slots (values must be additive).
+     */
+    _Tp sum() const {
+        _Tp __sum = _Tp();
+        for (size_type __i = 0; __i < _Slots; ++__i)
+            __sum += slots[__i].value;
+        return __sum;
+    }
+
+    /**
+     * @short Release slot of this process, value is kept in the slot.
+     */
+    void release() {
+        pid_t __pid = current_pid();
+        for (size_type __i = 0; __i < _Slots; ++__i) {
+            pid_t __owner = __pid;
+            __atomic_compare_exchange_n(&slots[__i].owner, &__owner, 0, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+    }
+
+    /**
+     * @short Release slots of processes that don't exist any more.
+     * @return count of released slots.
+     */
+    size_type reclaim() {
+        size_type __released = 0;
+        for (size_type __i = 0; __i < _Slots; ++__i) {
+            pid_t __owner = __atomic_load_n(&slots[__i].owner, __ATOMIC_ACQUIRE);
+            if (__owner && kill(__owner, 0) && (errno == ESRCH)
+                    && __atomic_compare_exchange_n(&slots[__i].owner, &__owner,
+                            0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                ++__released;
+        }
+        return __released;
+    }
+
+    /**
+     * @short Set values of released slots to initial value.
+     */
+    void reset() {
+        for (size_type __i = 0; __i < _Slots; ++__i)
+            if (!__atomic_load_n(&slots[__i].owner, __ATOMIC_ACQUIRE))
+                slots[__i].value = initial;
+    }
+
+    /**
+     * @short Return count of slots.
+     */
+    static size_type capacity() { return _Slots;}
+
+private:
+    /**
+     * @short Find or claim slot of pid. Whole probe sequence is searched
+     * for slot of pid first, released slot in front of it must not be
+     * claimed twice.
+     * @return value of slot or 0 if all slots are owned.
+     */
+    _Tp *claim(pid_t __pid) {
+        size_type __start = hash(__pid);
+        for (;;) {
+            Slot_t *__free = 0;
+            for (size_type __i = 0; __i < _Slots; ++__i) {
+                Slot_t &__slot = slots[(__start + __i) % _Slots];
+                pid_t __owner = __atomic_load_n(&__slot.owner,
+                                                __ATOMIC_ACQUIRE);
+                if (__owner == __pid) return &__slot.value;
+                if (!__owner && !__free) __free = &__slot;
+            }
+            if (!__free) return 0;
+
+            // other process may take the free slot meanwhile, search again
+            pid_t __owner = 0;
+            if (__atomic_compare_exchange_n(&__free->owner, &__owner, __pid,
+                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                return &__free->value;
+        }
+    }
+
+    /**
+     * @short Return first slot to probe for pid.
+     */
+    static size_type hash(pid_t __pid) {
+        return static_cast<size_type>(
+                (static_cast<uint64_t>(__pid) * 0x9e3779b97f4a7c15ULL) >> 32)
+            % _Slots;
+    }
+
+    /**
+     * @short Value with owner padded to whole cache lines.
+     */
+    struct Slot_t {
+        pid_t owner;    //< pid of owner or 0.
+        _Tp value;      //< value.
+    } __attribute__((aligned(SHALLOCATOR_CACHE_LINE)));
+
+    Slot_t slots[_Slots];   //< slots.
+    _Tp initial;            //< value of fresh slots.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHPER_PROCESS_H */
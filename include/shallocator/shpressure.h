@@ -0,0 +1,112 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Memory pressure watermarks and callbacks.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHPRESSURE_H
+#define SHALLOCATOR_SHPRESSURE_H
+
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Memory pressure events.
+ */
+enum PressureEvent_t {
+    PRESSURE_NORMAL,        //< usage dropped under low watermark.
+    PRESSURE_HIGH,          //< usage crossed high watermark.
+    PRESSURE_EXHAUSTED      //< alloc failed, free what you can.
+};
+
+/**
+ * @short Memory pressure callback.
+ * @param event what happened.
+ * @param used bytes used in the pool.
+ * @param capacity bytes of the pool.
+ * @param data user data given to add_pressure_callback().
+ */
+typedef void (*PressureCallback_t)(PressureEvent_t event, std::size_t used,
+                                   std::size_t capacity, void *data);
+
+/**
+ * @short Start watching usage of libmm pool.
+ *
+ * Every check_every-th shmalloc() in each process compares used bytes of
+ * the pool (capacity - MM_available()) with watermarks. The process that
+ * sees usage cross high watermark moves the level kept in the pool to
+ * PRESSURE_HIGH, the one that sees it drop under low watermark moves it
+ * back to PRESSURE_NORMAL. Each process remembers the level it fired
+ * callbacks for last time and fires its own callbacks on the next check
+ * that finds the pool level different, so every process with registered
+ * callbacks gets the event once per level change (processes that do not
+ * alloc get it on check_pressure()).
+ *
+ * When libmm fails to alloc a block, PRESSURE_EXHAUSTED callbacks are fired
+ * and alloc is tried once more before bad_alloc is thrown (or 0 returned by
+ * try_allocate()).
+ *
+ * Must be called after MM_create() and before fork.
+ *
+ * @param high high watermark in used bytes.
+ * @param low low watermark in used bytes (should be lower than high).
+ * @param capacity bytes of the pool, 0 means MM_available() now (memory
+ *        used before the call is not counted then).
+ * @param check_every check usage every n-th alloc.
+ */
+void enable_pressure(std::size_t high, std::size_t low,
+                     std::size_t capacity = 0, unsigned check_every = 64);
+
+/**
+ * @short Stop watching usage of the pool in this process.
+ */
+void disable_pressure();
+
+/**
+ * @short Register callback in this process. Callbacks registered before
+ * fork are inherited by children. Callback may free and alloc shared
+ * memory, nested pressure events are not fired. Callback runs inside of
+ * the alloc that noticed pressure, so it must not block on locks that may
+ * be held by the allocating code (use try_lock, see shlru_cache::shrink).
+ * Exceptions thrown by callback are caught and ignored, the alloc goes on.
+ * @param callback callback.
+ * @param data user data passed to callback.
+ */
+void add_pressure_callback(PressureCallback_t callback, void *data = 0);
+
+/**
+ * @short Unregister callback in this process.
+ * @param callback callback.
+ * @param data user data given to add_pressure_callback().
+ */
+void remove_pressure_callback(PressureCallback_t callback, void *data = 0);
+
+/**
+ * @short Check usage now (independently on alloc count).
+ * @return current level (PRESSURE_NORMAL or PRESSURE_HIGH).
+ */
+PressureEvent_t check_pressure();
+
+/**
+ * @short Return current level (PRESSURE_NORMAL or PRESSURE_HIGH).
+ */
+PressureEvent_t pressure_level();
+
+}
+
+#endif /* SHALLOCATOR_SHPRESSURE_H */
+
@@ -0,0 +1,223 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Concurrent shared memory priority queue.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHPRIORITY_QUEUE_H
+#define SHALLOCATOR_SHPRIORITY_QUEUE_H
+
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+#include <shallocator/shvector.h>
+#include <shallocator/shmutex.h>
+#include <shallocator/shhash.h>
+#include <shallocator/shper_process.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Concurrent priority queue in shared memory (relaxed multi-queue).
+ *
+ * Elements are spread over _Queues binary heaps, each with its own lock
+ * and padded to own cache lines. push() goes to random free heap, pop()
+ * locks two random heaps and takes the better of their tops. So pop()
+ * doesn't return the strictly best element, but one close to the top
+ * (rank error grows with _Queues), and processes almost never wait for
+ * each other. Use _Queues = 1 for strict order.
+ *
+ * As std::priority_queue, greatest element by _Compare is on top (use
+ * std::greater for deadlines). Create it in shared memory before fork.
+ */
+template <typename _Tp, typename _Compare = std::less<_Tp>,
+          std::size_t _Queues = 8>
+class shpriority_queue {
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Create empty queue.
+     * @param __comp A comparison functor.
+     */
+    explicit shpriority_queue(const _Compare &__comp = _Compare())
+        : comp(__comp)
+    {}
+
+    /**
+     * @short Insert value.
+     * @param __value value.
+     */
+    void push(const _Tp &__value) {
+        // take first free heap of few random ones, wait on last one
+        for (unsigned __round = 0;; ++__round) {
+            Queue_t &__queue = queues[random() % _Queues];
+            if ((__round < 2 * _Queues)? __queue.mutex.try_lock()
+                                     : (__queue.mutex.lock(), true))
+            {
+                try {
+                    __queue.heap.push_back(__value);
+                } catch (...) {
+                    __queue.mutex.unlock();
+                    throw;
+                }
+                std::push_heap(__queue.heap.begin(), __queue.heap.end(), comp);
+                publish(__queue);
+                __queue.mutex.unlock();
+                return;
+            }
+        }
+    }
+
+    /**
+     * @short Remove element near the top.
+     * @param __value removed element.
+     * @return false if queue is empty.
+     */
+    bool try_pop(_Tp &__value) {
+        for (unsigned __round = 0; __round < 4 * _Queues; ++__round) {
+            Queue_t *__a = &queues[random() % _Queues];
+            Queue_t *__b = &queues[random() % _Queues];
+            if (!load_size(*__a)) std::swap(__a, __b);
+            if (!load_size(*__a)) {
+                if (empty()) return false;
+                continue;
+            }
+            if (!__a->mutex.try_lock()) continue;
+
+            // second heap is only compared, skip it if it is busy
+            if ((__b != __a) && load_size(*__b) && __b->mutex.try_lock()) {
+                if (__a->heap.empty() || (!__b->heap.empty()
+                            && comp(__a->heap.front(), __b->heap.front())))
+                    std::swap(__a, __b);
+                __b->mutex.unlock();
+            }
+            if (pop_locked(*__a, __value)) return true;
+        }
+
+        // contention or almost empty queue, visit all heaps in order
+        for (size_type __i = 0; __i < _Queues; ++__i) {
+            if (!load_size(queues[__i])) continue;
+            queues[__i].mutex.lock();
+            if (pop_locked(queues[__i], __value)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @short Return count of elements (without locks, approximate).
+     */
+    size_type size() const {
+        size_type __size = 0;
+        for (size_type __i = 0; __i < _Queues; ++__i)
+            __size += load_size(queues[__i]);
+        return __size;
+    }
+
+    /**
+     * @short Return true if there is no element (without locks).
+     */
+    bool empty() const {
+        for (size_type __i = 0; __i < _Queues; ++__i)
+            if (load_size(queues[__i])) return false;
+        return true;
+    }
+
+    /**
+     * @short Remove all elements.
+     */
+    void clear() {
+        for (size_type __i = 0; __i < _Queues; ++__i) {
+            ScopedLock_t<Mutex_t> __lock(queues[__i].mutex);
+            queues[__i].heap.clear();
+            publish(queues[__i]);
+        }
+    }
+
+private:
+    shpriority_queue(const shpriority_queue &);
+    shpriority_queue &operator=(const shpriority_queue &);
+
+    /**
+     * @short One heap. Padding keeps hot data of neighbours apart.
+     */
+    struct Queue_t {
+        Queue_t(): size(0) {}
+
+        Mutex_t mutex;                      //< lock of this heap.
+        shvector<_Tp> heap;                 //< binary heap.
+        size_type size;                     //< size readable without lock.
+        char __pad[SHALLOCATOR_CACHE_LINE]; //< keep next heap off our lines.
+    };
+
+    /**
+     * @short Pop top of locked heap and unlock it.
+     */
+    bool pop_locked(Queue_t &__queue, _Tp &__value) {
+        if (__queue.heap.empty()) {
+            __queue.mutex.unlock();
+            return false;
+        }
+        try {
+            __value = __queue.heap.front();
+        } catch (...) {
+            __queue.mutex.unlock();
+            throw;
+        }
+        std::pop_heap(__queue.heap.begin(), __queue.heap.end(), comp);
+        __queue.heap.pop_back();
+        publish(__queue);
+        __queue.mutex.unlock();
+        return true;
+    }
+
+    static void publish(Queue_t &__queue) {
+        __atomic_store_n(&__queue.size, __queue.heap.size(), __ATOMIC_RELAXED);
+    }
+
+    static size_type load_size(const Queue_t &__queue) {
+        return __atomic_load_n(&__queue.size, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Process local random generator (xorshift, seeded by pid).
+     */
+    static size_type random() {
+        static uint64_t __state = 0;
+        static pid_t __owner = 0;
+        if (__owner != current_pid()) {
+            __owner = current_pid();
+            __state = hash_mix(static_cast<uint64_t>(__owner)) | 1;
+        }
+        __state ^= __state << 13;
+        __state ^= __state >> 7;
+        __state ^= __state << 17;
+        return static_cast<size_type>(__state >> 32);
+    }
+
+    _Compare comp;                          //< comparator.
+    char __pad[SHALLOCATOR_CACHE_LINE];     //< keep first heap off our line.
+    Queue_t queues[_Queues];                //< heaps.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHPRIORITY_QUEUE_H */
+
@@ -0,0 +1,298 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Red-black tree algorithms over abstract node links.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHRBTREE_ALGO_H
+#define SHALLOCATOR_SHRBTREE_ALGO_H
+
+namespace SHAllocator {
+
+/**
+ * @short Red-black tree rebalancing and navigation.
+ *
+ * Nodes are accessed only through _NodeTraits so links can be stored in
+ * any form (raw pointers, compressed or self-relative offsets):
+ *
+ *   typedef ... node_ptr;
+ *   static node_ptr left(node_ptr), right(node_ptr), parent(node_ptr);
+ *   static void set_left(node_ptr, node_ptr), set_right(...),
+ *               set_parent(...);
+ *   static bool is_red(node_ptr);
+ *   static void set_red(node_ptr, bool);
+ *
+ * Parent of root is null pointer, tree has no header node; root is kept
+ * by caller and passed by reference.
+ */
+template <typename _NodeTraits>
+struct RBTreeAlgo_t {
+    /// traits
+    typedef _NodeTraits traits;
+    /// node pointer
+    typedef typename _NodeTraits::node_ptr node_ptr;
+
+    /**
+     * @short Return leftmost node of subtree.
+     */
+    static node_ptr minimum(node_ptr __x) {
+        while (node_ptr __l = traits::left(__x)) __x = __l;
+        return __x;
+    }
+
+    /**
+     * @short Return rightmost node of subtree.
+     */
+    static node_ptr maximum(node_ptr __x) {
+        while (node_ptr __r = traits::right(__x)) __x = __r;
+        return __x;
+    }
+
+    /**
+     * @short Return in-order successor or null pointer.
+     */
+    static node_ptr next(node_ptr __x) {
+        if (node_ptr __r = traits::right(__x)) return minimum(__r);
+        node_ptr __p = traits::parent(__x);
+        while (__p && (__x == traits::right(__p))) {
+            __x = __p;
+            __p = traits::parent(__p);
+        }
+        return __p;
+    }
+
+    /**
+     * @short Return in-order predecessor or null pointer.
+     */
+    static node_ptr prev(node_ptr __x) {
+        if (node_ptr __l = traits::left(__x)) return maximum(__l);
+        node_ptr __p = traits::parent(__x);
+        while (__p && (__x == traits::left(__p))) {
+            __x = __p;
+            __p = traits::parent(__p);
+        }
+        return __p;
+    }
+
+    /**
+     * @short Link new node as child of parent and rebalance tree.
+     * @param __x new node.
+     * @param __parent parent (null pointer if tree is empty).
+     * @param __left link as left child.
+     * @param __root root of tree.
+     */
+    static void insert(node_ptr __x, node_ptr __parent, bool __left,
+                       node_ptr &__root)
+    {
+        traits::set_left(__x, node_ptr());
+        traits::set_right(__x, node_ptr());
+        traits::set_parent(__x, __parent);
+        if (!__parent) __root = __x;
+        else if (__left) traits::set_left(__parent, __x);
+        else traits::set_right(__parent, __x);
+        insert_rebalance(__x, __root);
+    }
+
+    /**
+     * @short Unlink node from tree and rebalance tree.
+     * @param __z unlinked node.
+     * @param __root root of tree.
+     */
+    static void erase(node_ptr __z, node_ptr &__root) {
+        node_ptr __y = __z;
+        node_ptr __x = node_ptr();
+        node_ptr __xp = node_ptr();
+
+        // y is node really removed from its position, x replaces it
+        if (!traits::left(__y)) __x = traits::right(__y);
+        else if (!traits::right(__y)) __x = traits::left(__y);
+        else {
+            __y = minimum(traits::right(__y));
+            __x = traits::right(__y);
+        }
+
+        if (__y != __z) {
+            // move successor y to position of z
+            traits::set_parent(traits::left(__z), __y);
+            traits::set_left(__y, traits::left(__z));
+            if (__y != traits::right(__z)) {
+                __xp = traits::parent(__y);
+                if (__x) traits::set_parent(__x, __xp);
+                traits::set_left(__xp, __x);
+                traits::set_right(__y, traits::right(__z));
+                traits::set_parent(traits::right(__z), __y);
+            } else __xp = __y;
+            replace_child(__z, __y, __root);
+            traits::set_parent(__y, traits::parent(__z));
+            bool __red = traits::is_red(__y);
+            traits::set_red(__y, traits::is_red(__z));
+            traits::set_red(__z, __red);
+        } else {
+            __xp = traits::parent(__y);
+            if (__x) traits::set_parent(__x, __xp);
+            replace_child(__z, __x, __root);
+        }
+
+        if (traits::is_red(__z)) return;
+        erase_rebalance(__x, __xp, __root);
+    }
+
+private:
+    /**
+     * @short Return true if node is red (null pointer is black).
+     */
+    static bool red(node_ptr __x) { return __x && traits::is_red(__x);}
+
+    /**
+     * @short Replace child of parent of old node by new node.
+     */
+    static void replace_child(node_ptr __old, node_ptr __new, node_ptr &__root) {
+        node_ptr __p = traits::parent(__old);
+        if (!__p) __root = __new;
+        else if (traits::left(__p) == __old) traits::set_left(__p, __new);
+        else traits::set_right(__p, __new);
+    }
+
+    static void rotate_left(node_ptr __x, node_ptr &__root) {
+        node_ptr __y = traits::right(__x);
+        node_ptr __b = traits::left(__y);
+        traits::set_right(__x, __b);
+        if (__b) traits::set_parent(__b, __x);
+        replace_child(__x, __y, __root);
+        traits::set_parent(__y, traits::parent(__x));
+        traits::set_left(__y, __x);
+        traits::set_parent(__x, __y);
+    }
+
+    static void rotate_right(node_ptr __x, node_ptr &__root) {
+        node_ptr __y = traits::left(__x);
+        node_ptr __b = traits::right(__y);
+        traits::set_left(__x, __b);
+        if (__b) traits::set_parent(__b, __x);
+        replace_child(__x, __y, __root);
+        traits::set_parent(__y, traits::parent(__x));
+        traits::set_right(__y, __x);
+        traits::set_parent(__x, __y);
+    }
+
+    static void insert_rebalance(node_ptr __x, node_ptr &__root) {
+        traits::set_red(__x, true);
+        while ((__x != __root) && traits::is_red(traits::parent(__x))) {
+            node_ptr __xp = traits::parent(__x);
+            node_ptr __xpp = traits::parent(__xp);
+            if (__xp == traits::left(__xpp)) {
+                node_ptr __y = traits::right(__xpp);
+                if (red(__y)) {
+                    traits::set_red(__xp, false);
+                    traits::set_red(__y, false);
+                    traits::set_red(__xpp, true);
+                    __x = __xpp;
+                } else {
+                    if (__x == traits::right(__xp)) {
+                        __x = __xp;
+                        rotate_left(__x, __root);
+                        __xp = traits::parent(__x);
+                    }
+                    traits::set_red(__xp, false);
+                    traits::set_red(__xpp, true);
+                    rotate_right(__xpp, __root);
+                }
+            } else {
+                node_ptr __y = traits::left(__xpp);
+                if (red(__y)) {
+                    traits::set_red(__xp, false);
+                    traits::set_red(__y, false);
+                    traits::set_red(__xpp, true);
+                    __x = __xpp;
+                } else {
+                    if (__x == traits::left(__xp)) {
+                        __x = __xp;
+                        rotate_right(__x, __root);
+                        __xp = traits::parent(__x);
+                    }
+                    traits::set_red(__xp, false);
+                    traits::set_red(__xpp, true);
+                    rotate_left(__xpp, __root);
+                }
+            }
+        }
+        traits::set_red(__root, false);
+    }
+
+    static void erase_rebalance(node_ptr __x, node_ptr __xp, node_ptr &__root) {
+        while ((__x != __root) && !red(__x)) {
+            if (__x == traits::left(__xp)) {
+                node_ptr __w = traits::right(__xp);
+                if (traits::is_red(__w)) {
+                    traits::set_red(__w, false);
+                    traits::set_red(__xp, true);
+                    rotate_left(__xp, __root);
+                    __w = traits::right(__xp);
+                }
+                if (!red(traits::left(__w)) && !red(traits::right(__w))) {
+                    traits::set_red(__w, true);
+                    __x = __xp;
+                    __xp = traits::parent(__xp);
+                } else {
+                    if (!red(traits::right(__w))) {
+                        traits::set_red(traits::left(__w), false);
+                        traits::set_red(__w, true);
+                        rotate_right(__w, __root);
+                        __w = traits::right(__xp);
+                    }
+                    traits::set_red(__w, traits::is_red(__xp));
+                    traits::set_red(__xp, false);
+                    if (node_ptr __r = traits::right(__w))
+                        traits::set_red(__r, false);
+                    rotate_left(__xp, __root);
+                    break;
+                }
+            } else {
+                node_ptr __w = traits::left(__xp);
+                if (traits::is_red(__w)) {
+                    traits::set_red(__w, false);
+                    traits::set_red(__xp, true);
+                    rotate_right(__xp, __root);
+                    __w = traits::left(__xp);
+                }
+                if (!red(traits::right(__w)) && !red(traits::left(__w))) {
+                    traits::set_red(__w, true);
+                    __x = __xp;
+                    __xp = traits::parent(__xp);
+                } else {
+                    if (!red(traits::left(__w))) {
+                        traits::set_red(traits::right(__w), false);
+                        traits::set_red(__w, true);
+                        rotate_left(__w, __root);
+                        __w = traits::left(__xp);
+                    }
+                    traits::set_red(__w, traits::is_red(__xp));
+                    traits::set_red(__xp, false);
+                    if (node_ptr __l = traits::left(__w))
+                        traits::set_red(__l, false);
+                    rotate_right(__xp, __root);
+                    break;
+                }
+            }
+        }
+        if (__x) traits::set_red(__x, false);
+    }
+};
+
+}
+
+#endif /* SHALLOCATOR_SHRBTREE_ALGO_H */
+
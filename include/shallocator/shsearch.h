@@ -0,0 +1,493 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Vectorized search and set operations over sorted arrays.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSEARCH_H
+#define SHALLOCATOR_SHSEARCH_H
+
+#include <stdint.h>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <shallocator/shvector.h>
+#include <shallocator/shsimd.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Kernels over ascending arrays of 4 or 8 byte integers (posting
+ * lists, keys of flat containers).
+ *
+ * There are no vector kernels for other fixed-width keys (structs, byte
+ * arrays); sorted_*() functions search them by scalar std algorithms.
+ */
+struct SearchKernels_t {
+    /// size ratio from which intersection and union gallop over the
+    /// longer array
+    static const std::size_t gallop_ratio = 32;
+
+    /**
+     * @short Return index of first element not less than key.
+     */
+    template <typename _Tp>
+    static std::size_t lower_bound(const _Tp *__a, std::size_t __n,
+                                   _Tp __key)
+    {
+        Check_t<_Tp>();
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return lower_bound_avx2(__a, __n, __key);
+#endif
+        return lower_bound_body<16>(__a, __n, __key);
+    }
+
+    /**
+     * @short Return index of first element greater than key.
+     */
+    template <typename _Tp>
+    static std::size_t upper_bound(const _Tp *__a, std::size_t __n,
+                                   _Tp __key)
+    {
+        if (__key == std::numeric_limits<_Tp>::max()) return __n;
+        return lower_bound(__a, __n, _Tp(__key + 1));
+    }
+
+    /**
+     * @short Return index of element equal to key or n.
+     */
+    template <typename _Tp>
+    static std::size_t find(const _Tp *__a, std::size_t __n, _Tp __key) {
+        std::size_t __i = lower_bound(__a, __n, __key);
+        return ((__i < __n) && (__a[__i] == __key))? __i: __n;
+    }
+
+    /**
+     * @short Write elements present in both strictly ascending arrays to
+     * out (room for min(na, nb) elements, must not overlap inputs).
+     * @return count of written elements.
+     */
+    template <typename _Tp>
+    static std::size_t intersect(const _Tp *__a, std::size_t __na,
+                                 const _Tp *__b, std::size_t __nb,
+                                 _Tp *__out)
+    {
+        Check_t<_Tp>();
+        if (__na > __nb) {
+            std::swap(__a, __b);
+            std::swap(__na, __nb);
+        }
+        if (__nb / gallop_ratio > __na)
+            return intersect_gallop(__a, __na, __b, __nb, __out);
+#ifdef SHALLOCATOR_X86_SIMD
+        if (cpu_has_avx2()) return intersect_avx2(__a, __na, __b, __nb, __out);
+#endif
+        return intersect_scalar(__a, __na, __b, __nb, __out);
+    }
+
+    /**
+     * @short Write union of two strictly ascending arrays to out (room for
+     * na + nb elements, must not overlap inputs), equal elements are
+     * written once.
+     * @return count of written elements.
+     */
+    template <typename _Tp>
+    static std::size_t merge(const _Tp *__a, std::size_t __na,
+                             const _Tp *__b, std::size_t __nb, _Tp *__out)
+    {
+        Check_t<_Tp>();
+        if (__na > __nb) {
+            std::swap(__a, __b);
+            std::swap(__na, __nb);
+        }
+        if (__nb / gallop_ratio > __na)
+            return merge_gallop(__a, __na, __b, __nb, __out);
+        return merge_scalar(__a, __na, __b, __nb, __out);
+    }
+
+private:
+    /**
+     * @short Refuse types without vector compare of whole key.
+     */
+    template <typename _Tp>
+    struct Check_t {
+        typedef char TypeCheck_t[(std::numeric_limits<_Tp>::is_integer
+                                  && ((sizeof(_Tp) == 4)
+                                      || (sizeof(_Tp) == 8)))? 1: -1];
+    };
+
+    /**
+     * @short Branch free binary search narrows range to four vectors,
+     * elements less than key are counted in them. Inlined to both generic
+     * and AVX2 variant.
+     */
+    template <std::size_t _Bytes, typename _Tp>
+    __attribute__((always_inline))
+    static inline std::size_t lower_bound_body(const _Tp *__a, std::size_t __n,
+                                               _Tp __key)
+    {
+        typedef _Tp v_t __attribute__((vector_size(_Bytes),
+                                       aligned(sizeof(_Tp))));
+        const std::size_t __lanes = _Bytes / sizeof(_Tp);
+
+        // answer is in [base, base + n], elements before base are less
+        const _Tp *__base = __a;
+        while (__n > 4 * __lanes) {
+            std::size_t __half = __n / 2;
+            __base = (__base[__half - 1] < __key)? __base + __half: __base;
+            __n -= __half;
+        }
+
+        std::size_t __i = 0;
+        std::size_t __count = 0;
+        if (__n >= __lanes) {
+            v_t __x = *reinterpret_cast<const v_t *>(__base);
+            __typeof__(__x < __x) __acc = __x < __key;
+            for (__i = __lanes; __i + __lanes <= __n; __i += __lanes) {
+                __x = *reinterpret_cast<const v_t *>(__base + __i);
+                __acc += __x < __key;
+            }
+            // lanes hold minus count of less elements
+            for (std::size_t __j = 0; __j < __lanes; ++__j)
+                __count -= static_cast<std::size_t>(__acc[__j]);
+        }
+        for (; __i < __n; ++__i) __count += __base[__i] < __key;
+        return static_cast<std::size_t>(__base - __a) + __count;
+    }
+
+    /**
+     * @short Return index of first element of b not less than key, starting
+     * at from; steps double from start, so cost is logarithmic in
+     * distance.
+     */
+    template <typename _Tp>
+    static std::size_t gallop(const _Tp *__b, std::size_t __nb,
+                              std::size_t __from, _Tp __key)
+    {
+        std::size_t __step = 1;
+        while ((__from + __step < __nb) && (__b[__from + __step] < __key))
+            __step *= 2;
+        std::size_t __first = __from + __step / 2;
+        std::size_t __last = std::min(__from + __step + 1, __nb);
+        return __first + lower_bound(__b + __first, __last - __first, __key);
+    }
+
+    /**
+     * @short Branch free merge intersection.
+     */
+    template <typename _Tp>
+    static std::size_t intersect_scalar(const _Tp *__a, std::size_t __na,
+                                        const _Tp *__b, std::size_t __nb,
+                                        _Tp *__out)
+    {
+        std::size_t __i = 0, __j = 0, __k = 0;
+        while ((__i < __na) && (__j < __nb)) {
+            _Tp __x = __a[__i];
+            _Tp __y = __b[__j];
+            __out[__k] = __x;
+            __k += __x == __y;
+            __i += __x <= __y;
+            __j += __y <= __x;
+        }
+        return __k;
+    }
+
+    /**
+     * @short Intersection of short array a with much longer b, every
+     * element of a is looked up by galloping in rest of b.
+     */
+    template <typename _Tp>
+    static std::size_t intersect_gallop(const _Tp *__a, std::size_t __na,
+                                        const _Tp *__b, std::size_t __nb,
+                                        _Tp *__out)
+    {
+        std::size_t __j = 0, __k = 0;
+        for (std::size_t __i = 0; (__i < __na) && (__j < __nb); ++__i) {
+            __j = gallop(__b, __nb, __j, __a[__i]);
+            if ((__j < __nb) && (__b[__j] == __a[__i]))
+                __out[__k++] = __a[__i];
+        }
+        return __k;
+    }
+
+    /**
+     * @short Branch free merge union.
+     */
+    template <typename _Tp>
+    static std::size_t merge_scalar(const _Tp *__a, std::size_t __na,
+                                    const _Tp *__b, std::size_t __nb,
+                                    _Tp *__out)
+    {
+        std::size_t __i = 0, __j = 0, __k = 0;
+        while ((__i < __na) && (__j < __nb)) {
+            _Tp __x = __a[__i];
+            _Tp __y = __b[__j];
+            __out[__k++] = (__x < __y)? __x: __y;
+            __i += __x <= __y;
+            __j += __y <= __x;
+        }
+        __out = std::copy(__a + __i, __a + __na, __out + __k);
+        std::copy(__b + __j, __b + __nb, __out);
+        return __k + (__na - __i) + (__nb - __j);
+    }
+
+    /**
+     * @short Union of short array a with much longer b, runs of b between
+     * elements of a are found by galloping and copied at once.
+     */
+    template <typename _Tp>
+    static std::size_t merge_gallop(const _Tp *__a, std::size_t __na,
+                                    const _Tp *__b, std::size_t __nb,
+                                    _Tp *__out)
+    {
+        _Tp *__dst = __out;
+        std::size_t __j = 0;
+        for (std::size_t __i = 0; __i < __na; ++__i) {
+            std::size_t __end = (__j < __nb)
+                ? gallop(__b, __nb, __j, __a[__i]): __nb;
+            __dst = std::copy(__b + __j, __b + __end, __dst);
+            __j = __end;
+            *__dst++ = __a[__i];
+            if ((__j < __nb) && (__b[__j] == __a[__i])) ++__j;
+        }
+        __dst = std::copy(__b + __j, __b + __nb, __dst);
+        return static_cast<std::size_t>(__dst - __out);
+    }
+
+#ifdef SHALLOCATOR_X86_SIMD
+    template <typename _Tp>
+    __attribute__((target("avx2")))
+    static std::size_t lower_bound_avx2(const _Tp *__a, std::size_t __n,
+                                        _Tp __key)
+    {
+        return lower_bound_body<32>(__a, __n, __key);
+    }
+
+    /**
+     * @short Block intersection: each element of block of a is compared
+     * with all rotations of block of b, block with smaller maximum is
+     * consumed.
+     */
+    template <typename _Tp>
+    __attribute__((target("avx2")))
+    static std::size_t intersect_avx2(const _Tp *__a, std::size_t __na,
+                                      const _Tp *__b, std::size_t __nb,
+                                      _Tp *__out)
+    {
+        typedef _Tp v_t __attribute__((vector_size(32), aligned(sizeof(_Tp))));
+        typedef float vf_t __attribute__((vector_size(32)));
+        typedef double vd_t __attribute__((vector_size(32)));
+        const std::size_t __lanes = 32 / sizeof(_Tp);
+
+        v_t __rotate;
+        for (std::size_t __r = 0; __r < __lanes; ++__r)
+            __rotate[__r] = static_cast<_Tp>((__r + 1) % __lanes);
+
+        std::size_t __i = 0, __j = 0, __k = 0;
+        while ((__i + __lanes <= __na) && (__j + __lanes <= __nb)) {
+            v_t __x = *reinterpret_cast<const v_t *>(__a + __i);
+            v_t __y = *reinterpret_cast<const v_t *>(__b + __j);
+            __typeof__(__x == __y) __hit = __x == __y;
+            for (std::size_t __r = 1; __r < __lanes; ++__r) {
+                __y = __builtin_shuffle(__y, __rotate);
+                __hit |= __x == __y;
+            }
+
+            // casts between vectors of the same size keep bits
+            unsigned __bits = (sizeof(_Tp) == 8)
+                ? static_cast<unsigned>(__builtin_ia32_movmskpd256(
+                            (vd_t)__hit))
+                : static_cast<unsigned>(__builtin_ia32_movmskps256(
+                            (vf_t)__hit));
+            for (; __bits; __bits &= __bits - 1)
+                __out[__k++] = __a[__i + static_cast<std::size_t>(
+                        __builtin_ctz(__bits))];
+
+            _Tp __amax = __a[__i + __lanes - 1];
+            _Tp __bmax = __b[__j + __lanes - 1];
+            __i += (__amax <= __bmax)? __lanes: 0;
+            __j += (__bmax <= __amax)? __lanes: 0;
+        }
+        return __k + intersect_scalar(__a + __i, __na - __i, __b + __j,
+                                      __nb - __j, __out + __k);
+    }
+#endif
+};
+
+/**
+ * @short Binary search used by sorted containers; integer keys ordered
+ * by std::less use SearchKernels_t, others std algorithms.
+ */
+template <typename _Tp, typename _Compare>
+struct SortedSearch_t {
+    static const _Tp *lower_bound(const _Tp *__first, const _Tp *__last,
+                                  const _Tp &__key, const _Compare &__comp)
+    {
+        return std::lower_bound(__first, __last, __key, __comp);
+    }
+
+    static const _Tp *upper_bound(const _Tp *__first, const _Tp *__last,
+                                  const _Tp &__key, const _Compare &__comp)
+    {
+        return std::upper_bound(__first, __last, __key, __comp);
+    }
+};
+
+/**
+ * @short Vectorized search of integer keys.
+ */
+template <typename _Tp>
+struct SearchKernelsSearch_t {
+    static const _Tp *lower_bound(const _Tp *__first, const _Tp *__last,
+                                  const _Tp &__key, const std::less<_Tp> &)
+    {
+        return __first + SearchKernels_t::lower_bound(
+                __first, static_cast<std::size_t>(__last - __first), __key);
+    }
+
+    static const _Tp *upper_bound(const _Tp *__first, const _Tp *__last,
+                                  const _Tp &__key, const std::less<_Tp> &)
+    {
+        return __first + SearchKernels_t::upper_bound(
+                __first, static_cast<std::size_t>(__last - __first), __key);
+    }
+};
+
+template <>
+struct SortedSearch_t<int32_t, std::less<int32_t> >
+    : SearchKernelsSearch_t<int32_t> {};
+
+template <>
+struct SortedSearch_t<uint32_t, std::less<uint32_t> >
+    : SearchKernelsSearch_t<uint32_t> {};
+
+template <>
+struct SortedSearch_t<int64_t, std::less<int64_t> >
+    : SearchKernelsSearch_t<int64_t> {};
+
+template <>
+struct SortedSearch_t<uint64_t, std::less<uint64_t> >
+    : SearchKernelsSearch_t<uint64_t> {};
+
+/**
+ * @short Kernels of sorted_*() functions: SearchKernels_t for 4 and 8 byte
+ * integers, scalar std algorithms (operator<) for other keys.
+ */
+template <typename _Tp, bool = std::numeric_limits<_Tp>::is_integer
+                               && ((sizeof(_Tp) == 4) || (sizeof(_Tp) == 8))>
+struct SortedKernels_t {
+    static std::size_t lower_bound(const _Tp *__a, std::size_t __n,
+                                   const _Tp &__key)
+    {
+        return static_cast<std::size_t>(
+                std::lower_bound(__a, __a + __n, __key) - __a);
+    }
+
+    static std::size_t upper_bound(const _Tp *__a, std::size_t __n,
+                                   const _Tp &__key)
+    {
+        return static_cast<std::size_t>(
+                std::upper_bound(__a, __a + __n, __key) - __a);
+    }
+
+    static std::size_t find(const _Tp *__a, std::size_t __n,
+                            const _Tp &__key)
+    {
+        std::size_t __i = lower_bound(__a, __n, __key);
+        return ((__i < __n) && !(__key < __a[__i]))? __i: __n;
+    }
+
+    static std::size_t intersect(const _Tp *__a, std::size_t __na,
+                                 const _Tp *__b, std::size_t __nb,
+                                 _Tp *__out)
+    {
+        return static_cast<std::size_t>(std::set_intersection(__a,
+                    __a + __na, __b, __b + __nb, __out) - __out);
+    }
+
+    static std::size_t merge(const _Tp *__a, std::size_t __na,
+                             const _Tp *__b, std::size_t __nb, _Tp *__out)
+    {
+        return static_cast<std::size_t>(std::set_union(__a, __a + __na,
+                    __b, __b + __nb, __out) - __out);
+    }
+};
+
+template <typename _Tp>
+struct SortedKernels_t<_Tp, true>: SearchKernels_t {};
+
+/**
+ * @short Return index of first element of ascending vector not less than
+ * key.
+ */
+template <typename _Tp>
+inline typename shvector<_Tp>::size_type
+sorted_lower_bound(const shvector<_Tp> &__v, const _Tp &__key) {
+    return SortedKernels_t<_Tp>::lower_bound(__v.data(), __v.size(), __key);
+}
+
+/**
+ * @short Return index of first element of ascending vector greater than
+ * key.
+ */
+template <typename _Tp>
+inline typename shvector<_Tp>::size_type
+sorted_upper_bound(const shvector<_Tp> &__v, const _Tp &__key) {
+    return SortedKernels_t<_Tp>::upper_bound(__v.data(), __v.size(), __key);
+}
+
+/**
+ * @short Return index of element of ascending vector equal to key or
+ * size() if there is none.
+ */
+template <typename _Tp>
+inline typename shvector<_Tp>::size_type
+sorted_find(const shvector<_Tp> &__v, const _Tp &__key) {
+    return SortedKernels_t<_Tp>::find(__v.data(), __v.size(), __key);
+}
+
+/**
+ * @short Replace content of out by intersection of strictly ascending
+ * vectors (out must be other vector than a and b).
+ */
+template <typename _Tp>
+inline void sorted_intersection(const shvector<_Tp> &__a,
+                                const shvector<_Tp> &__b,
+                                shvector<_Tp> &__out)
+{
+    __out.resize(std::min(__a.size(), __b.size()));
+    __out.resize(SortedKernels_t<_Tp>::intersect(__a.data(), __a.size(),
+                                                 __b.data(), __b.size(),
+                                                 __out.data()));
+}
+
+/**
+ * @short Replace content of out by union of strictly ascending vectors
+ * (out must be other vector than a and b).
+ */
+template <typename _Tp>
+inline void sorted_union(const shvector<_Tp> &__a, const shvector<_Tp> &__b,
+                         shvector<_Tp> &__out)
+{
+    __out.resize(__a.size() + __b.size());
+    __out.resize(SortedKernels_t<_Tp>::merge(__a.data(), __a.size(),
+                                             __b.data(), __b.size(),
+                                             __out.data()));
+}
+
+}
+
+#endif /* SHALLOCATOR_SHSEARCH_H */
@@ -0,0 +1,305 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory map split to independently locked shards.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSHARDED_MAP_H
+#define SHALLOCATOR_SHSHARDED_MAP_H
+
+#include <shallocator/shalloc.h>
+#include <shallocator/shmap.h>
+#include <shallocator/shmutex.h>
+#include <shallocator/shhash.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory map split to _Shards independent %shmap shards.
+ *
+ * Key is hashed to one shard and each shard has its own process shared
+ * mutex, so writers of keys from different shards don't wait for each
+ * other. Shards are padded so that locks and tree roots of neighbouring
+ * shards never share a cache line. Iterators are not exported because
+ * they would outlive the lock; use the visitor methods instead.
+ *
+ * Create it in shared memory before fork:
+ * @code
+ *     shsharded_map<int, shstring> *map
+ *         = new (SHAlloc) shsharded_map<int, shstring>();
+ * @endcode
+ */
+template <typename _Key, typename _Tp, std::size_t _Shards = 16,
+          typename _Hash = shhash<_Key>, typename _Compare = std::less<_Key> >
+class shsharded_map {
+public:
+    /// one shard typedef
+    typedef shmap<_Key, _Tp, _Compare> shard_type;
+    /// type of key
+    typedef _Key key_type;
+    /// type of mapped value
+    typedef _Tp mapped_type;
+    /// type of value
+    typedef typename shard_type::value_type value_type;
+    /// type of size
+    typedef typename shard_type::size_type size_type;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __hash A hash functor.
+     * @param __comp A comparison functor.
+     */
+    explicit
+    shsharded_map(const _Hash &__hash = _Hash(),
+                  const _Compare &__comp = _Compare())
+        : hash(__hash)
+    {
+        for (size_type __i = 0; __i < _Shards; ++__i)
+            shards[__i].map = shard_type(__comp);
+    }
+
+    /**
+     * @short Builds a %shsharded_map from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __hash A hash functor.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shsharded_map(_InputIterator __first, _InputIterator __last,
+                  const _Hash &__hash = _Hash(),
+                  const _Compare &__comp = _Compare())
+        : hash(__hash)
+    {
+        for (size_type __i = 0; __i < _Shards; ++__i)
+            shards[__i].map = shard_type(__comp);
+        for (; __first != __last; ++__first)
+            insert(*__first);
+    }
+
+    /**
+     * @short Return count of shards.
+     * @return count of shards.
+     */
+    static size_type shard_count() { return _Shards;}
+
+    /**
+     * @short Return index of shard holding key.
+     * @param __key key.
+     * @return shard index.
+     */
+    size_type shard_of(const _Key &__key) const {
+        return static_cast<size_type>(hash(__key) % _Shards);
+    }
+
+    /**
+     * @short Insert value if key is not present yet.
+     * @param __value inserted value.
+     * @return true if value has been inserted.
+     */
+    bool insert(const value_type &__value) {
+        Shard_t &__shard = shards[shard_of(__value.first)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        return __shard.map.insert(__value).second;
+    }
+
+    /**
+     * @short Insert value or overwrite value of present key.
+     * @param __key key.
+     * @param __value new value.
+     */
+    void assign(const _Key &__key, const _Tp &__value) {
+        Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        __shard.map[__key] = __value;
+    }
+
+    /**
+     * @short Copy value of key out of the map.
+     * @param __key key.
+     * @param __value found value will be assigned here.
+     * @return true if key has been found.
+     */
+    template <typename _Out>
+    bool find(const _Key &__key, _Out &__value) const {
+        const Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        typename shard_type::const_iterator __it = __shard.map.find(__key);
+        if (__it == __shard.map.end())
+            return false;
+        __value = __it->second;
+        return true;
+    }
+
+    /**
+     * @short Call functor on value of key while shard is locked.
+     * @param __key key.
+     * @param __func functor called as __func(mapped_type &).
+     * @return true if key has been found.
+     */
+    template <typename _Func>
+    bool update(const _Key &__key, _Func __func) {
+        Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        typename shard_type::iterator __it = __shard.map.find(__key);
+        if (__it == __shard.map.end())
+            return false;
+        __func(__it->second);
+        return true;
+    }
+
+    /**
+     * @short Return count of elements with key (0 or 1).
+     * @param __key key.
+     * @return count of elements.
+     */
+    size_type count(const _Key &__key) const {
+        const Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        return __shard.map.count(__key);
+    }
+
+    /**
+     * @short Erase element with key.
+     * @param __key key.
+     * @return count of erased elements.
+     */
+    size_type erase(const _Key &__key) {
+        Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        return __shard.map.erase(__key);
+    }
+
+    /**
+     * @short Call functor on value of key and erase element while shard
+     * is locked (e.g. to free memory the value points to).
+     * @param __key key.
+     * @param __func functor called as __func(mapped_type &).
+     * @return count of erased elements.
+     */
+    template <typename _Func>
+    size_type erase(const _Key &__key, _Func __func) {
+        Shard_t &__shard = shards[shard_of(__key)];
+        ScopedLock_t<Mutex_t> __lock(__shard.mutex);
+        typename shard_type::iterator __it = __shard.map.find(__key);
+        if (__it == __shard.map.end())
+            return 0;
+        __func(__it->second);
+        __shard.map.erase(__it);
+        return 1;
+    }
+
+    /**
+     * @short Return count of elements in one shard.
+     * @param __shard shard index.
+     * @return count of elements.
+     */
+    size_type shard_size(size_type __shard) const {
+        ScopedLock_t<Mutex_t> __lock(shards[__shard].mutex);
+        return shards[__shard].map.size();
+    }
+
+    /**
+     * @short Return count of elements. Shards are locked one by one so
+     * result is not atomic snapshot when somebody writes concurrently.
+     * @return count of elements.
+     */
+    size_type size() const {
+        size_type __size = 0;
+        for (size_type __i = 0; __i < _Shards; ++__i)
+            __size += shard_size(__i);
+        return __size;
+    }
+
+    /**
+     * @short Return true if there is no element (see size()).
+     * @return true if map is empty.
+     */
+    bool empty() const { return !size();}
+
+    /**
+     * @short Erase all elements, shard by shard.
+     */
+    void clear() {
+        for (size_type __i = 0; __i < _Shards; ++__i) {
+            ScopedLock_t<Mutex_t> __lock(shards[__i].mutex);
+            shards[__i].map.clear();
+        }
+    }
+
+    /**
+     * @short Call functor for each element and erase all elements, shard
+     * by shard.
+     * @param __func functor called as __func(mapped_type &).
+     */
+    template <typename _Func>
+    void clear(_Func __func) {
+        for (size_type __i = 0; __i < _Shards; ++__i) {
+            ScopedLock_t<Mutex_t> __lock(shards[__i].mutex);
+            for (typename shard_type::iterator
+                    __it = shards[__i].map.begin();
+                    __it != shards[__i].map.end(); ++__it)
+                __func(__it->second);
+            shards[__i].map.clear();
+        }
+    }
+
+    /**
+     * @short Call functor for each element of one shard, shard is locked.
+     * @param __shard shard index.
+     * @param __func functor called as __func(const value_type &).
+     */
+    template <typename _Func>
+    void for_each_in_shard(size_type __shard, _Func __func) const {
+        ScopedLock_t<Mutex_t> __lock(shards[__shard].mutex);
+        for (typename shard_type::const_iterator
+                __it = shards[__shard].map.begin();
+                __it != shards[__shard].map.end(); ++__it)
+            __func(*__it);
+    }
+
+    /**
+     * @short Call functor for each element, shards are locked one by one.
+     * Elements are ordered within shard only.
+     * @param __func functor called as __func(const value_type &).
+     */
+    template <typename _Func>
+    void for_each(_Func __func) const {
+        for (size_type __i = 0; __i < _Shards; ++__i)
+            for_each_in_shard(__i, __func);
+    }
+
+private:
+    shsharded_map(const shsharded_map &);
+    shsharded_map &operator=(const shsharded_map &);
+
+    /**
+     * @short One shard. Padding keeps hot data of neighbours apart.
+     */
+    struct Shard_t {
+        mutable Mutex_t mutex;              //< lock of this shard.
+        shard_type map;                     //< data of this shard.
+        char __pad[SHALLOCATOR_CACHE_LINE]; //< keep next shard off our lines.
+    };
+
+    _Hash hash;                             //< hash functor.
+    char __pad[SHALLOCATOR_CACHE_LINE];     //< keep first shard off our line.
+    Shard_t shards[_Shards];                //< shards.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHSHARDED_MAP_H */
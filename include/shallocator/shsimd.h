@@ -0,0 +1,71 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Runtime CPU dispatch for vectorized kernels.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSIMD_H
+#define SHALLOCATOR_SHSIMD_H
+
+// Kernels are written with GCC vector extensions and compiled for more
+// targets by target attribute, choice is made at runtime. Define
+// SHALLOCATOR_NO_SIMD to get scalar code only.
+#if !defined(SHALLOCATOR_NO_SIMD) && defined(__GNUC__) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define SHALLOCATOR_X86_SIMD 1
+#endif
+
+namespace SHAllocator {
+
+/**
+ * @short Return true if CPU supports AVX2.
+ */
+inline bool cpu_has_avx2() {
+#ifdef SHALLOCATOR_X86_SIMD
+    static const bool __avx2 = __builtin_cpu_supports("avx2");
+    return __avx2;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @short Return true if CPU supports SSE4.2.
+ */
+inline bool cpu_has_sse42() {
+#ifdef SHALLOCATOR_X86_SIMD
+    static const bool __sse42 = __builtin_cpu_supports("sse4.2");
+    return __sse42;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @short Return true if CPU has popcnt instruction.
+ */
+inline bool cpu_has_popcnt() {
+#ifdef SHALLOCATOR_X86_SIMD
+    static const bool __popcnt = __builtin_cpu_supports("popcnt");
+    return __popcnt;
+#else
+    return false;
+#endif
+}
+
+}
+
+#endif /* SHALLOCATOR_SHSIMD_H */
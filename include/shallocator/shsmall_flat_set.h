@@ -0,0 +1,306 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory sorted vector set with inline storage.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSMALL_FLAT_SET_H
+#define SHALLOCATOR_SHSMALL_FLAT_SET_H
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <set>
+#include <shallocator/shsmall_vector.h>
+#include <shallocator/shsearch.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory set stored as sorted shsmall_vector.
+ *
+ * Lookups are binary searches over contiguous elements, first _N elements
+ * need no allocation. Insert and erase shift elements, so it suits small
+ * or rarely modified sets. Iterators are invalidated by every insert and
+ * erase. Interface is subset of std::set.
+ */
+template <typename _Key, std::size_t _N = 8,
+          typename _Compare = std::less<_Key> >
+class shsmall_flat_set {
+    typedef shsmall_vector<_Key, _N> Vector_t;
+    typedef SortedSearch_t<_Key, _Compare> Search_t;
+
+public:
+    /// key type
+    typedef _Key key_type;
+    /// value type
+    typedef _Key value_type;
+    /// comparator
+    typedef _Compare key_compare;
+    /// comparator
+    typedef _Compare value_compare;
+    /// reference
+    typedef const _Key &reference;
+    /// const reference
+    typedef const _Key &const_reference;
+    /// iterator (elements are immutable as in std::set)
+    typedef typename Vector_t::const_iterator iterator;
+    /// const iterator
+    typedef typename Vector_t::const_iterator const_iterator;
+    /// reverse iterator
+    typedef typename Vector_t::const_reverse_iterator reverse_iterator;
+    /// const reverse iterator
+    typedef typename Vector_t::const_reverse_iterator const_reverse_iterator;
+    /// size type
+    typedef std::size_t size_type;
+
+    /**
+     * @short Default constructor creates no elements.
+     * @param __comp Comparator to use.
+     */
+    explicit shsmall_flat_set(const _Compare &__comp = _Compare())
+        : comp(__comp)
+    {}
+
+    /**
+     * @short Construct %shsmall_flat_set from std set.
+     * @param __other other set.
+     */
+    template <typename _otherKey, typename _otherCompare, typename _otherAllocT>
+    shsmall_flat_set(const std::set<_otherKey, _otherCompare, _otherAllocT>
+                     &__other)
+        : values(__other.begin(), __other.end()), comp(_Compare())
+    {
+        normalize();
+    }
+
+    /**
+     * @short Builds a %shsmall_flat_set from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @param __comp A comparison functor.
+     */
+    template <typename _InputIterator>
+    shsmall_flat_set(_InputIterator __first, _InputIterator __last,
+                     const _Compare &__comp = _Compare())
+        : values(__first, __last), comp(__comp)
+    {
+        normalize();
+    }
+
+    iterator begin() const { return values.begin();}
+    iterator end() const { return values.end();}
+    reverse_iterator rbegin() const { return values.rbegin();}
+    reverse_iterator rend() const { return values.rend();}
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return values.size();}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return values.empty();}
+
+    /**
+     * @short Return count of elements that fit without reallocation.
+     */
+    size_type capacity() const { return values.capacity();}
+
+    /**
+     * @short Return true if elements are stored inside the object.
+     */
+    bool is_inline() const { return values.is_inline();}
+
+    /**
+     * @short Return comparator.
+     */
+    key_compare key_comp() const { return comp;}
+
+    /**
+     * @short Make room for at least n elements.
+     */
+    void reserve(size_type __n) { values.reserve(__n);}
+
+    /**
+     * @short Free spare capacity.
+     */
+    void shrink_to_fit() { values.shrink_to_fit();}
+
+    /**
+     * @short Insert value unless equal one is present.
+     * @param __value value.
+     * @return iterator to element and true if value was inserted.
+     */
+    std::pair<iterator, bool> insert(const _Key &__value) {
+        iterator __it = lower_bound(__value);
+        if ((__it != end()) && !comp(__value, *__it))
+            return std::make_pair(__it, false);
+        return std::make_pair(values.insert(__it, __value), true);
+    }
+
+    /**
+     * @short Insert value, hint is ignored.
+     */
+    iterator insert(const_iterator, const _Key &__value) {
+        return insert(__value).first;
+    }
+
+    /**
+     * @short Insert range (appended and merged at once).
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    void insert(_InputIterator __first, _InputIterator __last) {
+        size_type __old = values.size();
+        values.insert(values.end(), __first, __last);
+        std::sort(values.begin() + __old, values.end(), comp);
+        std::inplace_merge(values.begin(), values.begin() + __old,
+                           values.end(), comp);
+        unique();
+    }
+
+    /**
+     * @short Erase element at position.
+     * @return iterator to next element.
+     */
+    iterator erase(const_iterator __pos) { return values.erase(__pos);}
+
+    /**
+     * @short Erase range of elements.
+     * @return iterator to element after erased ones.
+     */
+    iterator erase(const_iterator __first, const_iterator __last) {
+        return values.erase(__first, __last);
+    }
+
+    /**
+     * @short Erase element equal to key.
+     * @return count of erased elements.
+     */
+    size_type erase(const _Key &__key) {
+        iterator __it = find(__key);
+        if (__it == end()) return 0;
+        values.erase(__it);
+        return 1;
+    }
+
+    /**
+     * @short Erase all elements.
+     */
+    void clear() { values.clear();}
+
+    /**
+     * @short Swap content with other set.
+     */
+    void swap(shsmall_flat_set &__other) {
+        values.swap(__other.values);
+        std::swap(comp, __other.comp);
+    }
+
+    /**
+     * @short Find element equal to key.
+     * @return iterator to found element or end().
+     */
+    iterator find(const _Key &__key) const {
+        iterator __it = lower_bound(__key);
+        return ((__it == end()) || comp(__key, *__it))? end(): __it;
+    }
+
+    /**
+     * @short Return count of elements equal to key (0 or 1).
+     */
+    size_type count(const _Key &__key) const { return find(__key) != end();}
+
+    /**
+     * @short Return first element not less than key.
+     */
+    iterator lower_bound(const _Key &__key) const {
+        return Search_t::lower_bound(begin(), end(), __key, comp);
+    }
+
+    /**
+     * @short Return first element greater than key.
+     */
+    iterator upper_bound(const _Key &__key) const {
+        return Search_t::upper_bound(begin(), end(), __key, comp);
+    }
+
+    /**
+     * @short Return range of elements equal to key.
+     */
+    std::pair<iterator, iterator> equal_range(const _Key &__key) const {
+        return std::equal_range(begin(), end(), __key, comp);
+    }
+
+private:
+    /**
+     * @short Sort values and drop duplicates.
+     */
+    void normalize() {
+        std::sort(values.begin(), values.end(), comp);
+        unique();
+    }
+
+    /**
+     * @short Drop duplicates of sorted values.
+     */
+    void unique() {
+        typename Vector_t::iterator __end = values.begin();
+        for (typename Vector_t::iterator __it = values.begin();
+             __it != values.end(); ++__it)
+        {
+            if ((__end != values.begin()) && !comp(*(__end - 1), *__it))
+                continue;
+            if (__end != __it) *__end = *__it;
+            ++__end;
+        }
+        values.erase(__end, values.end());
+    }
+
+    Vector_t values;    //< sorted values.
+    _Compare comp;      //< comparator.
+};
+
+template <typename _Key, std::size_t _N, typename _Compare>
+inline bool operator==(const shsmall_flat_set<_Key, _N, _Compare> &__x,
+                       const shsmall_flat_set<_Key, _N, _Compare> &__y)
+{
+    return (__x.size() == __y.size())
+        && std::equal(__x.begin(), __x.end(), __y.begin());
+}
+
+template <typename _Key, std::size_t _N, typename _Compare>
+inline bool operator!=(const shsmall_flat_set<_Key, _N, _Compare> &__x,
+                       const shsmall_flat_set<_Key, _N, _Compare> &__y)
+{
+    return !(__x == __y);
+}
+
+template <typename _Key, std::size_t _N, typename _Compare>
+inline bool operator<(const shsmall_flat_set<_Key, _N, _Compare> &__x,
+                      const shsmall_flat_set<_Key, _N, _Compare> &__y)
+{
+    return std::lexicographical_compare(__x.begin(), __x.end(),
+                                        __y.begin(), __y.end());
+}
+
+}
+
+#endif /* SHALLOCATOR_SHSMALL_FLAT_SET_H */
+
@@ -0,0 +1,500 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory vector with inline storage.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSMALL_VECTOR_H
+#define SHALLOCATOR_SHSMALL_VECTOR_H
+
+#include <iterator>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <limits>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Shared memory vector keeping first _N elements inside itself.
+ *
+ * Up to _N elements need no allocation at all, so small vector embedded
+ * in other shared object (e.g. value of shmap) costs no MM_malloc call
+ * and no indirection. When it overflows, elements move to buffer from
+ * Allocator_t and stay there until shrink_to_fit(). Interface is subset
+ * of std::vector; iterators are plain pointers and are invalidated by
+ * every reallocation and by swap() of inline vectors.
+ *
+ * Inline storage is addressed relatively to the object, so the vector
+ * may be copied by its copy constructor only (no memcpy).
+ */
+template <typename _Tp, std::size_t _N = 8>
+class shsmall_vector {
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// reference
+    typedef _Tp &reference;
+    /// const reference
+    typedef const _Tp &const_reference;
+    /// pointer
+    typedef _Tp *pointer;
+    /// const pointer
+    typedef const _Tp *const_pointer;
+    /// iterator
+    typedef _Tp *iterator;
+    /// const iterator
+    typedef const _Tp *const_iterator;
+    /// reverse iterator
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    /// const reverse iterator
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+    /// size type
+    typedef std::size_t size_type;
+    /// difference type
+    typedef std::ptrdiff_t difference_type;
+    /// allocator of spilled elements
+    typedef Allocator_t<_Tp> AllocatorType_t;
+
+    /// count of inline elements
+    static const size_type INLINE_CAPACITY = _N;
+
+    /**
+     * @short Default constructor creates no elements.
+     */
+    shsmall_vector(): heap(0), elements(0), cap(_N) {}
+
+    /**
+     * @short Create a %shsmall_vector with copies of an exemplar element.
+     * @param __n count of elements.
+     * @param __value value.
+     */
+    explicit
+    shsmall_vector(size_type __n, const _Tp &__value = _Tp())
+        : heap(0), elements(0), cap(_N)
+    {
+        assign(__n, __value);
+    }
+
+    /**
+     * @short Construct %shsmall_vector from std vector.
+     * @param __other other vector.
+     */
+    template <typename _otherTp, typename _otherAllocT>
+    shsmall_vector(const std::vector<_otherTp, _otherAllocT> &__other)
+        : heap(0), elements(0), cap(_N)
+    {
+        assign(__other.begin(), __other.end());
+    }
+
+    /**
+     * @short Builds a %shsmall_vector from a range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    shsmall_vector(_InputIterator __first, _InputIterator __last)
+        : heap(0), elements(0), cap(_N)
+    {
+        assign(__first, __last);
+    }
+
+    /**
+     * @short Copy constructor.
+     * @param __other source vector.
+     */
+    shsmall_vector(const shsmall_vector &__other)
+        : heap(0), elements(0), cap(_N)
+    {
+        assign(__other.begin(), __other.end());
+    }
+
+#if __cplusplus >= 201103L
+    /**
+     * @short Move constructor, steals spilled buffer or moves elements.
+     * @param __other source vector.
+     */
+    shsmall_vector(shsmall_vector &&__other)
+        : heap(0), elements(0), cap(_N)
+    {
+        swap(__other);
+    }
+#endif
+
+    /**
+     * @short Destroy elements and free spilled buffer.
+     */
+    ~shsmall_vector() {
+        clear();
+        if (heap) AllocatorType_t().deallocate(heap, cap);
+    }
+
+    /**
+     * @short Assignment operator.
+     * @param __other source vector.
+     */
+    shsmall_vector &operator=(const shsmall_vector &__other) {
+        if (this != &__other) assign(__other.begin(), __other.end());
+        return *this;
+    }
+
+    /**
+     * @short Replace content by n copies of value.
+     */
+    void assign(size_type __n, const _Tp &__value) {
+        clear();
+        reserve(__n);
+        std::uninitialized_fill_n(begin(), __n, __value);
+        elements = __n;
+    }
+
+    /**
+     * @short Replace content by range.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     */
+    template <typename _InputIterator>
+    void assign(_InputIterator __first, _InputIterator __last) {
+        clear();
+        insert(end(), __first, __last);
+    }
+
+    iterator begin() { return data();}
+    const_iterator begin() const { return data();}
+    iterator end() { return data() + elements;}
+    const_iterator end() const { return data() + elements;}
+    reverse_iterator rbegin() { return reverse_iterator(end());}
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() { return reverse_iterator(begin());}
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /**
+     * @short Return count of elements.
+     */
+    size_type size() const { return elements;}
+
+    /**
+     * @short Return count of elements that fit without reallocation.
+     */
+    size_type capacity() const { return cap;}
+
+    /**
+     * @short Return true if there is no element.
+     */
+    bool empty() const { return !elements;}
+
+    /**
+     * @short Return true if elements are stored inside the object.
+     */
+    bool is_inline() const { return !heap;}
+
+    /**
+     * @short Return maximum number of elements that can be allocated.
+     */
+    size_type max_size() const { return AllocatorType_t().max_size();}
+
+    pointer data() { return heap? heap: inline_data();}
+    const_pointer data() const { return heap? heap: inline_data();}
+
+    reference operator[](size_type __n) { return data()[__n];}
+    const_reference operator[](size_type __n) const { return data()[__n];}
+
+    reference at(size_type __n) {
+        range_check(__n);
+        return data()[__n];
+    }
+
+    const_reference at(size_type __n) const {
+        range_check(__n);
+        return data()[__n];
+    }
+
+    reference front() { return *data();}
+    const_reference front() const { return *data();}
+    reference back() { return data()[elements - 1];}
+    const_reference back() const { return data()[elements - 1];}
+
+    /**
+     * @short Append copy of value.
+     * @param __value value.
+     */
+    void push_back(const _Tp &__value) {
+        if (elements == cap) {
+            // value may live in this vector
+            _Tp __copy(__value);
+            grow(elements + 1);
+            new (data() + elements) _Tp(__copy);
+        } else new (data() + elements) _Tp(__value);
+        ++elements;
+    }
+
+    /**
+     * @short Remove last element.
+     */
+    void pop_back() {
+        data()[--elements].~_Tp();
+    }
+
+    /**
+     * @short Insert value before position.
+     * @param __pos position.
+     * @param __value value.
+     * @return iterator to new element.
+     */
+    iterator insert(const_iterator __pos, const _Tp &__value) {
+        size_type __index = __pos - begin();
+        push_back(__value);
+        std::rotate(begin() + __index, end() - 1, end());
+        return begin() + __index;
+    }
+
+    /**
+     * @short Insert n copies of value before position.
+     * @param __pos position.
+     * @param __n count of copies.
+     * @param __value value.
+     * @return iterator to first new element.
+     */
+    iterator insert(const_iterator __pos, size_type __n, const _Tp &__value) {
+        size_type __index = __pos - begin();
+        _Tp __copy(__value);
+        reserve(elements + __n);
+        std::uninitialized_fill_n(end(), __n, __copy);
+        elements += __n;
+        std::rotate(begin() + __index, end() - __n, end());
+        return begin() + __index;
+    }
+
+    /**
+     * @short Insert range before position.
+     * @param __pos position.
+     * @param __first An input iterator.
+     * @param __last An input iterator.
+     * @return iterator to first new element.
+     */
+    template <typename _InputIterator>
+    iterator insert(const_iterator __pos, _InputIterator __first,
+                    _InputIterator __last)
+    {
+        return insert_dispatch(__pos, __first, __last,
+                Bool_t<std::numeric_limits<_InputIterator>::is_integer>());
+    }
+
+    /**
+     * @short Erase element at position.
+     * @param __pos valid dereferenceable iterator.
+     * @return iterator to next element.
+     */
+    iterator erase(const_iterator __pos) {
+        return erase(__pos, __pos + 1);
+    }
+
+    /**
+     * @short Erase range of elements.
+     * @param __first first erased element.
+     * @param __last end of erased range.
+     * @return iterator to element after erased ones.
+     */
+    iterator erase(const_iterator __first, const_iterator __last) {
+        iterator __dst = begin() + (__first - begin());
+        iterator __src = begin() + (__last - begin());
+        iterator __end = std::copy(__src, end(), __dst);
+        while (end() != __end) pop_back();
+        return __dst;
+    }
+
+    /**
+     * @short Destroy all elements, capacity is kept.
+     */
+    void clear() {
+        while (elements) pop_back();
+    }
+
+    /**
+     * @short Make room for at least n elements.
+     * @param __n count of elements.
+     */
+    void reserve(size_type __n) {
+        if (__n > cap) grow(__n);
+    }
+
+    /**
+     * @short Change count of elements.
+     * @param __n new count.
+     * @param __value value of appended elements.
+     */
+    void resize(size_type __n, const _Tp &__value = _Tp()) {
+        if (__n < elements) erase(begin() + __n, end());
+        else insert(end(), __n - elements, __value);
+    }
+
+    /**
+     * @short Free spare capacity, move elements back inside the object if
+     * they fit there.
+     */
+    void shrink_to_fit() {
+        if (!heap || (elements == cap)) return;
+        if (elements <= _N) relocate(inline_data(), _N);
+        else relocate(AllocatorType_t().allocate(elements), elements);
+    }
+
+    /**
+     * @short Swap content with other vector.
+     * @param __other other vector.
+     */
+    void swap(shsmall_vector &__other) {
+        if (heap && __other.heap) {
+            std::swap(heap, __other.heap);
+            std::swap(elements, __other.elements);
+            std::swap(cap, __other.cap);
+            return;
+        }
+
+        // at least one is inline, go through temporary
+        shsmall_vector __tmp;
+        __tmp.take(*this);
+        take(__other);
+        __other.take(__tmp);
+    }
+
+private:
+    /**
+     * @short Tag distinguishing (count, value) from iterator range.
+     */
+    template <bool> struct Bool_t {};
+
+    template <typename _Integer>
+    iterator insert_dispatch(const_iterator __pos, _Integer __n,
+                             _Integer __value, Bool_t<true>)
+    {
+        return insert(__pos, static_cast<size_type>(__n),
+                      static_cast<_Tp>(__value));
+    }
+
+    template <typename _InputIterator>
+    iterator insert_dispatch(const_iterator __pos, _InputIterator __first,
+                             _InputIterator __last, Bool_t<false>)
+    {
+        size_type __index = __pos - begin();
+        size_type __old = elements;
+        try {
+            for (; __first != __last; ++__first) push_back(*__first);
+        } catch (...) {
+            while (elements > __old) pop_back();
+            throw;
+        }
+        std::rotate(begin() + __index, begin() + __old, end());
+        return begin() + __index;
+    }
+
+    pointer inline_data() {
+        return reinterpret_cast<pointer>(storage);
+    }
+
+    const_pointer inline_data() const {
+        return reinterpret_cast<const_pointer>(storage);
+    }
+
+    void range_check(size_type __n) const {
+        if (__n >= elements)
+            throw std::out_of_range("shsmall_vector::range_check");
+    }
+
+    /**
+     * @short Move elements to new buffer with at least n slots.
+     */
+    void grow(size_type __n) {
+        size_type __cap = std::max(__n, 2 * cap);
+        relocate(AllocatorType_t().allocate(__cap), __cap);
+    }
+
+    /**
+     * @short Copy elements to given storage and release old one.
+     */
+    void relocate(pointer __to, size_type __cap) {
+        try {
+            std::uninitialized_copy(begin(), end(), __to);
+        } catch (...) {
+            if (__to != inline_data())
+                AllocatorType_t().deallocate(__to, __cap);
+            throw;
+        }
+        for (pointer __p = begin(); __p != end(); ++__p) __p->~_Tp();
+        if (heap) AllocatorType_t().deallocate(heap, cap);
+        heap = (__to == inline_data())? 0: __to;
+        cap = __cap;
+    }
+
+    /**
+     * @short Take content of other vector, this vector must be empty and
+     * inline.
+     */
+    void take(shsmall_vector &__other) {
+        size_type __elements = __other.elements;
+        if (__other.heap) {
+            heap = __other.heap;
+            cap = __other.cap;
+            __other.heap = 0;
+            __other.cap = _N;
+        } else {
+            std::uninitialized_copy(__other.begin(), __other.end(),
+                                    inline_data());
+            __other.clear();
+        }
+        elements = __elements;
+        __other.elements = 0;
+    }
+
+    pointer heap;           //< spilled elements or 0 if inline.
+    size_type elements;     //< count of elements.
+    size_type cap;          //< capacity.
+    __attribute__((aligned(__alignof__(_Tp))))
+    char storage[_N * sizeof(_Tp)]; //< inline elements.
+};
+
+template <typename _Tp, std::size_t _N>
+inline bool operator==(const shsmall_vector<_Tp, _N> &__x,
+                       const shsmall_vector<_Tp, _N> &__y)
+{
+    return (__x.size() == __y.size())
+        && std::equal(__x.begin(), __x.end(), __y.begin());
+}
+
+template <typename _Tp, std::size_t _N>
+inline bool operator!=(const shsmall_vector<_Tp, _N> &__x,
+                       const shsmall_vector<_Tp, _N> &__y)
+{
+    return !(__x == __y);
+}
+
+template <typename _Tp, std::size_t _N>
+inline bool operator<(const shsmall_vector<_Tp, _N> &__x,
+                      const shsmall_vector<_Tp, _N> &__y)
+{
+    return std::lexicographical_compare(__x.begin(), __x.end(),
+                                        __y.begin(), __y.end());
+}
+
+}
+
+#endif /* SHALLOCATOR_SHSMALL_VECTOR_H */
+
@@ -0,0 +1,371 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Process shared condition, event and version counter.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHSYNC_H
+#define SHALLOCATOR_SHSYNC_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <climits>
+#include <ctime>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Wait while *addr is value (shared futex, works across processes).
+ * @param addr futex word in shared memory.
+ * @param value expected value.
+ * @param timeout relative timeout or 0 for infinite wait.
+ * @return 0 if woken up (or value differs), errno otherwise.
+ */
+inline int futex_wait(uint32_t *addr, uint32_t value,
+                      const timespec *timeout = 0)
+{
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, value, timeout, 0, 0))
+        return (errno == EAGAIN)? 0: errno;
+    return 0;
+}
+
+/**
+ * @short Wake up to count processes waiting on addr.
+ * @param addr futex word in shared memory.
+ * @param count max count of woken up waiters.
+ */
+inline void futex_wake(uint32_t *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, 0, 0, 0);
+}
+
+/**
+ * @short Deadline for timed waits (CLOCK_MONOTONIC).
+ */
+class Deadline_t {
+public:
+    /**
+     * @short Create deadline msec milliseconds from now.
+     */
+    explicit Deadline_t(long msec) {
+        clock_gettime(CLOCK_MONOTONIC, &at);
+        at.tv_sec += msec / 1000;
+        at.tv_nsec += (msec % 1000) * 1000000;
+        if (at.tv_nsec >= 1000000000) {
+            at.tv_sec += 1;
+            at.tv_nsec -= 1000000000;
+        }
+    }
+
+    /**
+     * @short Compute time left to deadline.
+     * @param left time left.
+     * @return false if deadline passed.
+     */
+    bool left(timespec &left) const {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        left.tv_sec = at.tv_sec - now.tv_sec;
+        left.tv_nsec = at.tv_nsec - now.tv_nsec;
+        if (left.tv_nsec < 0) {
+            left.tv_sec -= 1;
+            left.tv_nsec += 1000000000;
+        }
+        return (left.tv_sec > 0) || ((left.tv_sec == 0) && left.tv_nsec);
+    }
+
+private:
+    timespec at;    //< absolute time of deadline.
+};
+
+/**
+ * @short Condition variable usable from all processes sharing the memory
+ * segment. Works with Mutex_t or any other process shared lock that has
+ * lock() and unlock(). Notify doesn't enter the kernel when nobody waits.
+ *
+ * Object must live in shared memory and must be created before fork.
+ */
+class Condition_t {
+public:
+    /**
+     * @short Create condition.
+     */
+    Condition_t(): sequence(0), waiters(0) {}
+
+    /**
+     * @short Unlock lock, wait for notify and lock it again. Spurious
+     * wakeups are possible, check your predicate.
+     * @param lock locked lock.
+     */
+    template <class Lock_t>
+    void wait(Lock_t &lock) {
+        uint32_t seen = enter();
+        lock.unlock();
+        futex_wait(&sequence, seen);
+        leave();
+        lock.lock();
+    }
+
+    /**
+     * @short Wait until predicate is true.
+     * @param lock locked lock.
+     * @param predicate predicate (checked with locked lock).
+     */
+    template <class Lock_t, class Predicate_t>
+    void wait(Lock_t &lock, Predicate_t predicate) {
+        while (!predicate()) wait(lock);
+    }
+
+    /**
+     * @short Wait for notify at most msec milliseconds.
+     * @param lock locked lock.
+     * @param msec timeout in milliseconds.
+     * @return false on timeout.
+     */
+    template <class Lock_t>
+    bool timed_wait(Lock_t &lock, long msec) {
+        timespec timeout = {msec / 1000, (msec % 1000) * 1000000};
+        uint32_t seen = enter();
+        lock.unlock();
+        int err = futex_wait(&sequence, seen, &timeout);
+        leave();
+        lock.lock();
+        return err != ETIMEDOUT;
+    }
+
+    /**
+     * @short Wait until predicate is true at most msec milliseconds.
+     * @param lock locked lock.
+     * @param msec timeout in milliseconds.
+     * @param predicate predicate (checked with locked lock).
+     * @return value of predicate.
+     */
+    template <class Lock_t, class Predicate_t>
+    bool timed_wait(Lock_t &lock, long msec, Predicate_t predicate) {
+        Deadline_t deadline(msec);
+        timespec left;
+        while (!predicate()) {
+            if (!deadline.left(left)) return predicate();
+            uint32_t seen = enter();
+            lock.unlock();
+            futex_wait(&sequence, seen, &left);
+            leave();
+            lock.lock();
+        }
+        return true;
+    }
+
+    /**
+     * @short Wake up one waiter.
+     */
+    void notify_one() { notify(1);}
+
+    /**
+     * @short Wake up all waiters.
+     */
+    void notify_all() { notify(INT_MAX);}
+
+private:
+    Condition_t(const Condition_t &);
+    Condition_t &operator=(const Condition_t &);
+
+    /**
+     * @short Register waiter and return sequence to wait on.
+     */
+    uint32_t enter() {
+        __atomic_fetch_add(&waiters, 1, __ATOMIC_SEQ_CST);
+        return __atomic_load_n(&sequence, __ATOMIC_SEQ_CST);
+    }
+
+    /**
+     * @short Unregister waiter.
+     */
+    void leave() { __atomic_fetch_sub(&waiters, 1, __ATOMIC_RELEASE);}
+
+    /**
+     * @short Change sequence and wake up count waiters.
+     */
+    void notify(int count) {
+        __atomic_fetch_add(&sequence, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST))
+            futex_wake(&sequence, count);
+    }
+
+    uint32_t sequence;  //< changed by each notify.
+    uint32_t waiters;   //< count of waiting processes.
+};
+
+/**
+ * @short Event usable from all processes sharing the memory segment.
+ * Manual reset event stays signaled until reset(), auto reset event is
+ * reset by the waiter that consumed it.
+ *
+ * Object must live in shared memory and must be created before fork.
+ */
+class Event_t {
+public:
+    /**
+     * @short Create non signaled event.
+     * @param auto_reset reset event when waiter consumes it.
+     */
+    explicit Event_t(bool auto_reset = false)
+        : state(0), waiters(0), automatic(auto_reset)
+    {}
+
+    /**
+     * @short Signal event and wake up waiters.
+     */
+    void set() {
+        __atomic_store_n(&state, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST))
+            futex_wake(&state, automatic? 1: INT_MAX);
+    }
+
+    /**
+     * @short Reset event.
+     */
+    void reset() { __atomic_store_n(&state, 0, __ATOMIC_RELEASE);}
+
+    /**
+     * @short Return true if event is signaled (doesn't consume it).
+     */
+    bool is_set() const { return __atomic_load_n(&state, __ATOMIC_ACQUIRE);}
+
+    /**
+     * @short Wait until event is signaled.
+     */
+    void wait() {
+        while (!try_wait()) {
+            __atomic_fetch_add(&waiters, 1, __ATOMIC_SEQ_CST);
+            futex_wait(&state, 0);
+            __atomic_fetch_sub(&waiters, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    /**
+     * @short Wait until event is signaled at most msec milliseconds.
+     * @param msec timeout in milliseconds.
+     * @return false on timeout.
+     */
+    bool timed_wait(long msec) {
+        Deadline_t deadline(msec);
+        timespec left;
+        while (!try_wait()) {
+            if (!deadline.left(left)) return try_wait();
+            __atomic_fetch_add(&waiters, 1, __ATOMIC_SEQ_CST);
+            futex_wait(&state, 0, &left);
+            __atomic_fetch_sub(&waiters, 1, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+    /**
+     * @short Consume event if it is signaled, don't wait.
+     * @return true if event was signaled.
+     */
+    bool try_wait() {
+        if (!automatic) return is_set();
+        uint32_t expected = 1;
+        return __atomic_compare_exchange_n(&state, &expected, 0, false,
+                                           __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
+
+private:
+    Event_t(const Event_t &);
+    Event_t &operator=(const Event_t &);
+
+    uint32_t state;     //< 1 if signaled.
+    uint32_t waiters;   //< count of waiting processes.
+    bool automatic;     //< auto reset event.
+};
+
+/**
+ * @short Version counter usable from all processes sharing the memory
+ * segment. Writer bumps it after it changes shared container, readers
+ * block until it differs from version they have seen.
+ *
+ * Object must live in shared memory and must be created before fork.
+ */
+class Version_t {
+public:
+    /**
+     * @short Create counter with version 0.
+     */
+    Version_t(): version(0), waiters(0) {}
+
+    /**
+     * @short Return current version.
+     */
+    uint32_t load() const { return __atomic_load_n(&version, __ATOMIC_ACQUIRE);}
+
+    /**
+     * @short Increment version and wake up all waiters.
+     * @return new version.
+     */
+    uint32_t bump() {
+        uint32_t next = __atomic_add_fetch(&version, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST))
+            futex_wake(&version, INT_MAX);
+        return next;
+    }
+
+    /**
+     * @short Wait until version differs from seen.
+     * @param seen last seen version.
+     * @return current version.
+     */
+    uint32_t wait(uint32_t seen) {
+        uint32_t current;
+        while ((current = load()) == seen) {
+            __atomic_fetch_add(&waiters, 1, __ATOMIC_SEQ_CST);
+            futex_wait(&version, seen);
+            __atomic_fetch_sub(&waiters, 1, __ATOMIC_RELEASE);
+        }
+        return current;
+    }
+
+    /**
+     * @short Wait until version differs from seen at most msec milliseconds.
+     * @param seen last seen version.
+     * @param msec timeout in milliseconds.
+     * @return current version (equal to seen on timeout).
+     */
+    uint32_t timed_wait(uint32_t seen, long msec) {
+        Deadline_t deadline(msec);
+        timespec left;
+        uint32_t current;
+        while (((current = load()) == seen) && deadline.left(left)) {
+            __atomic_fetch_add(&waiters, 1, __ATOMIC_SEQ_CST);
+            futex_wait(&version, seen, &left);
+            __atomic_fetch_sub(&waiters, 1, __ATOMIC_RELEASE);
+        }
+        return current;
+    }
+
+private:
+    Version_t(const Version_t &);
+    Version_t &operator=(const Version_t &);
+
+    uint32_t version;   //< current version.
+    uint32_t waiters;   //< count of waiting processes.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHSYNC_H */
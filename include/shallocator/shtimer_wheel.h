@@ -0,0 +1,343 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Hierarchical timer wheel in shared memory.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHTIMER_WHEEL_H
+#define SHALLOCATOR_SHTIMER_WHEEL_H
+
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+#include <shallocator/shmutex.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Hierarchical timer wheel in shared memory.
+ *
+ * Deadlines are integer ticks (milliseconds, seconds... it's up to the
+ * caller). Wheel has _Levels levels of 2^_Bits slots; level l covers
+ * 2^(_Bits * (l + 1)) ticks ahead of current tick and its slots are moved
+ * (cascaded) to lower levels as the time goes. Deadlines farther than
+ * the highest level wait in overflow list. schedule() and cancel() are
+ * O(1), expiring costs O(1) per timer plus scan of empty level 0 slots.
+ *
+ * Timers are allocated by Allocator_t and recycled by the wheel, so the
+ * handle of expired or cancelled timer stays safe to cancel. All
+ * operations hold one process shared lock; create the wheel in shared
+ * memory before fork. _Bits * _Levels must be less than 64.
+ */
+template <typename _Tp, unsigned _Bits = 8, unsigned _Levels = 4>
+class shtimer_wheel {
+    /**
+     * @short Links of timer lists (list heads are sentinels).
+     */
+    struct Link_t {
+        Link_t(): prev(this), next(this) {}
+
+        Link_t *prev;       //< previous timer.
+        Link_t *next;       //< next timer.
+    };
+
+    /**
+     * @short Scheduled timer.
+     */
+    struct Node_t: public Link_t {
+        uint64_t deadline;  //< expiration tick.
+        uint64_t seq;       //< identity of timer, changed on release.
+        _Tp value;          //< user data.
+    };
+
+public:
+    /// value type
+    typedef _Tp value_type;
+    /// size type
+    typedef std::size_t size_type;
+
+    /// count of slots on one level
+    static const unsigned SLOTS = 1u << _Bits;
+
+    /**
+     * @short Handle of scheduled timer.
+     */
+    class Timer_t {
+    public:
+        Timer_t(): node(0), seq(0) {}
+
+    private:
+        Timer_t(Node_t *__node, uint64_t __seq): node(__node), seq(__seq) {}
+        friend class shtimer_wheel;
+
+        Node_t *node;       //< timer node.
+        uint64_t seq;       //< sequence of node when scheduled.
+    };
+
+    /**
+     * @short Create empty wheel.
+     * @param __now current tick.
+     */
+    explicit shtimer_wheel(uint64_t __now = 0)
+        : now(__now), pending(0), expired(0), last_seq(0), spare(0)
+    {}
+
+    /**
+     * @short Destroy all timers.
+     */
+    ~shtimer_wheel() {
+        for (unsigned __l = 0; __l < _Levels; ++__l)
+            for (unsigned __s = 0; __s < SLOTS; ++__s)
+                destroy_list(slots[__l][__s]);
+        destroy_list(overflow);
+        destroy_list(due);
+        while (spare) {
+            Node_t *__next = static_cast<Node_t *>(spare->next);
+            Allocator_t<Node_t>().deallocate(spare, 1);
+            spare = __next;
+        }
+    }
+
+    /**
+     * @short Schedule timer.
+     * @param __deadline expiration tick, timer in past expires on next call
+     * of pop_expired()/expire().
+     * @param __value user data.
+     * @return handle for cancel().
+     */
+    Timer_t schedule(uint64_t __deadline, const _Tp &__value) {
+        ScopedLock_t<Mutex_t> __lock(mutex);
+        Node_t *__node = spare;
+        if (__node) {
+            spare = static_cast<Node_t *>(__node->next);
+        } else {
+            __node = Allocator_t<Node_t>().allocate(1);
+        }
+        try {
+            new (&__node->value) _Tp(__value);
+        } catch (...) {
+            __node->next = spare;
+            spare = __node;
+            throw;
+        }
+        __node->deadline = __deadline;
+        __node->seq = ++last_seq;
+        place(__node);
+        return Timer_t(__node, __node->seq);
+    }
+
+    /**
+     * @short Cancel timer.
+     * @param __timer handle from schedule().
+     * @return false if timer has already been expired or cancelled.
+     */
+    bool cancel(const Timer_t &__timer) {
+        if (!__timer.node) return false;
+        ScopedLock_t<Mutex_t> __lock(mutex);
+        if (__timer.node->seq != __timer.seq) return false;
+        unlink(__timer.node);
+        if (__timer.node->deadline <= now) --expired;
+        else --pending;
+        release(__timer.node);
+        return true;
+    }
+
+    /**
+     * @short Advance wheel to tick and remove one expired timer.
+     * @param __now current tick (wheel never goes back).
+     * @param __value user data of expired timer.
+     * @return false if no timer expired.
+     */
+    bool pop_expired(uint64_t __now, _Tp &__value) {
+        ScopedLock_t<Mutex_t> __lock(mutex);
+        advance(__now);
+        if (!expired) return false;
+        Node_t *__node = static_cast<Node_t *>(due.next);
+        __value = __node->value;
+        unlink(__node);
+        --expired;
+        release(__node);
+        return true;
+    }
+
+    /**
+     * @short Advance wheel to tick and remove all expired timers.
+     * @param __now current tick (wheel never goes back).
+     * @param __out container with push_back() receiving user data.
+     * @return count of expired timers.
+     */
+    template <typename _Container>
+    size_type expire(uint64_t __now, _Container &__out) {
+        ScopedLock_t<Mutex_t> __lock(mutex);
+        advance(__now);
+        size_type __count = 0;
+        for (; expired; --expired, ++__count) {
+            Node_t *__node = static_cast<Node_t *>(due.next);
+            __out.push_back(__node->value);
+            unlink(__node);
+            release(__node);
+        }
+        return __count;
+    }
+
+    /**
+     * @short Return count of scheduled (and not yet removed) timers.
+     */
+    size_type size() const {
+        return __atomic_load_n(&pending, __ATOMIC_RELAXED)
+             + __atomic_load_n(&expired, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @short Return true if there is no timer.
+     */
+    bool empty() const { return !size();}
+
+    /**
+     * @short Return tick the wheel has been advanced to.
+     */
+    uint64_t current() const { return __atomic_load_n(&now, __ATOMIC_RELAXED);}
+
+private:
+    shtimer_wheel(const shtimer_wheel &);
+    shtimer_wheel &operator=(const shtimer_wheel &);
+
+    static const uint64_t MASK = SLOTS - 1;
+
+    /// wheel must not cover whole 64-bit tick range
+    typedef char LevelsCheck_t[(_Bits * _Levels < 64)? 1: -1];
+
+    static void link_back(Link_t &__list, Link_t *__link) {
+        __link->prev = __list.prev;
+        __link->next = &__list;
+        __list.prev->next = __link;
+        __list.prev = __link;
+    }
+
+    static void unlink(Link_t *__link) {
+        __link->prev->next = __link->next;
+        __link->next->prev = __link->prev;
+    }
+
+    /**
+     * @short Put timer to due list, slot of the level where its deadline
+     * first differs from current tick, or to overflow list.
+     */
+    void place(Node_t *__node) {
+        if (__node->deadline <= now) {
+            link_back(due, __node);
+            ++expired;
+            return;
+        }
+        ++pending;
+        uint64_t __diff = __node->deadline ^ now;
+        unsigned __l = 0;
+        while (__l < _Levels && (__diff >> (_Bits * (__l + 1)))) ++__l;
+        if (__l < _Levels) {
+            link_back(slots[__l][(__node->deadline >> (_Bits * __l)) & MASK],
+                      __node);
+            return;
+        }
+        link_back(overflow, __node);
+    }
+
+    /**
+     * @short Place again all timers of list.
+     */
+    void cascade(Link_t &__list) {
+        Link_t __tmp;
+        if (__list.next == &__list) return;
+        __tmp.next = __list.next;
+        __tmp.prev = __list.prev;
+        __tmp.next->prev = &__tmp;
+        __tmp.prev->next = &__tmp;
+        __list.next = __list.prev = &__list;
+        while (__tmp.next != &__tmp) {
+            Node_t *__node = static_cast<Node_t *>(__tmp.next);
+            unlink(__node);
+            --pending;
+            place(__node);
+        }
+    }
+
+    /**
+     * @short Move time forward and collect expired timers to due list.
+     */
+    void advance(uint64_t __to) {
+        while (now < __to) {
+            if (!pending) {
+                __atomic_store_n(&now, __to, __ATOMIC_RELAXED);
+                return;
+            }
+
+            // skip empty level 0 slots up to end of current round
+            uint64_t __next = (now | MASK) + 1;
+            for (uint64_t __s = (now & MASK) + 1; __s <= MASK; ++__s) {
+                if (slots[0][__s].next != &slots[0][__s]) {
+                    __next = (now & ~MASK) | __s;
+                    break;
+                }
+            }
+            if (__next > __to) {
+                __atomic_store_n(&now, __to, __ATOMIC_RELAXED);
+                return;
+            }
+            __atomic_store_n(&now, __next, __ATOMIC_RELAXED);
+
+            // new round of some levels, higher levels go first
+            if (!(now & MASK)) {
+                unsigned __l = 1;
+                while (__l < _Levels && !((now >> (_Bits * __l)) & MASK))
+                    ++__l;
+                if (__l == _Levels) cascade(overflow);
+                else cascade(slots[__l][(now >> (_Bits * __l)) & MASK]);
+                while (--__l > 0)
+                    cascade(slots[__l][0]);
+            }
+            cascade(slots[0][now & MASK]);
+        }
+    }
+
+    void release(Node_t *__node) {
+        __node->value.~_Tp();
+        ++__node->seq;
+        __node->next = spare;
+        spare = __node;
+    }
+
+    void destroy_list(Link_t &__list) {
+        while (__list.next != &__list) {
+            Node_t *__node = static_cast<Node_t *>(__list.next);
+            unlink(__node);
+            __node->value.~_Tp();
+            Allocator_t<Node_t>().deallocate(__node, 1);
+        }
+    }
+
+    Mutex_t mutex;                      //< lock of whole wheel.
+    uint64_t now;                       //< current tick.
+    size_type pending;                  //< count of timers in future.
+    size_type expired;                  //< count of timers in due list.
+    uint64_t last_seq;                  //< last used timer sequence.
+    Node_t *spare;                      //< released nodes (linked by next).
+    Link_t due;                         //< expired timers.
+    Link_t overflow;                    //< timers beyond highest level.
+    Link_t slots[_Levels][SLOTS];       //< wheel levels.
+};
+
+}
+
+#endif /* SHALLOCATOR_SHTIMER_WHEEL_H */
+
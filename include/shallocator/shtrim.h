@@ -0,0 +1,77 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Return free pool pages to the kernel.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#ifndef SHALLOCATOR_SHTRIM_H
+#define SHALLOCATOR_SHTRIM_H
+
+#include <ctime>
+#include <shallocator/shalloc.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Default max count of free bytes held by trim_pool() at once.
+ */
+const std::size_t TRIM_MAX_HOLD = 64 * 1024 * 1024;
+
+/**
+ * @short Return whole pages of free libmm blocks to the kernel.
+ *
+ * libmm keeps freed memory in its free list and touched pages stay
+ * resident forever. libmm has no interface to walk its free list, so
+ * free blocks are taken from libmm, biggest first, their whole pages are
+ * released by madvise(MADV_REMOVE) and blocks are given back. Pages are
+ * backed by the kernel again (zeroed) when they are reused.
+ *
+ * Pool lock can't be held meanwhile (MM_malloc() takes it itself), so
+ * taken blocks are missing in the pool until the trim returns: allocations
+ * of other processes that don't fit to the rest of the pool fail by
+ * std::bad_alloc and pressure callbacks fire PRESSURE_EXHAUSTED. The trim
+ * holds at most max_hold bytes and leaves at least reserve bytes free;
+ * free space over max_hold is not released by this call. Run it when the
+ * pool is not under allocation pressure (e.g. after big clear() before
+ * reload) or keep a reserve big enough for allocations of other
+ * processes.
+ *
+ * @param min_block smaller free blocks are skipped.
+ * @param reserve stop when less than this is left free in the pool.
+ * @param max_hold max count of bytes held at once, 0 means unlimited.
+ * @return count of bytes returned to the kernel.
+ */
+std::size_t trim_pool(std::size_t min_block = 64 * 1024,
+                      std::size_t reserve = 0,
+                      std::size_t max_hold = TRIM_MAX_HOLD);
+
+/**
+ * @short Call trim_pool() if at least interval seconds passed since last
+ * trim in this process. Intended for main loop of one (master) process.
+ * @param interval min seconds between trims.
+ * @param min_block smaller free blocks are skipped.
+ * @param reserve stop when less than this is left free in the pool.
+ * @param max_hold max count of bytes held at once, 0 means unlimited.
+ * @return count of bytes returned to the kernel (0 if trim was not due).
+ */
+std::size_t trim_pool_periodic(std::time_t interval,
+                               std::size_t min_block = 64 * 1024,
+                               std::size_t reserve = 0,
+                               std::size_t max_hold = TRIM_MAX_HOLD);
+
+}
+
+#endif /* SHALLOCATOR_SHTRIM_H */
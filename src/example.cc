@@ -18,6 +18,7 @@
  */
 
 #include <errno.h>
+#include <sys/wait.h>
 #include <iostream>
 #include <shallocator/shalloc.h>
 #include <shallocator/shstring.h>
@@ -30,6 +31,7 @@
 #include <shallocator/shdeque.h>
 #include <shallocator/shstack.h>
 #include <shallocator/shmemory.h>
+#include <shallocator/shsync.h>
 
 /**
  * @short Simple sh mem holder, parent proces destroy MM struct.
@@ -81,7 +83,8 @@ typedef SHAllocator::shstack<
 
 /*
  * This is very simple example. If you want SHAllocator use in real word, you
- * need synchronized acces to sh allocated structures propably by semaphores.
+ * need synchronized acces to sh allocated structures propably by Mutex_t
+ * (shmutex.h). Parent and child take turns here by events (shsync.h).
  */
 int main() {
 #if 0
@@ -168,8 +171,14 @@ int main() {
     Stack_t *stack = new (SHAllocator::SHAlloc) Stack_t();
     stack->push("nula");
 
+    // events must be created before fork
+    SHAllocator::Event_t *parent_done
+        = new (SHAllocator::SHAlloc) SHAllocator::Event_t();
+    SHAllocator::Event_t *child_done
+        = new (SHAllocator::SHAlloc) SHAllocator::Event_t();
+
     // do fork
-    if (fork()) {
+    if (pid_t child = fork()) {
         // PARENT
 
         set->insert("franta");
@@ -212,8 +221,9 @@ int main() {
         stack->push("dva");
         stack->push("tri");
 
-        // wait for child change map
-        sleep(2);
+        // let child read data and wait for child change map
+        parent_done->set();
+        child_done->wait();
 
         // dump map
         for (Map_t::const_iterator it = map->begin(); it != map->end(); ++it)
@@ -227,7 +237,7 @@ int main() {
             std::cout << "PARENT: MULTISET IS EMPTY" << std::endl;
 
         // wait while child exit
-        sleep(1);
+        waitpid(child, 0, 0);
 
         // dump vector
         for (Vector_t::const_iterator it = vector->begin();
@@ -246,6 +256,9 @@ int main() {
         SHAllocator::destroy(list);
         SHAllocator::destroy(multiset);
         SHAllocator::destroy(multimap);
+        SHAllocator::destroy(stack);
+        SHAllocator::destroy(parent_done);
+        SHAllocator::destroy(child_done);
 
     } else {
         // CHILD
@@ -254,7 +267,7 @@ int main() {
 #endif
 
         // wait for parent change map
-        sleep(1);
+        parent_done->wait();
 
         // dump map
         for (Map_t::const_iterator it = map->begin(); it != map->end(); ++it)
@@ -302,7 +315,8 @@ int main() {
         map->erase(4);
         map->erase(5);
 
-        sleep(1);
+        // let parent dump changes
+        child_done->set();
 
 #if 0
         MM_display_info();
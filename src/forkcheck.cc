@@ -0,0 +1,323 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Checks of structures shared by forked processes.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <shallocator/shalloc.h>
+#include <shallocator/shsync.h>
+#include <shallocator/shper_process.h>
+#include <shallocator/shmetrics.h>
+#include <shallocator/shpressure.h>
+#include <shallocator/shbtree_map.h>
+
+using namespace SHAllocator;
+
+namespace {
+
+/// count of failed checks
+unsigned failures = 0;
+
+/**
+ * @short Report result of one check.
+ * @param ok result.
+ * @param what description of check.
+ */
+void check(bool ok, const char *what) {
+    std::cout << (ok? "OK: ": "FAIL: ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+/**
+ * @short Wait for child and return true if it exited with zero status.
+ */
+bool child_ok(pid_t child) {
+    int status;
+    while (waitpid(child, &status, 0) < 0)
+        if (errno != EINTR) return false;
+    return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+/**
+ * @short Create object with cache line aligned slots in shared memory.
+ */
+template <typename _Tp>
+_Tp *create_aligned() {
+    return new (Allocator_t<_Tp>().allocate_aligned(1)) _Tp();
+}
+
+/**
+ * @short Destroy object from create_aligned().
+ */
+template <typename _Tp>
+void destroy_aligned(_Tp *object) {
+    object->~_Tp();
+    Allocator_t<_Tp>().deallocate_aligned(object, 1);
+}
+
+typedef shper_process<long, 4> Slots_t;
+
+/**
+ * @short Count slots owned by this process.
+ */
+struct Owned_t {
+    Owned_t(): count(0) {}
+    void operator()(pid_t pid, long) { if (pid == getpid()) ++count;}
+    unsigned count;
+};
+
+/**
+ * @short Fork children that take slot, add one and wait for event.
+ */
+void fork_slot_holders(Slots_t *slots, Event_t *release, unsigned count,
+                       std::vector<pid_t> &children)
+{
+    for (unsigned i = 0; i < count; ++i) {
+        if (pid_t child = fork()) {
+            children.push_back(child);
+            continue;
+        }
+        ++slots->local();
+        release->wait();
+        _exit(0);
+    }
+}
+
+/**
+ * @short Slots of per process values are claimed once per process,
+ * released on release() and reclaimed after their owners died.
+ */
+void test_per_process() {
+    Slots_t *slots = create_aligned<Slots_t>();
+    Event_t *release = new (SHAlloc) Event_t();
+    std::vector<pid_t> children;
+
+    // three children and parent own all four slots
+    fork_slot_holders(slots, release, 3, children);
+    while (slots->sum() != 3) usleep(1000);
+    slots->local() += 10;
+    slots->local() += 10;
+    check(slots->for_each(Owned_t()).count == 1,
+          "per process: process owns one slot");
+
+    // fifth process finds no slot of dead process
+    pid_t child = fork();
+    if (!child) _exit(slots->try_local()? 1: 0);
+    check(child_ok(child), "per process: no slot while owners live");
+
+    release->set();
+    bool ok = true;
+    for (std::size_t i = 0; i < children.size(); ++i)
+        ok = child_ok(children[i]) && ok;
+    check(ok && (slots->reclaim() == 3),
+          "per process: slots of dead children reclaimed");
+    check(slots->sum() == 23, "per process: reclaimed values kept");
+
+    // new children take reclaimed slots, released slot goes to next one
+    children.clear();
+    release->reset();
+    fork_slot_holders(slots, release, 3, children);
+    while (slots->sum() != 26) usleep(1000);
+    slots->release();
+    check(slots->for_each(Owned_t()).count == 0,
+          "per process: slot released");
+    child = fork();
+    if (!child) {
+        long *value = slots->try_local();
+        _exit((value && (*value == 20))? 0: 1);
+    }
+    check(child_ok(child), "per process: released slot claimed with value");
+
+    release->set();
+    for (std::size_t i = 0; i < children.size(); ++i)
+        child_ok(children[i]);
+    destroy(release);
+    destroy_aligned(slots);
+}
+
+typedef shmetrics<> Metrics_t;
+
+/**
+ * @short Return value of metric from snapshot.
+ */
+int64_t metric_value(const Metrics_t *metrics, const char *name) {
+    std::vector<MetricSample_t> samples = metrics->snapshot();
+    for (std::size_t i = 0; i < samples.size(); ++i)
+        if (samples[i].name == name) return samples[i].value;
+    return -1;
+}
+
+/**
+ * @short Counters of all processes are summed, gauges are shared.
+ */
+void test_metrics() {
+    Metrics_t *metrics = create_aligned<Metrics_t>();
+    Metrics_t::Counter_t requests = metrics->counter("requests");
+    Metrics_t::Gauge_t workers = metrics->gauge("workers");
+    workers.set(1);
+
+    std::vector<pid_t> children;
+    for (unsigned i = 0; i < 4; ++i) {
+        if (pid_t child = fork()) {
+            children.push_back(child);
+            continue;
+        }
+        for (unsigned j = 0; j < 1000; ++j) requests.inc();
+        workers.add(1);
+        _exit(0);
+    }
+    bool ok = true;
+    for (std::size_t i = 0; i < children.size(); ++i)
+        ok = child_ok(children[i]) && ok;
+    requests.inc(5);
+
+    check(ok && (metric_value(metrics, "requests") == 4005),
+          "metrics: counters of exited children summed");
+    check(metric_value(metrics, "workers") == 5,
+          "metrics: gauge shared by processes");
+    workers.set(2);
+    check(metric_value(metrics, "workers") == 2,
+          "metrics: gauge set overrides values of children");
+
+    destroy_aligned(metrics);
+}
+
+/// pressure events seen by this process
+unsigned pressure_events[PRESSURE_EXHAUSTED + 1];
+
+/**
+ * @short Count pressure events of this process.
+ */
+void count_pressure(PressureEvent_t event, std::size_t, std::size_t, void *) {
+    ++pressure_events[event];
+}
+
+/**
+ * @short Child crosses watermarks, parent fires its callbacks on next
+ * check as well.
+ */
+void test_pressure() {
+    Event_t *crossed = new (SHAlloc) Event_t();
+    Event_t *checked = new (SHAlloc) Event_t();
+    std::size_t capacity = MM_available();
+    enable_pressure(capacity / 2, capacity / 4, capacity, 1);
+    add_pressure_callback(count_pressure);
+
+    pid_t child = fork();
+    if (!child) {
+        std::vector<void *> blocks;
+        while (pressure_level() != PRESSURE_HIGH)
+            blocks.push_back(shmalloc(capacity / 64));
+        bool ok = pressure_events[PRESSURE_HIGH] == 1;
+        crossed->set();
+        checked->wait();
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+            shfree(blocks[i]);
+        ok = (check_pressure() == PRESSURE_NORMAL)
+            && (pressure_events[PRESSURE_NORMAL] == 1) && ok;
+        _exit(ok? 0: 1);
+    }
+
+    crossed->wait();
+    check(pressure_events[PRESSURE_HIGH] == 0,
+          "pressure: no event before check");
+    check((check_pressure() == PRESSURE_HIGH)
+          && (pressure_events[PRESSURE_HIGH] == 1),
+          "pressure: high level seen by other process");
+    check((check_pressure() == PRESSURE_HIGH)
+          && (pressure_events[PRESSURE_HIGH] == 1),
+          "pressure: high event fired once");
+    checked->set();
+    check(child_ok(child), "pressure: child crossed high and low watermark");
+    check((check_pressure() == PRESSURE_NORMAL)
+          && (pressure_events[PRESSURE_NORMAL] == 1),
+          "pressure: normal level seen by other process");
+
+    remove_pressure_callback(count_pressure);
+    disable_pressure();
+    destroy(crossed);
+    destroy(checked);
+}
+
+typedef shbtree_map<int, int> BTree_t;
+
+/**
+ * @short Return true if maps hold the same items.
+ */
+bool same_items(const BTree_t &a, const BTree_t &b) {
+    if (a.size() != b.size()) return false;
+    BTree_t::const_iterator ia = a.begin();
+    for (BTree_t::const_iterator ib = b.begin(); ib != b.end(); ++ia, ++ib)
+        if ((ia->first != ib->first) || (ia->second != ib->second))
+            return false;
+    return true;
+}
+
+/**
+ * @short Parallel bulk_load() by forked workers gives the same map as
+ * serial one and rejects the same ranges.
+ */
+void test_bulk_load() {
+    std::vector<std::pair<int, int> > items;
+    for (int i = 0; i < 100000; ++i)
+        items.push_back(std::make_pair(i * 3, i));
+
+    BTree_t serial;
+    BTree_t parallel;
+    serial.bulk_load(items.begin(), items.end());
+    parallel.bulk_load(items.begin(), items.end(), 4);
+    check((serial.size() == items.size()) && same_items(serial, parallel),
+          "bulk_load: parallel load equals serial one");
+
+    // duplicate key at the boundary of worker slices
+    items[items.size() / 2].first = items[items.size() / 2 - 1].first;
+    bool serial_thrown = false;
+    bool parallel_thrown = false;
+    try {
+        serial.bulk_load(items.begin(), items.end());
+    } catch (const std::invalid_argument &) { serial_thrown = true;}
+    try {
+        parallel.bulk_load(items.begin(), items.end(), 4);
+    } catch (const std::invalid_argument &) { parallel_thrown = true;}
+    check(serial_thrown && parallel_thrown && serial.empty()
+          && parallel.empty(), "bulk_load: duplicate keys rejected");
+}
+
+}
+
+int main() {
+    if (!MM_create(64 * 1024 * 1024, 0)) {
+        std::cout << "NOTCREATE: " << MM_error() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    test_per_process();
+    test_metrics();
+    test_bulk_load();
+    // fills the pool, keep it last
+    test_pressure();
+
+    MM_destroy();
+    return failures? EXIT_FAILURE: EXIT_SUCCESS;
+}
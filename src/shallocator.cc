@@ -26,10 +26,16 @@ namespace SHAllocator {
  */
 SHAlloc_t *SHAlloc = 0;
 
+/**
+ * @short Allocation hook of this process.
+ */
+AllocHook_t SHAllocHook = 0;
+
 }
 
 //
-// Lib is empty. All lib function is in C++ templates in header files.
+// Almost all lib function is in C++ templates in header files. Here is
+// only global state of allocator and its non template helpers.
 //
 
 /*
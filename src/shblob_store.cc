@@ -0,0 +1,208 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Compressed store of cold blobs.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <cstring>
+#include <stdint.h>
+#include <stdexcept>
+#include <shallocator/shblob_store.h>
+
+namespace SHAllocator {
+
+namespace {
+
+/**
+ * Block is sequence of
+ *     token: high nibble literal length, low nibble match length - 4
+ *     [255...] rest of literal length if nibble is 15
+ *     literals
+ *     offset: 2 bytes little endian, distance of match back in output
+ *     [255...] rest of match length if nibble is 15
+ * The last sequence has literals only and ends the block.
+ */
+
+/// min length of match
+const std::size_t MIN_MATCH = 4;
+/// max distance of match
+const std::size_t MAX_OFFSET = 65535;
+/// bits of position table index
+const unsigned HASH_BITS = 12;
+/// matches don't start in last bytes (literals are cheaper there)
+const std::size_t LAST_LITERALS = 5;
+/// shorter blocks are literals only
+const std::size_t MIN_BLOCK = 13;
+
+typedef unsigned char Byte_t;
+
+inline uint32_t read32(const Byte_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline unsigned hash32(uint32_t value) {
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * @short Write rest of length over nibble.
+ */
+inline Byte_t *write_length(Byte_t *op, std::size_t length) {
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = static_cast<Byte_t>(length);
+    return op;
+}
+
+/**
+ * @short Read rest of length over nibble.
+ */
+inline std::size_t read_length(const Byte_t *&ip, const Byte_t *end) {
+    std::size_t length = 0;
+    for (Byte_t byte = 255; byte == 255; length += byte) {
+        if (ip == end) throw std::runtime_error("blob: corrupted block");
+        byte = *ip++;
+    }
+    return length;
+}
+
+/**
+ * @short Write one sequence, return 0 if it doesn't fit.
+ * @param match length of match, 0 for the last sequence.
+ */
+Byte_t *write_sequence(Byte_t *op, Byte_t *end, const Byte_t *literals,
+                       std::size_t length, std::size_t offset,
+                       std::size_t match)
+{
+    // worst case size of sequence
+    std::size_t need = 1 + length / 255 + 1 + length
+        + (match? 2 + match / 255 + 1: 0);
+    if (need > static_cast<std::size_t>(end - op)) return 0;
+
+    Byte_t *token = op++;
+    *token = static_cast<Byte_t>(((length < 15)? length: 15) << 4);
+    if (length >= 15) op = write_length(op, length - 15);
+    std::memcpy(op, literals, length);
+    op += length;
+    if (!match) return op;
+
+    *op++ = static_cast<Byte_t>(offset);
+    *op++ = static_cast<Byte_t>(offset >> 8);
+    match -= MIN_MATCH;
+    *token = static_cast<Byte_t>(*token | ((match < 15)? match: 15));
+    if (match >= 15) op = write_length(op, match - 15);
+    return op;
+}
+
+}
+
+std::size_t blob_compress(const char *src, std::size_t size,
+                          char *dst, std::size_t capacity)
+{
+    const Byte_t *in = reinterpret_cast<const Byte_t *>(src);
+    const Byte_t *ip = in;
+    const Byte_t *anchor = in;
+    const Byte_t *end = in + size;
+    Byte_t *out = reinterpret_cast<Byte_t *>(dst);
+    Byte_t *op = out;
+    Byte_t *oend = out + capacity;
+
+    if (size >= MIN_BLOCK) {
+        // positions of last occurrences of 4 byte prefixes
+        uint32_t table[1 << HASH_BITS];
+        std::memset(table, 0, sizeof(table));
+        const Byte_t *limit = end - MIN_BLOCK + 1;
+        const Byte_t *match_end = end - LAST_LITERALS;
+
+        while (ip < limit) {
+            uint32_t sequence = read32(ip);
+            unsigned h = hash32(sequence);
+            const Byte_t *ref = in + table[h];
+            table[h] = static_cast<uint32_t>(ip - in);
+            if ((ref >= ip) || (std::size_t(ip - ref) > MAX_OFFSET)
+                || (read32(ref) != sequence))
+            {
+                // skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            while ((ip > anchor) && (ref > in) && (ip[-1] == ref[-1])) {
+                --ip;
+                --ref;
+            }
+            std::size_t match = MIN_MATCH;
+            while ((ip + match < match_end) && (ip[match] == ref[match]))
+                ++match;
+
+            op = write_sequence(op, oend, anchor, std::size_t(ip - anchor),
+                                std::size_t(ip - ref), match);
+            if (!op) return 0;
+            ip += match;
+            anchor = ip;
+            if (ip - 2 >= in)
+                table[hash32(read32(ip - 2))]
+                    = static_cast<uint32_t>(ip - 2 - in);
+        }
+    }
+
+    op = write_sequence(op, oend, anchor, std::size_t(end - anchor), 0, 0);
+    return op? std::size_t(op - out): 0;
+}
+
+std::size_t blob_decompress(const char *src, std::size_t size,
+                            char *dst, std::size_t capacity)
+{
+    const Byte_t *ip = reinterpret_cast<const Byte_t *>(src);
+    const Byte_t *end = ip + size;
+    Byte_t *out = reinterpret_cast<Byte_t *>(dst);
+    Byte_t *op = out;
+    Byte_t *oend = out + capacity;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+        std::size_t length = token >> 4;
+        if (length == 15) length += read_length(ip, end);
+        if ((length > std::size_t(end - ip)) || (length > std::size_t(oend - op)))
+            throw std::runtime_error("blob: corrupted block");
+        std::memcpy(op, ip, length);
+        op += length;
+        ip += length;
+        if (ip == end) break;
+
+        if (end - ip < 2) throw std::runtime_error("blob: corrupted block");
+        std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+        std::size_t match = (token & 15) + MIN_MATCH;
+        if ((token & 15) == 15) match += read_length(ip, end);
+        if (!offset || (offset > std::size_t(op - out))
+            || (match > std::size_t(oend - op)))
+            throw std::runtime_error("blob: corrupted block");
+
+        const Byte_t *ref = op - offset;
+        if (offset >= match) {
+            std::memcpy(op, ref, match);
+            op += match;
+        } else {
+            // overlapping match repeats last offset bytes
+            for (; match; --match) *op++ = *ref++;
+        }
+    }
+    return std::size_t(op - out);
+}
+
+}
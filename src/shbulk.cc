@@ -0,0 +1,122 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Parallel bulk load of shared containers.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include <vector>
+#include <stdexcept>
+#include <shallocator/shbulk.h>
+
+namespace SHAllocator {
+
+namespace {
+
+/**
+ * @short Exit statuses of bulk worker, they carry type of exception.
+ */
+enum WorkerStatus_t {
+    WORKER_OK = 0,
+    WORKER_BAD_ALLOC = 1,
+    WORKER_INVALID_ARGUMENT = 2,
+    WORKER_FAILED = 3
+};
+
+/**
+ * @short Run work in forked child and exit.
+ */
+void run_child(BulkWork_t work, unsigned worker, void *arg) {
+    int status = WORKER_OK;
+    try {
+        work(worker, arg);
+    } catch (const std::bad_alloc &) {
+        status = WORKER_BAD_ALLOC;
+    } catch (const std::invalid_argument &) {
+        status = WORKER_INVALID_ARGUMENT;
+    } catch (...) {
+        status = WORKER_FAILED;
+    }
+    _exit(status);
+}
+
+/**
+ * @short Wait for child and return its status.
+ */
+int wait_child(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) return WORKER_FAILED;
+    if (!WIFEXITED(status)) return WORKER_FAILED;
+    return WEXITSTATUS(status);
+}
+
+}
+
+unsigned bulk_workers(std::size_t items, unsigned workers,
+                      std::size_t grain)
+{
+    if (!workers) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 0)? static_cast<unsigned>(cpus): 1;
+    }
+    std::size_t limit = grain? items / grain: items;
+    if (limit < workers) workers = static_cast<unsigned>(limit);
+    return workers? workers: 1;
+}
+
+void run_bulk_workers(unsigned workers, BulkWork_t work, void *arg) {
+    // fork children for works 1..n, this process takes the rest
+    std::vector<pid_t> children;
+    children.reserve(workers);
+    unsigned worker = 1;
+    for (; worker < workers; ++worker) {
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (!pid) run_child(work, worker, arg);
+        children.push_back(pid);
+    }
+
+    try {
+        work(0, arg);
+        for (; worker < workers; ++worker) work(worker, arg);
+    } catch (...) {
+        for (std::size_t i = 0; i < children.size(); ++i)
+            wait_child(children[i]);
+        throw;
+    }
+
+    int status = WORKER_OK;
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        int child = wait_child(children[i]);
+        if (child > status) status = child;
+    }
+    switch (status) {
+    case WORKER_OK:
+        return;
+    case WORKER_BAD_ALLOC:
+        throw std::bad_alloc();
+    case WORKER_INVALID_ARGUMENT:
+        throw std::invalid_argument("bulk worker: invalid argument");
+    default:
+        throw std::runtime_error("bulk worker failed");
+    }
+}
+
+}
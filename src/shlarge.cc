@@ -0,0 +1,189 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Large allocation area.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <new>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shlarge.h>
+#include <shallocator/shmutex.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Large allocation area of this process.
+ */
+LargeAreaInfo_t SHLargeArea = {0, 0, 0};
+
+namespace {
+
+/// granule is used by block but it's not first one
+const uint32_t CONTINUATION = ~uint32_t(0);
+
+/**
+ * @short Header at the beginning of the mapping, shared by all processes.
+ */
+struct AreaHeader_t {
+    Mutex_t mutex;          //< lock of granule map.
+    std::size_t mapped;     //< size of whole mapping.
+    std::size_t granule;    //< allocation unit.
+    std::size_t granules;   //< count of granules.
+    std::size_t used;       //< used granules.
+    std::size_t blocks;     //< live blocks.
+    char *data;             //< first granule.
+    uint32_t runs[1];       //< 0 free, n start of n granules, CONTINUATION.
+};
+
+/**
+ * @short Header of area of this process.
+ */
+AreaHeader_t *header = 0;
+
+/**
+ * @short Return pages of range to the OS.
+ */
+void release_pages(void *ptr, std::size_t size) {
+    // MADV_REMOVE frees shmem backing store, DONTNEED is only fallback
+    // for kernels/mappings that don't support it
+    if (madvise(ptr, size, MADV_REMOVE))
+        madvise(ptr, size, MADV_DONTNEED);
+}
+
+}
+
+void create_large_area(std::size_t size, std::size_t threshold,
+                       std::size_t granule)
+{
+    if (header)
+        throw std::runtime_error("create_large_area: area already exists");
+
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    if (!granule || (granule % page))
+        throw std::runtime_error("create_large_area: granule must be "
+                                 "multiple of page size");
+    std::size_t granules = (size + granule - 1) / granule;
+    if (!granules || (granules >= CONTINUATION))
+        throw std::runtime_error("create_large_area: invalid size");
+
+    // header occupies first granules
+    std::size_t head = sizeof(AreaHeader_t) + granules * sizeof(uint32_t);
+    head = (head + granule - 1) / granule * granule;
+    std::size_t mapped = head + granules * granule;
+
+    void *base = mmap(0, mapped, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+        throw std::runtime_error("create_large_area: can't map area");
+
+    // fresh anonymous mapping is zeroed, all granules are free
+    AreaHeader_t *area = static_cast<AreaHeader_t *>(base);
+    try {
+        new (&area->mutex) Mutex_t();
+    } catch (...) {
+        munmap(base, mapped);
+        throw;
+    }
+    area->mapped = mapped;
+    area->granule = granule;
+    area->granules = granules;
+    area->data = static_cast<char *>(base) + head;
+#ifdef MADV_HUGEPAGE
+    madvise(area->data, granules * granule, MADV_HUGEPAGE);
+#endif
+
+    header = area;
+    SHLargeArea.begin = area->data;
+    SHLargeArea.end = area->data + granules * granule;
+    SHLargeArea.threshold = threshold? threshold: 1;
+}
+
+void destroy_large_area() {
+    if (!header) return;
+    AreaHeader_t *area = header;
+    header = 0;
+    SHLargeArea.begin = SHLargeArea.end = 0;
+    SHLargeArea.threshold = 0;
+    area->mutex.~Mutex_t();
+    munmap(area, area->mapped);
+}
+
+LargeAreaStats_t large_area_stats() {
+    LargeAreaStats_t stats = {0, 0, 0, 0};
+    if (!header) return stats;
+    ScopedLock_t<Mutex_t> lock(header->mutex);
+    stats.capacity = header->granules * header->granule;
+    stats.used = header->used * header->granule;
+    stats.blocks = header->blocks;
+    stats.granule = header->granule;
+    return stats;
+}
+
+void *large_allocate(std::size_t size) {
+    if (!header) return 0;
+    std::size_t need = (size + header->granule - 1) / header->granule;
+    if (!need) need = 1;
+
+    ScopedLock_t<Mutex_t> lock(header->mutex);
+    if (header->granules - header->used < need) return 0;
+
+    // first fit, allocated runs are skipped as a whole
+    uint32_t *runs = header->runs;
+    for (std::size_t i = 0; i + need <= header->granules;) {
+        if (runs[i]) {
+            i += runs[i];
+            continue;
+        }
+        std::size_t j = i;
+        while ((j < i + need) && !runs[j]) ++j;
+        if (j == i + need) {
+            runs[i] = static_cast<uint32_t>(need);
+            for (std::size_t k = i + 1; k < j; ++k) runs[k] = CONTINUATION;
+            header->used += need;
+            ++header->blocks;
+            return header->data + i * header->granule;
+        }
+        i = j;
+    }
+    return 0;
+}
+
+void large_deallocate(void *ptr) {
+    if (!header || !ptr) return;
+    std::size_t offset = static_cast<std::size_t>(
+            static_cast<char *>(ptr) - header->data);
+    std::size_t i = offset / header->granule;
+    if ((offset % header->granule) || (i >= header->granules)) return;
+
+    uint32_t *runs = header->runs;
+    std::size_t count = __atomic_load_n(runs + i, __ATOMIC_RELAXED);
+    if (!count || (count == CONTINUATION)) return;
+
+    // pages are released while block is still ours, nobody else can
+    // reuse them before it is marked as free
+    release_pages(ptr, count * header->granule);
+
+    ScopedLock_t<Mutex_t> lock(header->mutex);
+    for (std::size_t k = i; k < i + count; ++k) runs[k] = 0;
+    header->used -= count;
+    --header->blocks;
+}
+
+}
@@ -0,0 +1,431 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Shared memory pool in memfd passed between processes.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shmemfd.h>
+#include <shallocator/shmutex.h>
+
+// older headers don't know memfd and seals
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SHRINK 0x0002
+#endif
+#ifndef F_SEAL_GROW
+#define F_SEAL_GROW 0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+namespace SHAllocator {
+
+/**
+ * @short Memfd pool of this process.
+ */
+MemfdPoolInfo_t SHMemfdPool = {0, 0, false};
+
+namespace {
+
+/// identification of pool ("shmemfd1")
+const uint64_t POOL_MAGIC = 0x3164666d656d6873ULL;
+
+/// block sizes up to this are rounded to SMALL_STEP
+const std::size_t SMALL_LIMIT = 1024;
+/// step of small size classes
+const std::size_t SMALL_STEP = 16;
+/// count of small size classes
+const std::size_t SMALL_CLASSES = SMALL_LIMIT / SMALL_STEP;
+/// count of all size classes (bigger ones are powers of two)
+const std::size_t CLASSES = 128;
+
+/**
+ * @short Beginning of pool readable without mapping it.
+ */
+struct PoolIdent_t {
+    uint64_t magic;         //< POOL_MAGIC when pool is initialized.
+    std::size_t size;       //< size of whole pool.
+    char *origin;           //< address of creator's mapping.
+};
+
+/**
+ * @short Header at the beginning of the pool, shared by all processes.
+ * Everything is addressed by offsets from the pool beginning.
+ */
+struct PoolHeader_t {
+    PoolIdent_t ident;              //< identification.
+    std::size_t root;               //< offset of root object or 0.
+    uint32_t frozen;                //< pool is immutable.
+    Mutex_t mutex;                  //< lock of allocator.
+    std::size_t top;                //< offset of never used space.
+    std::size_t used;               //< bytes of live blocks.
+    std::size_t blocks;             //< count of live blocks.
+    std::size_t free_lists[CLASSES];//< offsets of first free blocks.
+};
+
+/**
+ * @short Header of block (keeps user data 16 bytes aligned).
+ */
+struct BlockHeader_t {
+    std::size_t size_class; //< size class of block.
+    std::size_t next;       //< offset of next free block.
+};
+
+/// offset of first block
+const std::size_t DATA_OFFSET = (sizeof(PoolHeader_t) + 15) & ~std::size_t(15);
+
+PoolHeader_t *pool = 0;     //< pool of this process.
+int pool_fd = -1;           //< fd of pool.
+
+std::size_t size_class(std::size_t size) {
+    if (size <= SMALL_LIMIT) return (size? size - 1: 0) / SMALL_STEP;
+    std::size_t bits = 64 - static_cast<std::size_t>(
+            __builtin_clzll(static_cast<unsigned long long>(size - 1)));
+    return SMALL_CLASSES + bits - 11;
+}
+
+std::size_t class_size(std::size_t size_class) {
+    if (size_class < SMALL_CLASSES) return (size_class + 1) * SMALL_STEP;
+    return std::size_t(1) << (size_class - SMALL_CLASSES + 11);
+}
+
+/**
+ * @short Map pool, return 0 if it can't be mapped at wanted address.
+ */
+char *map_pool(int fd, std::size_t size, const void *want, int prot) {
+    void *addr = mmap(const_cast<void *>(want), size, prot, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return 0;
+    if (want && (addr != want)) {
+        munmap(addr, size);
+        return 0;
+    }
+    return static_cast<char *>(addr);
+}
+
+/**
+ * @short Make pool current pool of this process.
+ */
+void install_pool(char *base, int fd, bool read_only) {
+    pool = reinterpret_cast<PoolHeader_t *>(base);
+    pool_fd = fd;
+    SHMemfdPool.begin = base;
+    SHMemfdPool.end = base + pool->ident.size;
+    SHMemfdPool.writable = !read_only && !memfd_pool_frozen();
+}
+
+/// frees of read only or frozen pool blocks ignored by this process
+std::size_t ignored_frees = 0;
+
+/**
+ * @short Refuse to modify read only or frozen pool.
+ */
+void refuse(const char *what) {
+    SHMemfdPool.writable = false;
+    throw std::logic_error(std::string(what)
+                           + ": memfd pool is read only or frozen");
+}
+
+}
+
+void create_memfd_pool(std::size_t size, const void *base, const char *name)
+{
+    if (pool)
+        throw std::runtime_error("create_memfd_pool: pool already exists");
+
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    size = (size + page - 1) / page * page;
+    if (size <= DATA_OFFSET)
+        throw std::runtime_error("create_memfd_pool: invalid size");
+
+    int fd = static_cast<int>(syscall(SYS_memfd_create, name,
+                                      MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (fd < 0)
+        throw std::runtime_error("create_memfd_pool: can't create memfd");
+    if (ftruncate(fd, static_cast<off_t>(size))) {
+        close(fd);
+        throw std::runtime_error("create_memfd_pool: can't resize memfd");
+    }
+
+    // size never changes, attached processes rely on it
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+
+    char *addr = map_pool(fd, size, base, PROT_READ | PROT_WRITE);
+    if (!addr) {
+        close(fd);
+        throw std::runtime_error("create_memfd_pool: can't map pool");
+    }
+
+    // fresh memfd is zeroed, all free lists are empty
+    PoolHeader_t *header = reinterpret_cast<PoolHeader_t *>(addr);
+    try {
+        new (&header->mutex) Mutex_t();
+    } catch (...) {
+        munmap(addr, size);
+        close(fd);
+        throw;
+    }
+    header->ident.size = size;
+    header->ident.origin = addr;
+    header->top = DATA_OFFSET;
+    __atomic_store_n(&header->ident.magic, POOL_MAGIC, __ATOMIC_RELEASE);
+    install_pool(addr, fd, false);
+}
+
+void *attach_memfd_pool(int fd, int flags) {
+    if (pool)
+        throw std::runtime_error("attach_memfd_pool: pool already exists");
+
+    struct stat st;
+    PoolIdent_t ident;
+    if (fstat(fd, &st) || (static_cast<std::size_t>(st.st_size) < DATA_OFFSET)
+        || (pread(fd, &ident, sizeof(ident), 0) != sizeof(ident))
+        || (ident.magic != POOL_MAGIC)
+        || (ident.size != static_cast<std::size_t>(st.st_size)))
+        throw std::runtime_error("attach_memfd_pool: fd is not pool");
+
+    bool read_only = flags & (MEMFD_READ_ONLY | MEMFD_FROZEN);
+    int prot = PROT_READ | (read_only? 0: PROT_WRITE);
+    char *addr = map_pool(fd, ident.size, ident.origin, prot);
+    if (!addr && (flags & MEMFD_ANY_ADDRESS))
+        addr = map_pool(fd, ident.size, 0, prot);
+    if (!addr)
+        throw std::runtime_error("attach_memfd_pool: can't map pool");
+
+    PoolHeader_t *header = reinterpret_cast<PoolHeader_t *>(addr);
+    if ((flags & MEMFD_FROZEN)
+        && !__atomic_load_n(&header->frozen, __ATOMIC_ACQUIRE))
+    {
+        munmap(addr, ident.size);
+        throw std::runtime_error("attach_memfd_pool: pool is not frozen");
+    }
+    install_pool(addr, fd, read_only);
+    return addr;
+}
+
+void detach_memfd_pool() {
+    if (!pool) return;
+    PoolHeader_t *header = pool;
+    pool = 0;
+    SHMemfdPool.begin = SHMemfdPool.end = 0;
+    SHMemfdPool.writable = false;
+    munmap(header, header->ident.size);
+    close(pool_fd);
+    pool_fd = -1;
+}
+
+int memfd_pool_fd() { return pool_fd;}
+
+void *memfd_pool_base() { return pool;}
+
+bool memfd_pool_at_origin() {
+    return pool && (pool->ident.origin == reinterpret_cast<char *>(pool));
+}
+
+void set_memfd_pool_root(const void *root) {
+    if (!pool)
+        throw std::runtime_error("set_memfd_pool_root: there is no pool");
+    if (!SHMemfdPool.writable) refuse("set_memfd_pool_root");
+    std::size_t offset = root? static_cast<std::size_t>(
+            static_cast<const char *>(root) - reinterpret_cast<char *>(pool))
+                             : 0;
+    __atomic_store_n(&pool->root, offset, __ATOMIC_RELEASE);
+}
+
+void *memfd_pool_root() {
+    if (!pool) return 0;
+    std::size_t offset = __atomic_load_n(&pool->root, __ATOMIC_ACQUIRE);
+    return offset? reinterpret_cast<char *>(pool) + offset: 0;
+}
+
+void seal_memfd_pool() {
+    if (!pool)
+        throw std::runtime_error("seal_memfd_pool: there is no pool");
+    if (fcntl(pool_fd, F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE))
+        throw std::runtime_error("seal_memfd_pool: can't seal pool");
+}
+
+void freeze_memfd_pool() {
+    if (!pool)
+        throw std::runtime_error("freeze_memfd_pool: there is no pool");
+    if (!SHMemfdPool.writable) refuse("freeze_memfd_pool");
+
+    // allocations running in other processes finish before
+    {
+        ScopedLock_t<Mutex_t> lock(pool->mutex);
+        __atomic_store_n(&pool->frozen, 1, __ATOMIC_RELEASE);
+    }
+    SHMemfdPool.writable = false;
+
+    // new writable mappings are refused if kernel supports it
+    fcntl(pool_fd, F_ADD_SEALS,
+          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE);
+    if (mprotect(pool, pool->ident.size, PROT_READ))
+        throw std::runtime_error("freeze_memfd_pool: can't protect pool");
+}
+
+bool memfd_pool_frozen() {
+    return pool && __atomic_load_n(&pool->frozen, __ATOMIC_ACQUIRE);
+}
+
+MemfdPoolStats_t memfd_pool_stats() {
+    MemfdPoolStats_t stats = {0, 0, 0, 0,
+            __atomic_load_n(&ignored_frees, __ATOMIC_RELAXED)};
+    if (!pool) return stats;
+
+    // read only mapping can't take the lock, frozen pool doesn't change
+    bool locked = SHMemfdPool.writable;
+    if (locked) pool->mutex.lock();
+    stats.capacity = pool->ident.size - DATA_OFFSET;
+    stats.used = pool->used;
+    stats.reserved = pool->top - DATA_OFFSET;
+    stats.blocks = pool->blocks;
+    if (locked) pool->mutex.unlock();
+    return stats;
+}
+
+void *memfd_allocate(std::size_t size) {
+    if (!pool || (size > pool->ident.size)) return 0;
+    std::size_t cls = size_class(size);
+    std::size_t need = sizeof(BlockHeader_t) + class_size(cls);
+    char *base = reinterpret_cast<char *>(pool);
+    if (!SHMemfdPool.writable) return 0;
+
+    ScopedLock_t<Mutex_t> lock(pool->mutex);
+    if (__atomic_load_n(&pool->frozen, __ATOMIC_RELAXED)) {
+        SHMemfdPool.writable = false;
+        return 0;
+    }
+    BlockHeader_t *block;
+    if (std::size_t offset = pool->free_lists[cls]) {
+        block = reinterpret_cast<BlockHeader_t *>(base + offset);
+        pool->free_lists[cls] = block->next;
+    } else {
+        if (pool->ident.size - pool->top < need) return 0;
+        block = reinterpret_cast<BlockHeader_t *>(base + pool->top);
+        block->size_class = cls;
+        pool->top += need;
+    }
+    pool->used += need;
+    ++pool->blocks;
+    return block + 1;
+}
+
+void memfd_deallocate(void *ptr) {
+    if (!pool || !ptr) return;
+    // shfree() runs in destructors, so it must not throw; frozen data
+    // stay as they are
+    if (!SHMemfdPool.writable) {
+        __atomic_fetch_add(&ignored_frees, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    BlockHeader_t *block = static_cast<BlockHeader_t *>(ptr) - 1;
+    std::size_t cls = block->size_class;
+
+    ScopedLock_t<Mutex_t> lock(pool->mutex);
+    if (__atomic_load_n(&pool->frozen, __ATOMIC_RELAXED)) {
+        SHMemfdPool.writable = false;
+        __atomic_fetch_add(&ignored_frees, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    block->next = pool->free_lists[cls];
+    pool->free_lists[cls] = static_cast<std::size_t>(
+            reinterpret_cast<char *>(block) - reinterpret_cast<char *>(pool));
+    pool->used -= sizeof(BlockHeader_t) + class_size(cls);
+    --pool->blocks;
+}
+
+void send_pool_fd(int socket, int fd) {
+    char byte = 0;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if (sendmsg(socket, &msg, MSG_NOSIGNAL) != 1)
+        throw std::runtime_error("send_pool_fd: can't send fd");
+}
+
+int receive_pool_fd(int socket) {
+    char byte;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != 1)
+        throw std::runtime_error("receive_pool_fd: can't receive fd");
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || (cmsg->cmsg_level != SOL_SOCKET)
+        || (cmsg->cmsg_type != SCM_RIGHTS)
+        || (cmsg->cmsg_len != CMSG_LEN(sizeof(int))))
+        throw std::runtime_error("receive_pool_fd: no fd received");
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Compressed 32-bit offsets of shared memory blocks.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shoffset.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Base of offsets of this process.
+ */
+char *SHOffsetBase = 0;
+
+namespace {
+
+/// half of addressable range
+const uintptr_t OFFSET_HALF = (uintptr_t(OFFSET_LIMIT) << OFFSET_SHIFT) / 2;
+
+/**
+ * @short Return base centered around ptr.
+ */
+char *centered_base(const void *ptr) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t base = (addr > OFFSET_HALF)? addr - OFFSET_HALF: 0;
+    base &= ~uintptr_t((1 << OFFSET_SHIFT) - 1);
+    return reinterpret_cast<char *>(base);
+}
+
+}
+
+void set_offset_base(const void *base) {
+    if (base) {
+        // offset 0 means null so base itself is never addressable
+        SHOffsetBase = static_cast<char *>(const_cast<void *>(base));
+        return;
+    }
+
+    // derive it from address of any block of the pool
+    void *probe = MM_malloc(1);
+    if (!probe) throw std::bad_alloc();
+    SHOffsetBase = centered_base(probe);
+    MM_free(probe);
+}
+
+void *offset_check(void *ptr) {
+    // base derived lazily after fork would differ between processes
+    if (!SHOffsetBase) {
+        shfree(ptr);
+        throw std::logic_error("offset_allocate: offset base is not set "
+                               "(call set_offset_base() before fork)");
+    }
+
+    uintptr_t distance = reinterpret_cast<uintptr_t>(ptr)
+                       - reinterpret_cast<uintptr_t>(SHOffsetBase);
+    if (!distance || (distance & ((1 << OFFSET_SHIFT) - 1))
+            || (distance > (uintptr_t(OFFSET_LIMIT) << OFFSET_SHIFT)))
+    {
+        shfree(ptr);
+        throw std::length_error("offset_allocate: block is out of offset "
+                                "range (see set_offset_base())");
+    }
+    return ptr;
+}
+
+}
+
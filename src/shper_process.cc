@@ -0,0 +1,51 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Padded per-process slots in shared memory.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+#include <shallocator/shper_process.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Cached pid of this process.
+ */
+pid_t SHCurrentPid = 0;
+
+namespace {
+
+/**
+ * @short Forget cached pid in child.
+ */
+void forget_pid() { SHCurrentPid = 0;}
+
+/**
+ * @short Registers fork handler.
+ */
+struct PidCache_t {
+    PidCache_t() { pthread_atfork(0, 0, forget_pid);}
+} pid_cache;
+
+}
+
+pid_t refresh_current_pid() {
+    return SHCurrentPid = getpid();
+}
+
+}
@@ -0,0 +1,202 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Memory pressure watermarks and callbacks.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <stdexcept>
+#include <shallocator/shalloc.h>
+#include <shallocator/shpressure.h>
+
+namespace SHAllocator {
+
+/**
+ * @short Memory pressure checking of this process.
+ */
+PressureInfo_t SHPressure = {0, 0};
+
+namespace {
+
+/// max count of callbacks in one process
+const unsigned MAX_CALLBACKS = 32;
+
+/**
+ * @short Watermarks and level, shared by all processes.
+ */
+struct PressureState_t {
+    std::size_t high;       //< high watermark.
+    std::size_t low;        //< low watermark.
+    std::size_t capacity;   //< bytes of pool.
+    int level;              //< PRESSURE_NORMAL or PRESSURE_HIGH.
+};
+
+/**
+ * @short Registered callback.
+ */
+struct Callback_t {
+    PressureCallback_t callback;
+    void *data;
+};
+
+/**
+ * @short Shared state (allocated in the pool before fork).
+ */
+PressureState_t *state = 0;
+
+/**
+ * @short Callbacks of this process.
+ */
+Callback_t callbacks[MAX_CALLBACKS];
+
+/**
+ * @short Count of callbacks of this process.
+ */
+unsigned callback_count = 0;
+
+/**
+ * @short Level for which this process fired callbacks last time.
+ */
+int seen = PRESSURE_NORMAL;
+
+/**
+ * @short Callbacks are running in this process, don't nest them.
+ */
+bool firing = false;
+
+/**
+ * @short Return used bytes of pool.
+ */
+std::size_t pool_used() {
+    std::size_t available = MM_available();
+    return (state->capacity > available)? state->capacity - available: 0;
+}
+
+/**
+ * @short Call all callbacks of this process.
+ */
+void fire(PressureEvent_t event, std::size_t used) {
+    // callbacks run inside shmalloc() after the block has been allocated
+    // (or from nothrow paths), so their exceptions must not escape
+    firing = true;
+    for (unsigned i = 0; i < callback_count; ++i) {
+        try {
+            callbacks[i].callback(event, used, state->capacity,
+                                  callbacks[i].data);
+        } catch (...) {}
+    }
+    firing = false;
+}
+
+/**
+ * @short Compare usage with watermarks, move shared level on crossing and
+ * fire callbacks of this process if level differs from the seen one.
+ */
+PressureEvent_t check(std::size_t used) {
+    int level = __atomic_load_n(&state->level, __ATOMIC_RELAXED);
+    int next = level;
+    if ((level == PRESSURE_NORMAL) && (used >= state->high))
+        next = PRESSURE_HIGH;
+    else if ((level == PRESSURE_HIGH) && (used < state->low))
+        next = PRESSURE_NORMAL;
+
+    // one process moves the shared level, lost CAS means someone else did
+    if (next != level)
+        __atomic_compare_exchange_n(&state->level, &level, next, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+
+    // every process fires its own callbacks once per level change it sees
+    level = __atomic_load_n(&state->level, __ATOMIC_RELAXED);
+    if (level != seen) {
+        seen = level;
+        fire(static_cast<PressureEvent_t>(level), used);
+    }
+    return static_cast<PressureEvent_t>(level);
+}
+
+}
+
+void enable_pressure(std::size_t high, std::size_t low,
+                     std::size_t capacity, unsigned check_every)
+{
+    if (low > high)
+        throw std::invalid_argument("enable_pressure: low watermark is "
+                                    "above high watermark");
+    if (!state) {
+        // SHPressure is off so this alloc is not checked
+        SHPressure.check_every = 0;
+        state = static_cast<PressureState_t *>(MM_malloc(sizeof(*state)));
+        if (!state) throw std::bad_alloc();
+        state->level = PRESSURE_NORMAL;
+    }
+    seen = __atomic_load_n(&state->level, __ATOMIC_RELAXED);
+    state->high = high;
+    state->low = low;
+    state->capacity = capacity? capacity: MM_available();
+    SHPressure.check_every = check_every? check_every: 1;
+    SHPressure.countdown = SHPressure.check_every;
+}
+
+void disable_pressure() {
+    SHPressure.check_every = 0;
+}
+
+void add_pressure_callback(PressureCallback_t callback, void *data) {
+    if (callback_count == MAX_CALLBACKS)
+        throw std::runtime_error("add_pressure_callback: too many callbacks");
+    callbacks[callback_count].callback = callback;
+    callbacks[callback_count].data = data;
+    ++callback_count;
+}
+
+void remove_pressure_callback(PressureCallback_t callback, void *data) {
+    for (unsigned i = 0; i < callback_count; ++i) {
+        if ((callbacks[i].callback == callback) && (callbacks[i].data == data)) {
+            for (--callback_count; i < callback_count; ++i)
+                callbacks[i] = callbacks[i + 1];
+            return;
+        }
+    }
+}
+
+PressureEvent_t check_pressure() {
+    if (!state) return PRESSURE_NORMAL;
+    if (firing) return pressure_level();
+    return check(pool_used());
+}
+
+PressureEvent_t pressure_level() {
+    if (!state) return PRESSURE_NORMAL;
+    return static_cast<PressureEvent_t>(
+            __atomic_load_n(&state->level, __ATOMIC_RELAXED));
+}
+
+void *pressure_allocate(void *ptr, std::size_t size) {
+    SHPressure.countdown = SHPressure.check_every;
+    if (!state || firing) return ptr;
+    if (ptr) {
+        check(pool_used());
+        return ptr;
+    }
+
+    // pool is exhausted, let callbacks free something and try it again
+    fire(PRESSURE_EXHAUSTED, pool_used());
+    ptr = MM_malloc(size);
+    check(pool_used());
+    return ptr;
+}
+
+}
+
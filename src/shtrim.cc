@@ -0,0 +1,105 @@
+/*
+ * FILE             $Id$
+ *
+ * DESCRIPTION      Return free pool pages to the kernel.
+ *
+ * PROJECT          Shared memory STL allocator.
+ *
+ * AUTHOR           Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * LICENSE          see COPYING
+ *
+ * Copyright (C) Seznam.cz a.s. 2007
+ * All Rights Reserved
+ *
+ * HISTORY
+ *       2026-10-19 (bukovsky)
+ *                  First draft.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <shallocator/shalloc.h>
+#include <shallocator/shtrim.h>
+
+namespace SHAllocator {
+
+namespace {
+
+/**
+ * @short Time of last trim in this process.
+ */
+std::time_t last_trim = 0;
+
+/**
+ * @short Release whole pages inside block, first word is kept because it
+ * links taken blocks.
+ */
+std::size_t release_block(void *ptr, std::size_t size, std::size_t page) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) + sizeof(void *);
+    uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + size;
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (end <= begin) return 0;
+
+    void *first = reinterpret_cast<void *>(begin);
+    std::size_t length = static_cast<std::size_t>(end - begin);
+    if (madvise(first, length, MADV_REMOVE)
+            && madvise(first, length, MADV_DONTNEED))
+        return 0;
+    return length;
+}
+
+}
+
+std::size_t trim_pool(std::size_t min_block, std::size_t reserve,
+                      std::size_t max_hold)
+{
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    if (min_block < 2 * page) min_block = 2 * page;
+
+    // take free blocks, biggest first, and link them through first word
+    void *taken = 0;
+    std::size_t held = 0;
+    std::size_t released = 0;
+    std::size_t available = MM_available();
+    std::size_t size = (available > reserve)? available - reserve: 0;
+    if (max_hold && (size > max_hold)) size = max_hold;
+    while (size >= min_block) {
+        void *ptr = MM_malloc(size);
+        if (!ptr) {
+            size /= 2;
+            continue;
+        }
+        *static_cast<void **>(ptr) = taken;
+        taken = ptr;
+        held += size;
+        released += release_block(ptr, size, page);
+
+        // reserve is left for others, hold is bounded
+        available = MM_available();
+        std::size_t left = (available > reserve)? available - reserve: 0;
+        if (max_hold && (left > max_hold - held)) left = max_hold - held;
+        if (size > left) size = left;
+    }
+
+    // give blocks back
+    while (taken) {
+        void *next = *static_cast<void **>(taken);
+        MM_free(taken);
+        taken = next;
+    }
+    return released;
+}
+
+std::size_t trim_pool_periodic(std::time_t interval, std::size_t min_block,
+                               std::size_t reserve, std::size_t max_hold)
+{
+    std::time_t now = std::time(0);
+    if (last_trim && (now - last_trim < interval)) return 0;
+    last_trim = now;
+    return trim_pool(min_block, reserve, max_hold);
+}
+
+}